@@ -12,6 +12,7 @@
 #include <assert.h>
 #include <iostream>
 #include <iomanip>
+#include <regex>
 #include <sys/time.h>
 
 benchmark::BenchRunner::BenchmarkMap &benchmark::BenchRunner::benchmarks() {
@@ -31,13 +32,16 @@ benchmark::BenchRunner::BenchRunner(std::string name, benchmark::BenchFunction f
 }
 
 void
-benchmark::BenchRunner::RunAll(double elapsedTimeForOne)
+benchmark::BenchRunner::RunAll(double elapsedTimeForOne, const std::string& filter)
 {
+    const std::regex reFilter(filter);
     perf_init();
     std::cout << "#Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << ","
               << "min_cycles" << "," << "max_cycles" << "," << "average_cycles" << "\n";
 
     for (const auto &p: benchmarks()) {
+        if (!std::regex_match(p.first, reFilter))
+            continue;
         State state(p.first, elapsedTimeForOne);
         p.second(state);
     }
@@ -72,7 +72,8 @@ namespace benchmark {
     public:
         BenchRunner(std::string name, BenchFunction func);
 
-        static void RunAll(double elapsedTimeForOne=1.0);
+        /** Runs the benchmarks whose name matches the filter regular expression */
+        static void RunAll(double elapsedTimeForOne=1.0, const std::string& filter=".*");
     };
 }
 
@@ -4,22 +4,38 @@
 
 #include "bench.h"
 
+#include "chainparams.h"
 #include "crypto/sha256.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
 #include "random.h"
+#include "script/sigcache.h"
+
+#include <iostream>
 
 int
 main(int argc, char** argv)
 {
+    gArgs.ParseParameters(argc, argv);
+    if (gArgs.IsArgSet("-?") || gArgs.IsArgSet("-h") || gArgs.IsArgSet("-help")) {
+        std::cout << "Usage: bench_paicoin [options]\n\n"
+                  << "Options:\n"
+                  << "  -filter=<regex>  Run only the benchmarks whose name matches the regular expression (default: .*)\n";
+        return 0;
+    }
+
     SHA256AutoDetect();
     RandomInit();
     ECC_Start();
+    ECCVerifyHandle globalVerifyHandle;
     SetupEnvironment();
+    SelectParams(CBaseChainParams::REGTEST);
+    InitSignatureCache();
+    InitScriptExecutionCache();
     fPrintToDebugLog = false; // don't want to write to debug.log file
 
-    benchmark::BenchRunner::RunAll();
+    benchmark::BenchRunner::RunAll(1.0, gArgs.GetArg("-filter", ".*"));
 
     ECC_Stop();
 }
@@ -0,0 +1,56 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "primitives/block.h"
+#include "streams.h"
+#include "version.h"
+
+#include <assert.h>
+
+namespace block_bench {
+#include "bench/data/block413567.raw.h"
+} // namespace block_bench
+
+// A block received from a peer is hashed by the message handler, by
+// ProcessNewBlock and AcceptBlock, by the stake and chain tip relay and by
+// the notifiers; this is a conservative count of those call sites.
+static const int HASHES_PER_RECEIVED_BLOCK = 8;
+
+static void BlockHashPerReceivedBlock(benchmark::State& state, bool fCached)
+{
+    uint64_t nBlocks = 0;
+    const uint64_t nHashesBefore = CBlockHeader::nHashesComputed;
+    while (state.KeepRunning()) {
+        CDataStream stream((const char*)block_bench::block413567,
+                (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+                SER_NETWORK, PROTOCOL_VERSION);
+        CBlockHeader header;
+        stream >> header;
+        for (int i = 0; i < HASHES_PER_RECEIVED_BLOCK; ++i) {
+            const uint256 hash = fCached ? header.GetHash() : header.ComputeHash();
+            assert(!hash.IsNull());
+        }
+        ++nBlocks;
+    }
+
+    // header hashes computed per received block, including the one cached at
+    // deserialization
+    const uint64_t nHashes = CBlockHeader::nHashesComputed - nHashesBefore;
+    assert(nHashes == nBlocks * (fCached ? 1 : 1 + HASHES_PER_RECEIVED_BLOCK));
+}
+
+static void BlockHashPerReceivedBlockUncached(benchmark::State& state)
+{
+    BlockHashPerReceivedBlock(state, false);
+}
+
+static void BlockHashPerReceivedBlockCached(benchmark::State& state)
+{
+    BlockHashPerReceivedBlock(state, true);
+}
+
+BENCHMARK(BlockHashPerReceivedBlockUncached);
+BENCHMARK(BlockHashPerReceivedBlockCached);
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "bench.h"
+#include "bench/hybrid_block.h"
 
 #include "chainparams.h"
 #include "validation.h"
@@ -47,10 +48,28 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
         stream >> block;
         assert(stream.Rewind(sizeof(block_bench::block413567)));
 
+        // the block comes from another chain: its proof of work, merkle root
+        // and coinbase outputs do not satisfy the PAI Coin rules, the
+        // transaction and size checks do
         CValidationState validationState;
-        assert(CheckBlock(block, validationState, chainParams->GetConsensus()));
+        assert(CheckBlock(block, validationState, chainParams->GetConsensus(), false, false, false));
+    }
+}
+
+// The same context-free checks, on a hybrid block with its stake transactions
+static void CheckHybridBlockTest(benchmark::State& state)
+{
+    LOCK(cs_main);
+    const HybridBlockFixture fixture;
+
+    while (state.KeepRunning()) {
+        CBlock block = fixture.Block(); // a fresh copy, as CBlock caches its checked state
+
+        CValidationState validationState;
+        assert(CheckBlock(block, validationState, Params().GetConsensus(), false, true, true, fixture.Height()));
     }
 }
 
 BENCHMARK(DeserializeBlockTest);
 BENCHMARK(DeserializeAndCheckBlockTest);
+BENCHMARK(CheckHybridBlockTest);
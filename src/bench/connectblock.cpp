@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench/hybrid_block.h"
+
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "stake/staketx.h"
+#include "validation.h"
+
+// The stake checks of a hybrid block, then the whole of its connection, with
+// the votes, ticket purchases and revocations next to regular transactions.
+
+static void CheckProofOfStakeHybrid(benchmark::State& state)
+{
+    LOCK(cs_main);
+    const HybridBlockFixture fixture;
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    while (state.KeepRunning()) {
+        assert(CheckProofOfStake(fixture.Block(), consensus.nMinimumStakeDiff));
+    }
+}
+
+static void CheckAllowedVotesHybrid(benchmark::State& state)
+{
+    LOCK(cs_main);
+    HybridBlockFixture fixture;
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        assert(checkAllowedVotes(fixture.Block(), validationState, consensus, fixture.Tip()));
+    }
+}
+
+static void CheckAllowedRevocationsHybrid(benchmark::State& state)
+{
+    LOCK(cs_main);
+    HybridBlockFixture fixture;
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        assert(checkAllowedRevocations(fixture.Block(), validationState, consensus, fixture.Tip()));
+    }
+}
+
+// ConnectBlock in its fJustCheck mode, on a view over the coins of the chain
+// that is dropped after each run. The index of the block carries its ticket
+// information, as for a block accepted to disk, so that its stake node is
+// connected from its votes and revocations without reading the block back.
+// The signatures and scripts are verified for real on the first run only, the
+// later runs hitting the signature and script caches as for a block whose
+// transactions were accepted to the mempool.
+static void ConnectBlockHybrid(benchmark::State& state)
+{
+    LOCK(cs_main);
+    HybridBlockFixture fixture;
+    const CBlock& block = fixture.Block();
+
+    CBlockIndex indexTemplate(block);
+    indexTemplate.pprev = fixture.Tip();
+    indexTemplate.nHeight = fixture.Height();
+    indexTemplate.PopulateTicketInfo(FindSpentTicketsInBlock(block));
+    // the fixture buys its tickets more than nTicketMaturity blocks below the block
+    indexTemplate.newTickets = std::make_shared<HashVector>();
+
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&fixture.Coins());
+        CBlockIndex index(indexTemplate);
+
+        CValidationState validationState;
+        assert(ConnectBlock(block, validationState, &index, view, Params(), true));
+    }
+}
+
+BENCHMARK(CheckProofOfStakeHybrid);
+BENCHMARK(CheckAllowedVotesHybrid);
+BENCHMARK(CheckAllowedRevocationsHybrid);
+BENCHMARK(ConnectBlockHybrid);
@@ -0,0 +1,238 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/hybrid_block.h"
+
+#include "blockcache.h"
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "random.h"
+#include "script/interpreter.h"
+#include "stake/hash256prng.h"
+#include "stake/staketx.h"
+#include "validation.h"
+
+#include <assert.h>
+#include <map>
+
+static const CAmount TICKET_PRICE = 100 * COIN;
+static const CAmount TICKET_FEE = 10000;
+static const CAmount SPEND_FEE = 10000;
+// the value of the outputs funding the ticket purchases and the regular transactions
+static const CAmount FUNDING_AMOUNT = TICKET_PRICE + TICKET_FEE;
+
+HybridBlockFixture::HybridBlockFixture(int nRegularTxs) : coins(&coinsDummy), nFundingUsed(0)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const CBlock& genesis = Params().GenesisBlock();
+    FastRandomContext rng(true);
+
+    const uint256 secret = rng.rand256();
+    key.Set(secret.begin(), secret.end(), true);
+    assert(key.IsValid());
+    script = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // the block is the fifth one after the stake validation height
+    const int nHeight = consensus.nStakeValidationHeight + 4;
+    const int nPoolTickets = consensus.nTicketPoolSize + MISSED_TICKETS;
+    const int nTicketBlocks = (nPoolTickets + consensus.nMaxFreshStakePerBlock - 1) / consensus.nMaxFreshStakePerBlock;
+    // mature enough for the tickets to be voted or revoked
+    const int nFirstTicketHeight = nHeight - 3 * consensus.nTicketMaturity;
+
+    // a single transaction funds all the tickets and the regular transactions
+    CMutableTransaction fundingTx;
+    fundingTx.vin.push_back(CTxIn(COutPoint(genesis.vtx[0]->GetHash(), 0)));
+    const int nFunding = nPoolTickets + consensus.nMaxFreshStakePerBlock + nRegularTxs;
+    for (int i = 0; i < nFunding; ++i)
+        fundingTx.vout.push_back(CTxOut(FUNDING_AMOUNT, script));
+    const CTransaction funding(fundingTx);
+    AddCoins(coins, funding, 1);
+    for (int i = 0; i < nFunding; ++i)
+        vFunding.push_back(COutPoint(funding.GetHash(), i));
+
+    // the block index of the chain, holding the pool tickets in a few blocks
+    std::map<uint256, CTransactionRef> mapTickets;
+    std::vector<uint256> vPoolTickets;
+    vIndex.resize(nHeight);
+    vHash.resize(nHeight);
+    for (int i = 0; i < nHeight; ++i) {
+        CBlockIndex& index = vIndex[i];
+        index.nHeight = i;
+        index.pprev = i > 0 ? &vIndex[i - 1] : nullptr;
+        index.nVersion = i > 0 ? HARDFORK_VERSION_BIT : genesis.nVersion;
+        index.nTime = genesis.nTime + i * consensus.nPowTargetSpacing;
+        index.nBits = genesis.nBits;
+        index.nVoteBits = VoteBits::rttAccepted;
+        vHash[i] = i > 0 ? rng.rand256() : genesis.GetHash();
+
+        if (i >= nFirstTicketHeight && i < nFirstTicketHeight + nTicketBlocks) {
+            CBlock ticketBlock;
+            ticketBlock.nVersion = index.nVersion;
+            ticketBlock.hashPrevBlock = vHash[i - 1];
+            ticketBlock.nTime = index.nTime;
+            ticketBlock.nBits = index.nBits;
+
+            CMutableTransaction coinbase;
+            coinbase.vin.push_back(CTxIn(COutPoint(), CScript() << i << OP_0));
+            coinbase.vout.push_back(CTxOut(GetMinerSubsidy(i, consensus), script));
+            ticketBlock.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+            while (static_cast<int>(vPoolTickets.size()) < nPoolTickets && static_cast<int>(ticketBlock.nFreshStake) < consensus.nMaxFreshStakePerBlock) {
+                const CTransactionRef ticket = MakeTransactionRef(CreateTicketPurchaseTx(TICKET_PRICE, TICKET_FEE));
+                AddCoins(coins, *ticket, i);
+                mapTickets[ticket->GetHash()] = ticket;
+                vPoolTickets.push_back(ticket->GetHash());
+                ticketBlock.vtx.push_back(ticket);
+                ++ticketBlock.nFreshStake;
+            }
+            ticketBlock.hashMerkleRoot = BlockMerkleRoot(ticketBlock);
+
+            // read by GetTicket when validating the votes and the revocations
+            vHash[i] = ticketBlock.GetHash();
+            blockCache.Insert(std::make_shared<const CBlock>(std::move(ticketBlock)));
+        }
+
+        index.phashBlock = &vHash[i];
+        index.BuildSkip();
+    }
+
+    // the stake node of the tip, with the first pool tickets live and the others missed
+    CBlockIndex* pindexPrev = Tip();
+    TicketTreap liveTickets;
+    TicketTreap missedTickets;
+    for (int i = 0; i < nPoolTickets; ++i) {
+        const uint32_t nTicketHeight = nFirstTicketHeight + i / consensus.nMaxFreshStakePerBlock;
+        if (i < consensus.nTicketPoolSize)
+            liveTickets = liveTickets.put(vPoolTickets[i], Value(nTicketHeight));
+        else
+            missedTickets = missedTickets.put(vPoolTickets[i], Value(nTicketHeight, true, false, false, false));
+    }
+    Hash256PRNG prng(pindexPrev->LotteryIV());
+    const HashVector winners = liveTickets.fetchWinners(prng.FindTicketIdxs(liveTickets.len(), consensus.nTicketsPerBlock));
+    pindexPrev->pstakeNode = std::make_shared<StakeNode>(pindexPrev->nHeight, liveTickets, missedTickets, TicketTreap(),
+                                                         UndoTicketDataVector(), HashVector(), winners, consensus);
+
+    // the hybrid block: votes of all the winners, ticket purchases, revocations
+    // of all the missed tickets, then regular transactions
+    block.nVersion = HARDFORK_VERSION_BIT;
+    block.hashPrevBlock = pindexPrev->GetBlockHash();
+    block.nTime = pindexPrev->nTime + consensus.nPowTargetSpacing;
+    block.nBits = pindexPrev->nBits;
+    block.nStakeDifficulty = TICKET_PRICE;
+    block.nVoteBits = VoteBits::rttAccepted;
+    block.nTicketPoolSize = liveTickets.len();
+
+    CMutableTransaction coinbase;
+    coinbase.vin.push_back(CTxIn(COutPoint(), CScript() << nHeight << OP_0));
+    coinbase.vout.push_back(CTxOut(GetMinerSubsidy(nHeight, consensus), script));
+    block.vtx.push_back(nullptr);
+
+    for (const uint256& ticketHash : winners) {
+        block.vtx.push_back(MakeTransactionRef(CreateVoteTx(block.hashPrevBlock, pindexPrev->nHeight, *mapTickets.at(ticketHash))));
+        ++block.nVoters;
+    }
+    for (int i = 0; i < consensus.nMaxFreshStakePerBlock; ++i) {
+        block.vtx.push_back(MakeTransactionRef(CreateTicketPurchaseTx(TICKET_PRICE, TICKET_FEE)));
+        coinbase.vout[0].nValue += TICKET_FEE;
+        ++block.nFreshStake;
+    }
+    for (int i = consensus.nTicketPoolSize; i < nPoolTickets; ++i) {
+        block.vtx.push_back(MakeTransactionRef(CreateRevocationTx(*mapTickets.at(vPoolTickets[i]))));
+        ++block.nRevocations;
+    }
+    for (int i = 0; i < nRegularTxs; ++i) {
+        block.vtx.push_back(MakeTransactionRef(CreateSpendTx(SPEND_FEE)));
+        coinbase.vout[0].nValue += SPEND_FEE;
+    }
+    block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+
+    coins.SetBestBlock(pindexPrev->GetBlockHash());
+    chainActive.SetTip(pindexPrev);
+    pcoinsTip = &coins;
+}
+
+HybridBlockFixture::~HybridBlockFixture()
+{
+    pcoinsTip = nullptr;
+    chainActive.SetTip(nullptr);
+    blockCache.Clear();
+}
+
+CTxOut HybridBlockFixture::NextFunding(COutPoint& prevout)
+{
+    assert(nFundingUsed < vFunding.size());
+    prevout = vFunding[nFundingUsed++];
+    return coins.AccessCoin(prevout).out;
+}
+
+void HybridBlockFixture::SignTx(CMutableTransaction& mtx, unsigned int nIn, const CScript& scriptCode) const
+{
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = SignatureHash(scriptCode, mtx, nIn, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    key.Sign(hash, vchSig);
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    mtx.vin[nIn].scriptSig << vchSig << ToByteVector(key.GetPubKey());
+}
+
+CMutableTransaction HybridBlockFixture::CreateTicketPurchaseTx(CAmount ticketPrice, CAmount fee)
+{
+    CMutableTransaction mtx;
+    COutPoint prevout;
+    const CTxOut spent = NextFunding(prevout);
+    mtx.vin.push_back(CTxIn(prevout));
+
+    mtx.vout.push_back(CTxOut(0, GetScriptForBuyTicketDecl(BuyTicketData{1})));
+    mtx.vout.push_back(CTxOut(ticketPrice, script));
+    const TicketContribData contribData(1, key.GetPubKey().GetID(), ticketPrice + fee);
+    mtx.vout.push_back(CTxOut(0, GetScriptForTicketContrib(contribData)));
+    const CAmount change = spent.nValue - ticketPrice - fee;
+    assert(change >= 0);
+    mtx.vout.push_back(CTxOut(change, script));
+
+    SignTx(mtx, 0, spent.scriptPubKey);
+    return mtx;
+}
+
+CMutableTransaction HybridBlockFixture::CreateVoteTx(const uint256& voteBlockHash, int voteBlockHeight, const CTransaction& ticket) const
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const CAmount ticketPrice = ticket.vout[ticketStakeOutputIndex].nValue;
+    const CAmount voterSubsidy = GetVoterSubsidy(voteBlockHeight + 1, consensus);
+    const CAmount contributedAmount = ticketPrice + TICKET_FEE;
+
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn(COutPoint(), consensus.stakeBaseSigScript));
+    mtx.vin.push_back(CTxIn(COutPoint(ticket.GetHash(), ticketStakeOutputIndex)));
+
+    const VoteData voteData{1, voteBlockHash, static_cast<uint32_t>(voteBlockHeight), VoteBits::rttAccepted, defaultVoterStakeVersion, ExtendedVoteBits()};
+    mtx.vout.push_back(CTxOut(0, GetScriptForVoteDecl(voteData)));
+    mtx.vout.push_back(CTxOut(CalculateGrossRemuneration(contributedAmount, ticketPrice, voterSubsidy, contributedAmount), script));
+
+    SignTx(mtx, voteStakeInputIndex, ticket.vout[ticketStakeOutputIndex].scriptPubKey);
+    return mtx;
+}
+
+CMutableTransaction HybridBlockFixture::CreateRevocationTx(const CTransaction& ticket) const
+{
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn(COutPoint(ticket.GetHash(), ticketStakeOutputIndex)));
+
+    mtx.vout.push_back(CTxOut(0, GetScriptForRevokeTicketDecl(RevokeTicketData{1})));
+    mtx.vout.push_back(CTxOut(ticket.vout[ticketStakeOutputIndex].nValue, script));
+
+    SignTx(mtx, revocationStakeInputIndex, ticket.vout[ticketStakeOutputIndex].scriptPubKey);
+    return mtx;
+}
+
+CMutableTransaction HybridBlockFixture::CreateSpendTx(CAmount fee)
+{
+    CMutableTransaction mtx;
+    COutPoint prevout;
+    const CTxOut spent = NextFunding(prevout);
+    mtx.vin.push_back(CTxIn(prevout));
+    mtx.vout.push_back(CTxOut(spent.nValue - fee, script));
+
+    SignTx(mtx, 0, spent.scriptPubKey);
+    return mtx;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PAICOIN_BENCH_HYBRID_BLOCK_H
+#define PAICOIN_BENCH_HYBRID_BLOCK_H
+
+#include "chain.h"
+#include "coins.h"
+#include "key.h"
+#include "primitives/block.h"
+#include "pubkey.h"
+#include "script/standard.h"
+
+#include <vector>
+
+/**
+ * Generates, in memory and deterministically, a regtest chain past the stake
+ * validation height and a hybrid PoW/PoS block extending it, with a full set
+ * of stake transactions: the votes of all the winners of its parent, ticket
+ * purchases filling the fresh stake of a block and revocations of missed
+ * tickets, followed by regular transactions.
+ *
+ * The transactions are built as the Generator of the unit tests builds them.
+ * The coins the block spends are in an in-memory coins view and the blocks of
+ * the tickets are in the block cache, so that the block is validated without
+ * any disk access. While the fixture lives, it is the active chain and
+ * pcoinsTip, which must be held with cs_main.
+ */
+class HybridBlockFixture
+{
+public:
+    static const int DEFAULT_REGULAR_TXS = 200;
+    static const int MISSED_TICKETS = 4;
+
+    explicit HybridBlockFixture(int nRegularTxs = DEFAULT_REGULAR_TXS);
+    ~HybridBlockFixture();
+
+    HybridBlockFixture(const HybridBlockFixture&) = delete;
+    HybridBlockFixture& operator=(const HybridBlockFixture&) = delete;
+
+    /** The hybrid block, extending Tip() */
+    const CBlock& Block() const { return block; }
+    CBlockIndex* Tip() { return &vIndex.back(); }
+    /** The height of the block */
+    int Height() const { return static_cast<int>(vIndex.size()); }
+
+    /** The coins of the chain, at Tip() */
+    CCoinsViewCache& Coins() { return coins; }
+
+private:
+    ECCVerifyHandle verifyHandle;
+    CKey key;
+    CScript script;
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins;
+    std::vector<CBlockIndex> vIndex;
+    std::vector<uint256> vHash;
+    std::vector<COutPoint> vFunding;
+    size_t nFundingUsed;
+    CBlock block;
+
+    CTxOut NextFunding(COutPoint& prevout);
+    void SignTx(CMutableTransaction& mtx, unsigned int nIn, const CScript& scriptCode) const;
+    CMutableTransaction CreateTicketPurchaseTx(CAmount ticketPrice, CAmount fee);
+    CMutableTransaction CreateVoteTx(const uint256& voteBlockHash, int voteBlockHeight, const CTransaction& ticket) const;
+    CMutableTransaction CreateRevocationTx(const CTransaction& ticket) const;
+    CMutableTransaction CreateSpendTx(CAmount fee);
+};
+
+#endif // PAICOIN_BENCH_HYBRID_BLOCK_H
@@ -0,0 +1,330 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "chainparamsbase.h"
+#include "random.h"
+#include "stake/hash256prng.h"
+#include "stake/stakenode.h"
+#include "validation.h"
+
+#include <algorithm>
+#include <assert.h>
+
+// Micro-benchmarks of the stake subsystem: the ticket treap, the connection
+// and disconnection of stake nodes, the lottery and the replay of the stake
+// nodes of a side chain. Each is run on live ticket pools of 1k, 10k and 100k
+// tickets, the mainnet pool size being 40960 tickets.
+
+// the number of new tickets maturing in a block, as many as may be purchased
+static const int NEW_TICKETS_PER_BLOCK = 20;
+// the number of blocks of the side chain whose stake nodes are replayed
+static const int FORK_LENGTH = 100;
+
+// The stake nodes are sized on the main chain parameters, whatever the chain
+// selected for the benchmarks
+static const Consensus::Params& StakeParams()
+{
+    static const std::unique_ptr<CChainParams> chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    return chainParams->GetConsensus();
+}
+
+// The height of the stake nodes, well after the stake validation height
+static uint32_t PoolHeight()
+{
+    return StakeParams().nStakeValidationHeight + StakeParams().nTicketExpiry;
+}
+
+struct StakePool
+{
+    std::vector<uint256> vLive;
+    std::vector<uint256> vMissed;
+    TicketTreap liveTickets;
+    TicketTreap missedTickets;
+};
+
+// Builds a pool of nPoolSize live tickets matured before PoolHeight(). When
+// fExpiring, two of them expire in each of the following blocks, otherwise
+// none expires in the next block.
+static StakePool BuildPool(int nPoolSize, bool fExpiring, FastRandomContext& rng)
+{
+    const Consensus::Params& params = StakeParams();
+    const uint32_t nHeight = PoolHeight();
+    const uint32_t nMaxSpread = params.nTicketExpiry - params.nTicketMaturity - 1;
+    const uint32_t nFirstHeight = nHeight + (fExpiring ? 1 : 2) - params.nTicketExpiry;
+    const uint32_t nSpread = std::min<uint32_t>(fExpiring ? nPoolSize / 2 : nPoolSize, nMaxSpread);
+
+    StakePool pool;
+    for (int i = 0; i < nPoolSize; ++i) {
+        const uint256 ticketHash = rng.rand256();
+        pool.vLive.push_back(ticketHash);
+        pool.liveTickets = pool.liveTickets.put(ticketHash, Value(nFirstHeight + i % nSpread));
+    }
+
+    // enough missed tickets for a revocation in each block of a fork
+    for (int i = 0; i < FORK_LENGTH; ++i) {
+        const uint256 ticketHash = rng.rand256();
+        pool.vMissed.push_back(ticketHash);
+        pool.missedTickets = pool.missedTickets.put(ticketHash, Value(nFirstHeight, true, false, false, false));
+    }
+    return pool;
+}
+
+static std::shared_ptr<StakeNode> BuildNode(const StakePool& pool, const uint256& lotteryIV)
+{
+    const Consensus::Params& params = StakeParams();
+    Hash256PRNG prng(lotteryIV);
+    const HashVector winners = pool.liveTickets.fetchWinners(prng.FindTicketIdxs(pool.liveTickets.len(), params.nTicketsPerBlock));
+    return std::make_shared<StakeNode>(PoolHeight(), pool.liveTickets, pool.missedTickets, TicketTreap(),
+                                       UndoTicketDataVector(), HashVector(), winners, params);
+}
+
+// The mix of the stake transactions of a block and of the tickets expiring
+struct StakeMix
+{
+    int nVotes;       // the other winners are missed
+    int nRevocations;
+    bool fExpiring;
+};
+
+static const StakeMix MIX_VOTES{5, 0, false};
+static const StakeMix MIX_MISSES{3, 1, false};
+static const StakeMix MIX_EXPIRY{5, 0, true};
+static const StakeMix MIX_ALL{3, 1, true};
+
+struct StakeBlock
+{
+    HashVector vVoted;
+    HashVector vRevoked;
+    HashVector vNew;
+};
+
+static StakeBlock BuildBlock(const StakeNode& parent, const StakeMix& mix, const std::vector<uint256>& vRevocable, FastRandomContext& rng)
+{
+    StakeBlock block;
+    const HashVector winners = parent.Winners();
+    block.vVoted.assign(winners.begin(), winners.begin() + mix.nVotes);
+    block.vRevoked.assign(vRevocable.begin(), vRevocable.begin() + mix.nRevocations);
+    for (int i = 0; i < NEW_TICKETS_PER_BLOCK; ++i)
+        block.vNew.push_back(rng.rand256());
+    return block;
+}
+
+static void TicketTreapPut(benchmark::State& state, int nPoolSize)
+{
+    FastRandomContext rng(true);
+    const StakePool pool = BuildPool(nPoolSize, false, rng);
+    std::vector<uint256> vKeys;
+    for (int i = 0; i < 1024; ++i)
+        vKeys.push_back(rng.rand256());
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        const TicketTreap treap = pool.liveTickets.put(vKeys[n++ % vKeys.size()], Value(PoolHeight()));
+        assert(treap.len() == nPoolSize + 1);
+    }
+}
+
+static void TicketTreapDeleteKey(benchmark::State& state, int nPoolSize)
+{
+    FastRandomContext rng(true);
+    const StakePool pool = BuildPool(nPoolSize, false, rng);
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        const TicketTreap treap = pool.liveTickets.deleteKey(pool.vLive[n++ % pool.vLive.size()]);
+        assert(treap.len() == nPoolSize - 1);
+    }
+}
+
+static void TicketTreapGetByIndex(benchmark::State& state, int nPoolSize)
+{
+    FastRandomContext rng(true);
+    const StakePool pool = BuildPool(nPoolSize, false, rng);
+
+    // stride through the pool, as the lottery does
+    int nIdx = 0;
+    while (state.KeepRunning()) {
+        pool.liveTickets.getByIndex(nIdx);
+        nIdx = (nIdx + 7919) % nPoolSize;
+    }
+}
+
+// The tickets expiring in a block, as found when connecting it
+static void TicketTreapForEachByHeight(benchmark::State& state, int nPoolSize)
+{
+    FastRandomContext rng(true);
+    const StakePool pool = BuildPool(nPoolSize, true, rng);
+    const uint32_t nExpiryHeight = PoolHeight() + 1 - StakeParams().nTicketExpiry;
+
+    while (state.KeepRunning()) {
+        int nExpiring = 0;
+        pool.liveTickets.forEachByHeight(nExpiryHeight + 1, [&nExpiring](const uint256&, const Value&) {
+            ++nExpiring;
+            return true;
+        });
+        assert(nExpiring > 0);
+    }
+}
+
+static void StakeConnectNode(benchmark::State& state, int nPoolSize, const StakeMix& mix)
+{
+    FastRandomContext rng(true);
+    const StakePool pool = BuildPool(nPoolSize, mix.fExpiring, rng);
+    const std::shared_ptr<StakeNode> parent = BuildNode(pool, rng.rand256());
+    const StakeBlock block = BuildBlock(*parent, mix, pool.vMissed, rng);
+    const uint256 lotteryIV = rng.rand256();
+
+    while (state.KeepRunning()) {
+        const std::shared_ptr<StakeNode> node = parent->ConnectNode(lotteryIV, block.vVoted, block.vRevoked, block.vNew);
+        assert(node != nullptr);
+    }
+}
+
+static void StakeDisconnectNode(benchmark::State& state, int nPoolSize, const StakeMix& mix)
+{
+    FastRandomContext rng(true);
+    const StakePool pool = BuildPool(nPoolSize, mix.fExpiring, rng);
+    const uint256 parentLotteryIV = rng.rand256();
+    const std::shared_ptr<StakeNode> parent = BuildNode(pool, parentLotteryIV);
+    const StakeBlock block = BuildBlock(*parent, mix, pool.vMissed, rng);
+    const std::shared_ptr<StakeNode> node = parent->ConnectNode(rng.rand256(), block.vVoted, block.vRevoked, block.vNew);
+    assert(node != nullptr);
+
+    while (state.KeepRunning()) {
+        const std::shared_ptr<StakeNode> restored = node->DisconnectNode(parentLotteryIV, parent->UndoData(), parent->NewTickets());
+        assert(restored->PoolSize() == parent->PoolSize());
+    }
+}
+
+static void StakeConnectNodeVotes(benchmark::State& state, int nPoolSize)
+{
+    StakeConnectNode(state, nPoolSize, MIX_VOTES);
+}
+
+static void StakeConnectNodeMisses(benchmark::State& state, int nPoolSize)
+{
+    StakeConnectNode(state, nPoolSize, MIX_MISSES);
+}
+
+static void StakeConnectNodeExpiry(benchmark::State& state, int nPoolSize)
+{
+    StakeConnectNode(state, nPoolSize, MIX_EXPIRY);
+}
+
+static void StakeDisconnectNodeMixed(benchmark::State& state, int nPoolSize)
+{
+    StakeDisconnectNode(state, nPoolSize, MIX_ALL);
+}
+
+static void StakeFindTicketIdxs(benchmark::State& state, int nPoolSize)
+{
+    FastRandomContext rng(true);
+    const uint256 lotteryIV = rng.rand256();
+    const size_t nTicketsPerBlock = StakeParams().nTicketsPerBlock;
+
+    while (state.KeepRunning()) {
+        Hash256PRNG prng(lotteryIV);
+        const prevector<64, uint32_t> idxs = prng.FindTicketIdxs(nPoolSize, nTicketsPerBlock);
+        assert(idxs.size() == nTicketsPerBlock);
+    }
+}
+
+// A chain of block indexes carrying the stake data of their blocks, so that
+// their stake nodes are connected without reading the blocks from disk
+class StakeChain
+{
+public:
+    explicit StakeChain(size_t nBlocks)
+    {
+        vIndex.reserve(nBlocks);
+        vHash.reserve(nBlocks);
+    }
+
+    CBlockIndex* Add(CBlockIndex* pprev, const StakeBlock& block, FastRandomContext& rng)
+    {
+        vHash.push_back(rng.rand256());
+        vIndex.emplace_back();
+        CBlockIndex* pindex = &vIndex.back();
+        pindex->phashBlock = &vHash.back();
+        pindex->pprev = pprev;
+        pindex->nHeight = pprev ? pprev->nHeight + 1 : PoolHeight();
+        pindex->nNonce = static_cast<uint32_t>(rng.rand32());
+
+        pindex->ticketsVoted = block.vVoted;
+        pindex->ticketsRevoked = block.vRevoked;
+        pindex->votes.resize(block.vVoted.size());
+        pindex->newTickets = std::make_shared<HashVector>(block.vNew);
+        return pindex;
+    }
+
+    // Connects the block, as done when it is accepted
+    CBlockIndex* Connect(CBlockIndex* pprev, const StakeMix& mix, const std::vector<uint256>& vRevocable, FastRandomContext& rng)
+    {
+        CBlockIndex* pindex = Add(pprev, BuildBlock(*pprev->pstakeNode, mix, vRevocable, rng), rng);
+        pindex->pstakeNode = pprev->pstakeNode->ConnectNode(pindex->LotteryIV(), pindex->ticketsVoted, pindex->ticketsRevoked, *pindex->newTickets);
+        assert(pindex->pstakeNode != nullptr);
+        return pindex;
+    }
+
+private:
+    std::vector<CBlockIndex> vIndex;
+    std::vector<uint256> vHash;
+};
+
+// The stake nodes of a side chain of FORK_LENGTH blocks are replayed from the
+// fork point, the stake nodes of the active chain being loaded. This is what
+// FetchStakeNode does to accept a block reorganizing the chain.
+static void StakeFetchNodeFork(benchmark::State& state, int nPoolSize)
+{
+    FastRandomContext rng(true);
+    const StakePool pool = BuildPool(nPoolSize, true, rng);
+
+    StakeChain chain(2 * FORK_LENGTH + 1);
+    CBlockIndex* pindexFork = chain.Add(nullptr, StakeBlock(), rng);
+    pindexFork->pstakeNode = BuildNode(pool, pindexFork->LotteryIV());
+
+    std::vector<CBlockIndex*> vSide;
+    CBlockIndex* pindexTip = pindexFork;
+    CBlockIndex* pindexSide = pindexFork;
+    for (int i = 0; i < FORK_LENGTH; ++i) {
+        const std::vector<uint256> vRevocable(pool.vMissed.begin() + i, pool.vMissed.end());
+        pindexTip = chain.Connect(pindexTip, MIX_ALL, vRevocable, rng);
+        pindexSide = chain.Connect(pindexSide, MIX_ALL, vRevocable, rng);
+        vSide.push_back(pindexSide);
+    }
+    chainActive.SetTip(pindexTip);
+
+    while (state.KeepRunning()) {
+        for (CBlockIndex* pindex : vSide)
+            pindex->pstakeNode = nullptr;
+        const std::shared_ptr<StakeNode> node = FetchStakeNode(pindexSide, StakeParams());
+        assert(node != nullptr && node->Height() == static_cast<uint32_t>(pindexSide->nHeight));
+    }
+
+    chainActive.SetTip(nullptr);
+}
+
+// Registers the benchmark on each of the pool sizes
+#define BENCHMARK_POOL_SIZES(name)                                                          \
+    static void name##_1k(benchmark::State& state) { name(state, 1000); }                   \
+    static void name##_10k(benchmark::State& state) { name(state, 10000); }                 \
+    static void name##_100k(benchmark::State& state) { name(state, 100000); }               \
+    BENCHMARK(name##_1k);                                                                   \
+    BENCHMARK(name##_10k);                                                                  \
+    BENCHMARK(name##_100k)
+
+BENCHMARK_POOL_SIZES(TicketTreapPut);
+BENCHMARK_POOL_SIZES(TicketTreapDeleteKey);
+BENCHMARK_POOL_SIZES(TicketTreapGetByIndex);
+BENCHMARK_POOL_SIZES(TicketTreapForEachByHeight);
+BENCHMARK_POOL_SIZES(StakeConnectNodeVotes);
+BENCHMARK_POOL_SIZES(StakeConnectNodeMisses);
+BENCHMARK_POOL_SIZES(StakeConnectNodeExpiry);
+BENCHMARK_POOL_SIZES(StakeDisconnectNodeMixed);
+BENCHMARK_POOL_SIZES(StakeFindTicketIdxs);
+BENCHMARK_POOL_SIZES(StakeFetchNodeFork);
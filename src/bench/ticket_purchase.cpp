@@ -0,0 +1,130 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "consensus/validation.h"
+#include "key.h"
+#include "script/standard.h"
+#include "stake/staketx.h"
+#include "validation.h"
+#include "wallet/db.h"
+#include "wallet/wallet.h"
+
+#include <assert.h>
+
+// the number of tickets the ticket buyer may purchase in a single window
+static const int TICKETS_PER_PURCHASE = 20;
+
+// Builds the unsigned ticket purchases spending the outputs of a split transaction,
+// as CWallet::PurchaseTicket does without a VSP, and adds the split transaction
+// to the wallet
+static std::vector<CTransactionToSign> BuildTickets(CWallet& wallet, const CKey& key)
+{
+    static uint32_t nextLockTime = 0;
+
+    const CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+    const CAmount ticketPrice = 100 * COIN;
+
+    CMutableTransaction splitTx;
+    splitTx.nLockTime = nextLockTime++; // so each purchase adds new tickets to the wallet
+    for (int i = 0; i < TICKETS_PER_PURCHASE; ++i)
+        splitTx.vout.push_back(CTxOut(ticketPrice, script));
+    const uint256 splitTxHash = splitTx.GetHash();
+
+    CWalletTx wtxSplit(&wallet, MakeTransactionRef(splitTx));
+    bool fAdded = wallet.AddToWallet(wtxSplit);
+    assert(fAdded);
+
+    std::vector<CTransactionToSign> vTickets(TICKETS_PER_PURCHASE);
+    for (int i = 0; i < TICKETS_PER_PURCHASE; ++i) {
+        CMutableTransaction& mTicketTx = vTickets[i].mtx;
+        mTicketTx.vin.push_back(CTxIn(splitTxHash, i));
+        vTickets[i].vSpent.emplace_back(0, splitTx.vout[i]);
+
+        mTicketTx.vout.push_back(CTxOut(0, GetScriptForBuyTicketDecl(BuyTicketData{1})));
+        mTicketTx.vout.push_back(CTxOut(ticketPrice, script));
+        TicketContribData contribData{1, key.GetPubKey().GetID(), ticketPrice, 0, TicketContribData::DefaultFeeLimit};
+        mTicketTx.vout.push_back(CTxOut(0, GetScriptForTicketContrib(contribData)));
+        mTicketTx.vout.push_back(CTxOut(0, script));
+    }
+    return vTickets;
+}
+
+// Signs the tickets and commits them to the wallet and its database in bulk, as
+// CWallet::PurchaseTicket does once the tickets are built
+static void SignAndCommit(CWallet& wallet, std::vector<CTransactionToSign>& vTickets)
+{
+    wallet.SignTransactions(vTickets);
+
+    std::vector<CWalletTx> vwtx;
+    for (CTransactionToSign& ticket : vTickets) {
+        assert(ticket.fSigned);
+        vwtx.emplace_back();
+        CWalletTx& wtx = vwtx.back();
+        wtx.fTimeReceivedIsTxTime = true;
+        wtx.BindWallet(&wallet);
+        wtx.SetTx(MakeTransactionRef(std::move(ticket.mtx)));
+    }
+    bool fCommitted = wallet.CommitTransactions(vwtx, nullptr);
+    assert(fCommitted);
+}
+
+// Signs and commits each ticket on its own, as CWallet::PurchaseTicket used to
+static void SignAndCommitOneByOne(CWallet& wallet, std::vector<CTransactionToSign>& vTickets)
+{
+    for (CTransactionToSign& ticket : vTickets) {
+        LOCK2(cs_main, wallet.cs_wallet);
+        bool fSigned = wallet.SignTransaction(ticket.mtx);
+        assert(fSigned);
+
+        CWalletTx wtx;
+        wtx.fTimeReceivedIsTxTime = true;
+        wtx.BindWallet(&wallet);
+        wtx.SetTx(MakeTransactionRef(std::move(ticket.mtx)));
+        CReserveKey reservekey(&wallet);
+        CValidationState state;
+        bool fCommitted = wallet.CommitTransaction(wtx, reservekey, nullptr, state);
+        assert(fCommitted);
+    }
+}
+
+// The tickets purchased per second is TICKETS_PER_PURCHASE over the time of an iteration,
+// which builds, signs and commits the tickets of a purchase
+static void TicketPurchase(benchmark::State& state, bool fBulk)
+{
+    bitdb.MakeMock();
+    {
+        CWallet wallet(std::unique_ptr<CWalletDBWrapper>(new CWalletDBWrapper(&bitdb, "wallet_bench.dat")));
+        bool fFirstRun;
+        wallet.LoadWallet(fFirstRun);
+
+        CKey key;
+        key.MakeNewKey(true);
+        wallet.CCryptoKeyStore::AddKeyPubKey(key, key.GetPubKey());
+
+        while (state.KeepRunning()) {
+            std::vector<CTransactionToSign> vTickets = BuildTickets(wallet, key);
+            if (fBulk)
+                SignAndCommit(wallet, vTickets);
+            else
+                SignAndCommitOneByOne(wallet, vTickets);
+        }
+    }
+    bitdb.Flush(true);
+    bitdb.Reset();
+}
+
+static void TicketPurchaseOneByOne(benchmark::State& state)
+{
+    TicketPurchase(state, false);
+}
+
+static void TicketPurchaseBulk(benchmark::State& state)
+{
+    TicketPurchase(state, true);
+}
+
+BENCHMARK(TicketPurchaseOneByOne);
+BENCHMARK(TicketPurchaseBulk);
@@ -0,0 +1,136 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#include "blockcache.h"
+
+#include "core_memusage.h"
+
+#include <limits>
+
+CBlockCache blockCache(DEFAULT_BLOCK_CACHE_SIZE << 20);
+
+CBlockCache::CBlockCache(size_t nMaxBytesIn) : nClock(0), nBytes(0), nMaxBytes(nMaxBytesIn), nHits(0), nMisses(0)
+{
+}
+
+CBlockCache::Shard& CBlockCache::GetShard(const uint256& hash)
+{
+    // the cheap hash selects the bucket within the shard, so pick the shard
+    // from a different part of the block hash
+    return shards[hash.GetUint64(1) % SHARD_COUNT];
+}
+
+void CBlockCache::Touch(Shard& shard, std::list<std::pair<uint256, Entry>>::iterator it)
+{
+    AssertLockHeld(shard.cs);
+
+    // the stamps of a shard are taken under its lock, so they decrease from
+    // the front to the back of its list
+    it->second.nLastUse = ++nClock;
+    shard.entries.splice(shard.entries.begin(), shard.entries, it);
+}
+
+std::shared_ptr<const CBlock> CBlockCache::Get(const uint256& hash)
+{
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+
+    const auto it = shard.index.find(hash);
+    if (it == shard.index.end()) {
+        ++nMisses;
+        return nullptr;
+    }
+
+    ++nHits;
+    Touch(shard, it->second);
+    return it->second->second.pblock;
+}
+
+void CBlockCache::Insert(const std::shared_ptr<const CBlock>& pblock)
+{
+    if (!pblock)
+        return;
+
+    const uint256 hash = pblock->GetHash();
+    const size_t nBlockBytes = sizeof(CBlock) + RecursiveDynamicUsage(*pblock);
+
+    {
+        Shard& shard = GetShard(hash);
+        LOCK(shard.cs);
+
+        const auto it = shard.index.find(hash);
+        if (it != shard.index.end()) {
+            Touch(shard, it->second);
+            return;
+        }
+
+        shard.entries.emplace_front(hash, Entry{pblock, nBlockBytes, ++nClock});
+        shard.index.emplace(hash, shard.entries.begin());
+        nBytes += nBlockBytes;
+    }
+    Trim();
+}
+
+void CBlockCache::Trim()
+{
+    LOCK(csTrim);
+
+    while (nBytes > nMaxBytes) {
+        // the least recently used entry is at the back of one of the shards
+        Shard* pshardOldest = nullptr;
+        uint64_t nOldest = std::numeric_limits<uint64_t>::max();
+        for (Shard& shard : shards) {
+            LOCK(shard.cs);
+            if (!shard.entries.empty() && shard.entries.back().second.nLastUse < nOldest) {
+                nOldest = shard.entries.back().second.nLastUse;
+                pshardOldest = &shard;
+            }
+        }
+        if (!pshardOldest)
+            break;
+
+        // the entry may have been used meanwhile, in which case the next
+        // least recently used one of its shard goes; close enough
+        LOCK(pshardOldest->cs);
+        if (pshardOldest->entries.empty())
+            continue;
+        const auto& last = pshardOldest->entries.back();
+        nBytes -= last.second.nBytes;
+        pshardOldest->index.erase(last.first);
+        pshardOldest->entries.pop_back();
+    }
+}
+
+void CBlockCache::SetMaxSize(size_t nMaxBytesIn)
+{
+    nMaxBytes = nMaxBytesIn;
+    Trim();
+}
+
+void CBlockCache::Clear()
+{
+    for (Shard& shard : shards) {
+        LOCK(shard.cs);
+        for (const auto& entry : shard.entries)
+            nBytes -= entry.second.nBytes;
+        shard.index.clear();
+        shard.entries.clear();
+    }
+}
+
+size_t CBlockCache::Count() const
+{
+    size_t nCount = 0;
+    for (const Shard& shard : shards) {
+        LOCK(shard.cs);
+        nCount += shard.entries.size();
+    }
+    return nCount;
+}
+
+size_t CBlockCache::DynamicMemoryUsage() const
+{
+    return nBytes;
+}
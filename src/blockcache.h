@@ -0,0 +1,100 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#ifndef PAICOIN_BLOCKCACHE_H
+#define PAICOIN_BLOCKCACHE_H
+
+#include "primitives/block.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+/** Default for -blockcachesize, the memory budget of the block cache in megabytes */
+static const int64_t DEFAULT_BLOCK_CACHE_SIZE = 64;
+
+// CBlockCache keeps recently read or connected blocks, already deserialized,
+// so that the many consumers that read the same recent blocks (stake node
+// construction, chain tip relay, getdata, notifiers, RPCs) share one copy
+// instead of reading the block files again.
+//
+// Blocks are keyed by their hash and are therefore immutable, so entries never
+// need to be invalidated; they are only evicted, least recently used first,
+// when the memory budget is exceeded. The entries are split over a number of
+// shards, each with its own lock, so that concurrent readers rarely contend.
+// The budget is shared by all the shards: each use of an entry is stamped from
+// a cache-wide clock, and the eviction takes the least recently used entry
+// across the shards, so that a block as large as the whole budget is kept.
+class CBlockCache
+{
+public:
+    explicit CBlockCache(size_t nMaxBytesIn);
+
+    // return the cached block with the given hash, or nullptr when absent
+    std::shared_ptr<const CBlock> Get(const uint256& hash);
+
+    // add the block to the cache, evicting older blocks as needed
+    void Insert(const std::shared_ptr<const CBlock>& pblock);
+
+    // change the memory budget, evicting blocks as needed
+    void SetMaxSize(size_t nMaxBytesIn);
+
+    void Clear();
+
+    size_t GetMaxSize() const { return nMaxBytes; }
+    size_t Count() const;
+    size_t DynamicMemoryUsage() const;
+    uint64_t GetHits() const { return nHits; }
+    uint64_t GetMisses() const { return nMisses; }
+
+private:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Hasher
+    {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<const CBlock> pblock;
+        size_t nBytes;
+        uint64_t nLastUse;
+    };
+
+    struct Shard
+    {
+        mutable CCriticalSection cs;
+        std::list<std::pair<uint256, Entry>> entries; // most recently used first
+        std::unordered_map<uint256, std::list<std::pair<uint256, Entry>>::iterator, Hasher> index;
+    };
+
+    Shard& GetShard(const uint256& hash);
+
+    // move the entry to the front of its shard as the most recently used one;
+    // shard.cs must be held
+    void Touch(Shard& shard, std::list<std::pair<uint256, Entry>>::iterator it);
+
+    // evict the least recently used entries of all the shards until the
+    // cache fits its budget; no shard.cs may be held
+    void Trim();
+
+    Shard shards[SHARD_COUNT];
+    // only one thread evicts at a time, locking the shards one after the other
+    CCriticalSection csTrim;
+    std::atomic<uint64_t> nClock;
+    std::atomic<size_t> nBytes;
+    std::atomic<size_t> nMaxBytes;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+};
+
+/** The process-wide block cache */
+extern CBlockCache blockCache;
+
+#endif // PAICOIN_BLOCKCACHE_H
@@ -0,0 +1,317 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#include "blockfilter.h"
+
+#include "hash.h"
+#include "script/script.h"
+#include "script/standard.h"
+#include "stake/staketx.h"
+#include "streams.h"
+
+#include <algorithm>
+#include <ios>
+
+namespace {
+
+/** Writes bits to a byte vector, most significant bit first */
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<unsigned char>& vchIn) : vch(vchIn), nBuffer(0), nOffset(0) {}
+    ~BitWriter() { Flush(); }
+
+    void Write(uint64_t nData, int nBits)
+    {
+        while (nBits > 0) {
+            const int nCount = std::min(8 - nOffset, nBits);
+            const uint8_t nChunk = (nData >> (nBits - nCount)) & ((1U << nCount) - 1);
+            nBuffer |= nChunk << (8 - nOffset - nCount);
+            nOffset += nCount;
+            nBits -= nCount;
+            if (nOffset == 8)
+                Flush();
+        }
+    }
+
+    // pad the last byte with zeros
+    void Flush()
+    {
+        if (nOffset == 0)
+            return;
+        vch.push_back(nBuffer);
+        nBuffer = 0;
+        nOffset = 0;
+    }
+
+private:
+    std::vector<unsigned char>& vch;
+    uint8_t nBuffer;
+    int nOffset; // bits of the buffer in use
+};
+
+/** Reads bits from a byte vector, most significant bit first */
+class BitReader
+{
+public:
+    BitReader(const std::vector<unsigned char>& vchIn, size_t nPosIn) : vch(vchIn), nPos(nPosIn), nOffset(8) {}
+
+    uint64_t Read(int nBits)
+    {
+        uint64_t nData = 0;
+        while (nBits > 0) {
+            if (nOffset == 8) {
+                if (nPos >= vch.size())
+                    throw std::ios_base::failure("GCS filter: end of data");
+                nBuffer = vch[nPos++];
+                nOffset = 0;
+            }
+            const int nCount = std::min(8 - nOffset, nBits);
+            nData = (nData << nCount) | ((nBuffer >> (8 - nOffset - nCount)) & ((1U << nCount) - 1));
+            nOffset += nCount;
+            nBits -= nCount;
+        }
+        return nData;
+    }
+
+    // whether only the padding of the last byte is left
+    bool AtEnd() const { return nPos == vch.size(); }
+
+private:
+    const std::vector<unsigned char>& vch;
+    size_t nPos;
+    uint8_t nBuffer;
+    int nOffset; // bits of the buffer already read
+};
+
+void GolombRiceEncode(BitWriter& writer, uint8_t P, uint64_t x)
+{
+    // the quotient in unary: q ones and a zero
+    uint64_t q = x >> P;
+    while (q > 0) {
+        const int nBits = q <= 64 ? (int)q : 64;
+        writer.Write(~0ULL, nBits);
+        q -= nBits;
+    }
+    writer.Write(0, 1);
+    writer.Write(x, P);
+}
+
+uint64_t GolombRiceDecode(BitReader& reader, uint8_t P)
+{
+    uint64_t q = 0;
+    while (reader.Read(1) == 1)
+        ++q;
+    return (q << P) + reader.Read(P);
+}
+
+/** Map x uniformly into [0, n), i.e. compute (x * n) >> 64 */
+uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+#ifdef __SIZEOF_INT128__
+    return (static_cast<unsigned __int128>(x) * static_cast<unsigned __int128>(n)) >> 64;
+#else
+    const uint64_t x_hi = x >> 32, x_lo = x & 0xFFFFFFFF;
+    const uint64_t n_hi = n >> 32, n_lo = n & 0xFFFFFFFF;
+    const uint64_t ac = x_hi * n_hi;
+    const uint64_t ad = x_hi * n_lo;
+    const uint64_t bc = x_lo * n_hi;
+    const uint64_t bd = x_lo * n_lo;
+    const uint64_t mid34 = (bd >> 32) + (bc & 0xFFFFFFFF) + (ad & 0xFFFFFFFF);
+    return ac + (bc >> 32) + (ad >> 32) + (mid34 >> 32);
+#endif
+}
+
+} // namespace
+
+GCSFilter::GCSFilter(const Params& paramsIn) : params(paramsIn), N(0), F(0)
+{
+    vEncoded.push_back(0); // CompactSize of N
+}
+
+GCSFilter::GCSFilter(const Params& paramsIn, std::vector<unsigned char> vEncodedIn) : params(paramsIn), vEncoded(std::move(vEncodedIn))
+{
+    CDataStream stream(vEncoded, SER_NETWORK, 0);
+    const uint64_t nElements = ReadCompactSize(stream);
+    if (nElements > std::numeric_limits<uint32_t>::max())
+        throw std::ios_base::failure("GCS filter: N must be less than 2^32");
+    N = nElements;
+    F = static_cast<uint64_t>(N) * params.M;
+
+    // decode all the elements to check the encoding
+    BitReader reader(vEncoded, vEncoded.size() - stream.size());
+    for (uint32_t i = 0; i < N; ++i)
+        GolombRiceDecode(reader, params.P);
+    if (!reader.AtEnd())
+        throw std::ios_base::failure("GCS filter: excess data");
+}
+
+GCSFilter::GCSFilter(const Params& paramsIn, const ElementSet& elements) : params(paramsIn)
+{
+    if (elements.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("GCS filter: N must be less than 2^32");
+    N = elements.size();
+    F = static_cast<uint64_t>(N) * params.M;
+
+    CVectorWriter(SER_NETWORK, 0, vEncoded, 0) << COMPACTSIZE(static_cast<uint64_t>(N));
+    if (N == 0)
+        return;
+
+    BitWriter writer(vEncoded);
+    uint64_t nLast = 0;
+    for (uint64_t nValue : BuildHashedSet(elements)) {
+        GolombRiceEncode(writer, params.P, nValue - nLast);
+        nLast = nValue;
+    }
+}
+
+uint64_t GCSFilter::HashToRange(const Element& element) const
+{
+    const uint64_t hash = CSipHasher(params.nSipHashK0, params.nSipHashK1).Write(element.data(), element.size()).Finalize();
+    return MapIntoRange(hash, F);
+}
+
+std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
+{
+    std::vector<uint64_t> vHashed;
+    vHashed.reserve(elements.size());
+    for (const Element& element : elements)
+        vHashed.push_back(HashToRange(element));
+    std::sort(vHashed.begin(), vHashed.end());
+    return vHashed;
+}
+
+bool GCSFilter::MatchInternal(const uint64_t* pElementHashes, size_t nSize) const
+{
+    CDataStream stream(vEncoded, SER_NETWORK, 0);
+    ReadCompactSize(stream);
+    BitReader reader(vEncoded, vEncoded.size() - stream.size());
+
+    // walk the filter and the sorted hashes together
+    uint64_t nValue = 0;
+    size_t nHashIndex = 0;
+    for (uint32_t i = 0; i < N; ++i) {
+        nValue += GolombRiceDecode(reader, params.P);
+        while (true) {
+            if (nHashIndex == nSize)
+                return false;
+            if (pElementHashes[nHashIndex] == nValue)
+                return true;
+            if (pElementHashes[nHashIndex] > nValue)
+                break;
+            ++nHashIndex;
+        }
+    }
+    return false;
+}
+
+bool GCSFilter::Match(const Element& element) const
+{
+    const uint64_t nHash = HashToRange(element);
+    return MatchInternal(&nHash, 1);
+}
+
+bool GCSFilter::MatchAny(const ElementSet& elements) const
+{
+    const std::vector<uint64_t> vHashed = BuildHashedSet(elements);
+    return MatchInternal(vHashed.data(), vHashed.size());
+}
+
+const std::string& BlockFilterTypeName(BlockFilterType filterType)
+{
+    static const std::string strBasic = "basic";
+    static const std::string strUnknown = "";
+    return filterType == BlockFilterType::BASIC ? strBasic : strUnknown;
+}
+
+bool BlockFilterTypeByName(const std::string& strName, BlockFilterType& filterType)
+{
+    if (strName != BlockFilterTypeName(BlockFilterType::BASIC))
+        return false;
+    filterType = BlockFilterType::BASIC;
+    return true;
+}
+
+static void AddScript(const CScript& script, GCSFilter::ElementSet& elements)
+{
+    if (script.empty() || script[0] == OP_RETURN)
+        return;
+    elements.emplace(script.begin(), script.end());
+}
+
+static GCSFilter::ElementSet BasicFilterElements(const CBlock& block, const CBlockUndo& blockUndo)
+{
+    GCSFilter::ElementSet elements;
+
+    for (const CTransactionRef& tx : block.vtx) {
+        for (const CTxOut& txout : tx->vout)
+            AddScript(txout.scriptPubKey, elements);
+
+        // the reward addresses committed by the ticket contributions
+        if (ParseTxClass(*tx) == TX_BuyTicket) {
+            std::vector<TicketContribData> contributions;
+            CAmount nTotalContribution, nTotalVoteFeeLimit, nTotalRevocationFeeLimit;
+            if (ParseTicketContribs(*tx, contributions, nTotalContribution, nTotalVoteFeeLimit, nTotalRevocationFeeLimit)) {
+                for (const TicketContribData& contrib : contributions) {
+                    if (contrib.whichAddr == 1)
+                        AddScript(GetScriptForDestination(CKeyID(contrib.rewardAddr)), elements);
+                    else if (contrib.whichAddr == 2)
+                        AddScript(GetScriptForDestination(CScriptID(contrib.rewardAddr)), elements);
+                }
+            }
+        }
+    }
+
+    for (const CTxUndo& txundo : blockUndo.vtxundo) {
+        for (const Coin& prevout : txundo.vprevout)
+            AddScript(prevout.out.scriptPubKey, elements);
+    }
+
+    return elements;
+}
+
+BlockFilter::BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, std::vector<unsigned char> vFilter) : filterType(filterTypeIn), blockHash(blockHashIn)
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params))
+        throw std::invalid_argument("unknown filter type");
+    filter = GCSFilter(params, std::move(vFilter));
+}
+
+BlockFilter::BlockFilter(BlockFilterType filterTypeIn, const CBlock& block, const CBlockUndo& blockUndo) : filterType(filterTypeIn), blockHash(block.GetHash())
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params))
+        throw std::invalid_argument("unknown filter type");
+    filter = GCSFilter(params, BasicFilterElements(block, blockUndo));
+}
+
+bool BlockFilter::BuildParams(GCSFilter::Params& params) const
+{
+    switch (filterType) {
+    case BlockFilterType::BASIC:
+        // the SipHash key is the first 16 bytes of the block hash
+        params.nSipHashK0 = blockHash.GetUint64(0);
+        params.nSipHashK1 = blockHash.GetUint64(1);
+        params.P = BASIC_FILTER_P;
+        params.M = BASIC_FILTER_M;
+        return true;
+    case BlockFilterType::INVALID:
+        return false;
+    }
+    return false;
+}
+
+uint256 BlockFilter::GetHash() const
+{
+    const std::vector<unsigned char>& vData = GetEncodedFilter();
+    return Hash(vData.begin(), vData.end());
+}
+
+uint256 BlockFilter::ComputeHeader(const uint256& prevHeader) const
+{
+    const uint256 filterHash = GetHash();
+    return Hash(filterHash.begin(), filterHash.end(), prevHeader.begin(), prevHeader.end());
+}
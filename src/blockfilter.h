@@ -0,0 +1,156 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#ifndef PAICOIN_BLOCKFILTER_H
+#define PAICOIN_BLOCKFILTER_H
+
+#include "coins.h"
+#include "primitives/block.h"
+#include "serialize.h"
+#include "uint256.h"
+#include "undo.h"
+
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Compact block filters (BIP 158) let light clients and wallet rescans test
+// whether a block may involve a script without downloading it, and are far
+// cheaper to serve than per-peer BIP 37 bloom filtering.
+
+/**
+ * A Golomb-coded set: a sorted list of N hashed elements, mapped into the
+ * range [0, N * M) with SipHash and encoded as Golomb-Rice coded deltas with
+ * parameter P. False positives occur with a probability of about 1 / M.
+ */
+class GCSFilter
+{
+public:
+    typedef std::vector<unsigned char> Element;
+    typedef std::set<Element> ElementSet;
+
+    struct Params
+    {
+        uint64_t nSipHashK0;
+        uint64_t nSipHashK1;
+        uint8_t P;
+        uint32_t M;
+
+        Params(uint64_t nSipHashK0In = 0, uint64_t nSipHashK1In = 0, uint8_t PIn = 0, uint32_t MIn = 1)
+            : nSipHashK0(nSipHashK0In), nSipHashK1(nSipHashK1In), P(PIn), M(MIn) {}
+    };
+
+    /** An empty filter */
+    explicit GCSFilter(const Params& paramsIn = Params());
+
+    /** Reconstruct a filter from its encoding; throws std::ios_base::failure when malformed */
+    GCSFilter(const Params& paramsIn, std::vector<unsigned char> vEncodedIn);
+
+    /** Build a filter from the set of elements */
+    GCSFilter(const Params& paramsIn, const ElementSet& elements);
+
+    uint32_t GetN() const { return N; }
+    const Params& GetParams() const { return params; }
+    const std::vector<unsigned char>& GetEncoded() const { return vEncoded; }
+
+    /** Whether the element is (probably) in the set */
+    bool Match(const Element& element) const;
+
+    /** Whether any of the elements is (probably) in the set; cheaper than
+     *  matching them one at a time */
+    bool MatchAny(const ElementSet& elements) const;
+
+private:
+    Params params;
+    uint32_t N;
+    uint64_t F; // range of the hashed elements, N * M
+    std::vector<unsigned char> vEncoded;
+
+    uint64_t HashToRange(const Element& element) const;
+    std::vector<uint64_t> BuildHashedSet(const ElementSet& elements) const;
+    bool MatchInternal(const uint64_t* pElementHashes, size_t nSize) const;
+};
+
+static const uint8_t BASIC_FILTER_P = 19;
+static const uint32_t BASIC_FILTER_M = 784931;
+
+enum class BlockFilterType : uint8_t
+{
+    BASIC = 0,
+    INVALID = 255,
+};
+
+/** The name of the filter type, as used by the RPC and REST interfaces */
+const std::string& BlockFilterTypeName(BlockFilterType filterType);
+
+/** Find the filter type by name; false if there is none */
+bool BlockFilterTypeByName(const std::string& strName, BlockFilterType& filterType);
+
+/**
+ * The filter of a block. The basic filter contains the scripts of the outputs
+ * created by the block and of the outputs its inputs spend, which are taken
+ * from the undo data, except for the OP_RETURN and empty scripts.
+ *
+ * The stake transactions are covered as well: the stake and change outputs
+ * of the tickets and the reward outputs of the votes and revocations are
+ * regular payment scripts and are included as any output; the ticket spent
+ * by a vote or a revocation is included as a spent output (the stake base
+ * input of a vote spends nothing). The reward address committed by each
+ * ticket contribution, which is carried in an OP_RETURN output, is included
+ * as the script paying to it, so that the owner of the address can find the
+ * tickets that will pay to it.
+ */
+class BlockFilter
+{
+public:
+    BlockFilter() : filterType(BlockFilterType::INVALID) {}
+
+    /** Reconstruct a block filter from its parts; throws std::ios_base::failure when malformed */
+    BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, std::vector<unsigned char> vFilter);
+
+    /** Compute the filter of the block */
+    BlockFilter(BlockFilterType filterTypeIn, const CBlock& block, const CBlockUndo& blockUndo);
+
+    BlockFilterType GetFilterType() const { return filterType; }
+    const uint256& GetBlockHash() const { return blockHash; }
+    const GCSFilter& GetFilter() const { return filter; }
+    const std::vector<unsigned char>& GetEncodedFilter() const { return filter.GetEncoded(); }
+
+    /** The hash of the encoded filter */
+    uint256 GetHash() const;
+
+    /** The filter header, committing to the filter and to the header of the previous block */
+    uint256 ComputeHeader(const uint256& prevHeader) const;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << (uint8_t)filterType << blockHash << filter.GetEncoded();
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        std::vector<unsigned char> vEncodedFilter;
+        uint8_t nFilterType;
+        s >> nFilterType >> blockHash >> vEncodedFilter;
+        filterType = static_cast<BlockFilterType>(nFilterType);
+
+        GCSFilter::Params params;
+        if (!BuildParams(params))
+            throw std::ios_base::failure("unknown filter type");
+        filter = GCSFilter(params, std::move(vEncodedFilter));
+    }
+
+private:
+    BlockFilterType filterType;
+    uint256 blockHash;
+    GCSFilter filter;
+
+    bool BuildParams(GCSFilter::Params& params) const;
+};
+
+#endif // PAICOIN_BLOCKFILTER_H
@@ -0,0 +1,131 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#include "blockfilterindex.h"
+
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+
+static const char DB_FILTER = 'f';
+static const char DB_BEST_BLOCK = 'B';
+
+std::unique_ptr<CBlockFilterIndex> g_blockfilterindex;
+
+namespace {
+
+/** The filter of a block and its header, as stored in the database */
+struct CFilterDBEntry
+{
+    std::vector<unsigned char> vFilter;
+    uint256 header;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(vFilter);
+        READWRITE(header);
+    }
+};
+
+} // namespace
+
+CBlockFilterIndex::CBlockFilterIndex(BlockFilterType filterTypeIn, bool fMemory, bool fWipe)
+    : CBaseIndexer("blockfilterindex"),
+      filterType(filterTypeIn),
+      db(GetDataDir() / "indexes" / "blockfilter" / BlockFilterTypeName(filterTypeIn), nBlockFilterIndexDBCache << 20, fMemory, fWipe)
+{
+}
+
+CBlockFilterIndex::~CBlockFilterIndex()
+{
+    // the thread must not outlive the database
+    Stop();
+}
+
+bool CBlockFilterIndex::BuildEntries(const CBlockIndex* pindex, const CBlock& block, bool fConnect, std::unique_ptr<BlockEntries>& entries)
+{
+    // the entries of a disconnected block stay valid
+    if (!fConnect)
+        return true;
+
+    // the genesis block has no undo data
+    CBlockUndo blockundo;
+    if (pindex->pprev) {
+        if (!UndoReadFromDisk(blockundo, pindex->GetUndoPos(), pindex->pprev->GetBlockHash()))
+            return error("%s: failure reading undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+        if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+            return error("%s: block and undo data inconsistent", __func__);
+    }
+
+    std::unique_ptr<FilterEntries> filterEntries(new FilterEntries());
+    filterEntries->hashPrevBlock = block.hashPrevBlock;
+    filterEntries->filter = BlockFilter(filterType, block, blockundo);
+    entries = std::move(filterEntries);
+    return true;
+}
+
+bool CBlockFilterIndex::WriteEntries(CDBBatch& batch, const BlockEntries& entries, bool fConnect)
+{
+    const FilterEntries& filterEntries = static_cast<const FilterEntries&>(entries);
+
+    uint256 headerPrev;
+    if (!filterEntries.hashPrevBlock.IsNull()) {
+        if (filterEntries.hashPrevBlock == hashLastBlock) {
+            headerPrev = headerLast;
+        } else {
+            CFilterDBEntry entryPrev;
+            if (!db.Read(std::make_pair(DB_FILTER, filterEntries.hashPrevBlock), entryPrev))
+                return error("%s: no filter header of block %s", __func__, filterEntries.hashPrevBlock.ToString());
+            headerPrev = entryPrev.header;
+        }
+    }
+
+    CFilterDBEntry entry;
+    entry.vFilter = filterEntries.filter.GetEncodedFilter();
+    entry.header = filterEntries.filter.ComputeHeader(headerPrev);
+    batch.Write(std::make_pair(DB_FILTER, filterEntries.filter.GetBlockHash()), entry);
+
+    hashLastBlock = filterEntries.filter.GetBlockHash();
+    headerLast = entry.header;
+    return true;
+}
+
+bool CBlockFilterIndex::ReadBestBlock(CBlockLocator& locator)
+{
+    if (!db.Read(DB_BEST_BLOCK, locator))
+        locator.SetNull();
+    return true;
+}
+
+void CBlockFilterIndex::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator)
+{
+    batch.Write(DB_BEST_BLOCK, locator);
+}
+
+bool CBlockFilterIndex::LookupFilter(const CBlockIndex* pindex, BlockFilter& filter) const
+{
+    CFilterDBEntry entry;
+    if (!db.Read(std::make_pair(DB_FILTER, pindex->GetBlockHash()), entry))
+        return false;
+
+    try {
+        filter = BlockFilter(filterType, pindex->GetBlockHash(), std::move(entry.vFilter));
+    } catch (const std::exception& e) {
+        return error("%s: invalid filter of block %s: %s", __func__, pindex->GetBlockHash().ToString(), e.what());
+    }
+    return true;
+}
+
+bool CBlockFilterIndex::LookupFilterHeader(const CBlockIndex* pindex, uint256& header) const
+{
+    CFilterDBEntry entry;
+    if (!db.Read(std::make_pair(DB_FILTER, pindex->GetBlockHash()), entry))
+        return false;
+    header = entry.header;
+    return true;
+}
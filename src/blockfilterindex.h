@@ -0,0 +1,70 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#ifndef PAICOIN_BLOCKFILTERINDEX_H
+#define PAICOIN_BLOCKFILTERINDEX_H
+
+#include "blockfilter.h"
+#include "indexer.h"
+
+#include <memory>
+
+/** Cache of the block filter database, in MiB */
+static const int64_t nBlockFilterIndexDBCache = 8;
+
+/** Default for -blockfilterindex */
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+
+/**
+ * The index of the basic filter (see BlockFilter) of every block, with the
+ * chain of filter headers, kept in a database of its own under
+ * indexes/blockfilter/basic. The entries are keyed by block hash and are left
+ * in place when a block is disconnected, since the filter of a block never
+ * changes; the header of a block commits to the headers of its ancestors only.
+ */
+class CBlockFilterIndex : public CBaseIndexer
+{
+public:
+    explicit CBlockFilterIndex(BlockFilterType filterTypeIn, bool fMemory = false, bool fWipe = false);
+    ~CBlockFilterIndex();
+
+    BlockFilterType GetFilterType() const { return filterType; }
+
+    /** Get the filter of an indexed block; false if the block was not indexed */
+    bool LookupFilter(const CBlockIndex* pindex, BlockFilter& filter) const;
+
+    /** Get the filter header of an indexed block; false if the block was not indexed */
+    bool LookupFilterHeader(const CBlockIndex* pindex, uint256& header) const;
+
+protected:
+    struct FilterEntries : public BlockEntries
+    {
+        uint256 hashPrevBlock;
+        BlockFilter filter;
+    };
+
+    bool BuildEntries(const CBlockIndex* pindex, const CBlock& block, bool fConnect, std::unique_ptr<BlockEntries>& entries) override;
+    bool WriteEntries(CDBBatch& batch, const BlockEntries& entries, bool fConnect) override;
+
+    CDBWrapper& GetDB() override { return db; }
+
+    bool ReadBestBlock(CBlockLocator& locator) override;
+    void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator) override;
+
+private:
+    const BlockFilterType filterType;
+    CDBWrapper db;
+
+    // the header of the last block written, which is usually the parent of the
+    // next one, whose entry may still be in an uncommitted batch. Only used by
+    // the indexer thread
+    uint256 hashLastBlock;
+    uint256 headerLast;
+};
+
+/** The block filter index, when enabled. Protected by cs_main */
+extern std::unique_ptr<CBlockFilterIndex> g_blockfilterindex;
+
+#endif // PAICOIN_BLOCKFILTERINDEX_H
@@ -109,8 +109,8 @@ public:
 class SaltedOutpointHasher
 {
 private:
-    /** Salt */
-    const uint64_t k0, k1;
+    /** Salt; not const so that coins maps can be swapped */
+    uint64_t k0, k1;
 
 public:
     SaltedOutpointHasher();
@@ -279,6 +279,14 @@ public:
      */
     void AddCoin(const COutPoint& outpoint, Coin&& coin, bool potential_overwrite);
 
+    /**
+     * Add an unspent coin that was read from the backing view by someone else
+     * (e.g. a prefetch thread), exactly as if it had been fetched by this
+     * cache. Nothing is done if the outpoint is already cached. The coin must
+     * reflect the current state of the backing view.
+     */
+    void EmplaceBaseCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
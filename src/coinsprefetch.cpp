@@ -0,0 +1,272 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#include "coinsprefetch.h"
+
+#include "blockcache.h"
+#include "chainparams.h"
+#include "stake/staketx.h"
+#include "util.h"
+#include "validation.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include <boost/thread/thread.hpp>
+
+CCoinsPrefetcher coinsPrefetcher;
+
+CCoinsPrefetcher::CCoinsPrefetcher() : nWorking(0), nThreads(0), nDepth(DEFAULT_COINS_PREFETCH_DEPTH), nTimeRead(0), nTimeFetch(0), nTimeWait(0)
+{
+}
+
+std::list<std::shared_ptr<CCoinsPrefetcher::Job>>::iterator CCoinsPrefetcher::Find(const uint256& hash)
+{
+    return std::find_if(jobs.begin(), jobs.end(), [&hash](const std::shared_ptr<Job>& job) { return job->hash == hash; });
+}
+
+void CCoinsPrefetcher::Enqueue(const std::shared_ptr<Job>& job)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (Find(job->hash) != jobs.end())
+        return;
+
+    jobs.push_back(job);
+
+    // forget the oldest blocks that were never applied, e.g. because they
+    // were not connected after all, leaving the ones being worked on
+    for (auto it = jobs.begin(); jobs.size() > MAX_JOBS && it != jobs.end();) {
+        if (!(*it)->IsStarted() || (*it)->IsDone())
+            it = jobs.erase(it);
+        else
+            ++it;
+    }
+
+    condWorker.notify_all();
+}
+
+void CCoinsPrefetcher::Prefetch(CCoinsView* pbase, const std::shared_ptr<const CBlock>& pblock)
+{
+    if (nThreads == 0 || !pbase || !pblock)
+        return;
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->hash = pblock->GetHash();
+    job->pblock = pblock;
+    job->pbase = pbase;
+    Enqueue(job);
+}
+
+void CCoinsPrefetcher::Prefetch(CCoinsView* pbase, const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+
+    if (nThreads == 0 || !pbase || !(pindex->nStatus & BLOCK_HAVE_DATA))
+        return;
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->hash = pindex->GetBlockHash();
+    job->pos = pindex->GetBlockPos();
+    job->pblock = blockCache.Get(job->hash);
+    job->pbase = pbase;
+    Enqueue(job);
+}
+
+bool CCoinsPrefetcher::Prepare(Job& job)
+{
+    if (!job.pblock)
+        job.pblock = blockCache.Get(job.hash);
+    if (!job.pblock) {
+        int64_t nTimeStart = GetTimeMicros();
+        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+        if (!ReadBlockFromDisk(*pblockRead, job.pos, Params().GetConsensus()) || pblockRead->GetHash() != job.hash)
+            return false;
+        blockCache.Insert(pblockRead);
+        job.pblock = pblockRead;
+        nTimeRead += GetTimeMicros() - nTimeStart;
+    }
+
+    // the coins can only be trusted to reflect this state of the database
+    job.hashBaseBlock = job.pbase->GetBestBlock();
+    if (job.hashBaseBlock.IsNull())
+        return false; // the database is being flushed
+
+    // outputs created in the block itself cannot be in the database
+    std::unordered_set<uint256, BlockHasher> setBlockTxids;
+    for (const auto& tx : job.pblock->vtx)
+        setBlockTxids.insert(tx->GetHash());
+
+    for (const auto& tx : job.pblock->vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        const unsigned startInput = ParseTxClass(*tx) == TX_Vote ? voteStakeInputIndex : 0;    // first input in a vote is subsidy generation; skip it
+        for (unsigned i = startInput; i < tx->vin.size(); ++i) {
+            const COutPoint& prevout = tx->vin[i].prevout;
+            if (!setBlockTxids.count(prevout.hash))
+                job.vOutpoints.push_back(prevout);
+        }
+    }
+
+    return true;
+}
+
+void CCoinsPrefetcher::Thread()
+{
+    while (true) {
+        std::shared_ptr<Job> job;
+        bool fPrepare = false;
+        size_t nBegin = 0, nEnd = 0;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!job) {
+                // blocks are served in the order they were queued: the
+                // inputs of the oldest block are fetched first
+                for (const auto& j : jobs) {
+                    if (!j->IsStarted()) {
+                        j->fPreparing = true;
+                        job = j;
+                        fPrepare = true;
+                        break;
+                    }
+                    if (j->fPrepared && j->nNextOutpoint < j->vOutpoints.size()) {
+                        nBegin = j->nNextOutpoint;
+                        nEnd = std::min(nBegin + BATCH_SIZE, j->vOutpoints.size());
+                        j->nNextOutpoint = nEnd;
+                        ++j->nBatchesRunning;
+                        job = j;
+                        break;
+                    }
+                }
+                if (!job) {
+                    try {
+                        condWorker.wait(lock);
+                    } catch (const boost::thread_interrupted&) {
+                        // nobody may be left to finish the queued blocks
+                        for (const auto& j : jobs)
+                            j->fFailed = true;
+                        condDone.notify_all();
+                        throw;
+                    }
+                }
+            }
+            ++nWorking;
+        }
+
+        if (fPrepare) {
+            const bool fPrepared = Prepare(*job);
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            job->fPreparing = false;
+            job->fPrepared = fPrepared;
+            job->fFailed |= !fPrepared;
+            --nWorking;
+            condWorker.notify_all();
+            condDone.notify_all();
+            continue;
+        }
+
+        int64_t nTimeStart = GetTimeMicros();
+        std::vector<std::pair<COutPoint, Coin>> vCoins;
+        vCoins.reserve(nEnd - nBegin);
+        for (size_t i = nBegin; i < nEnd; ++i) {
+            Coin coin;
+            if (job->pbase->GetCoin(job->vOutpoints[i], coin))
+                vCoins.emplace_back(job->vOutpoints[i], std::move(coin));
+        }
+        nTimeFetch += GetTimeMicros() - nTimeStart;
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::move(vCoins.begin(), vCoins.end(), std::back_inserter(job->vCoins));
+        --job->nBatchesRunning;
+        --nWorking;
+        condDone.notify_all();
+    }
+}
+
+std::shared_ptr<const CBlock> CCoinsPrefetcher::GetBlock(const uint256& hash)
+{
+    AssertLockHeld(cs_main);
+
+    if (nThreads == 0)
+        return nullptr;
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    auto it = Find(hash);
+    if (it == jobs.end() || !(*it)->IsStarted())
+        return nullptr;
+
+    std::shared_ptr<Job> job = *it;
+    if (job->fPreparing) {
+        int64_t nTimeStart = GetTimeMicros();
+        boost::this_thread::disable_interruption di;
+        while (job->fPreparing)
+            condDone.wait(lock);
+        nTimeWait += GetTimeMicros() - nTimeStart;
+    }
+    return job->fPrepared ? job->pblock : nullptr;
+}
+
+void CCoinsPrefetcher::Apply(const uint256& hash, CCoinsView* pbase, CCoinsViewCache& cache)
+{
+    AssertLockHeld(cs_main);
+
+    if (nThreads == 0)
+        return;
+
+    std::shared_ptr<Job> job;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        auto it = Find(hash);
+        if (it == jobs.end())
+            return;
+
+        job = *it;
+        if (!job->IsStarted()) {
+            // not worth waiting for; ConnectBlock fetches the coins itself
+            jobs.erase(it);
+            return;
+        }
+
+        // the validation thread must not be interrupted here
+        int64_t nTimeStart = GetTimeMicros();
+        boost::this_thread::disable_interruption di;
+        while (!job->IsDone())
+            condDone.wait(lock);
+        nTimeWait += GetTimeMicros() - nTimeStart;
+
+        it = Find(hash);
+        if (it != jobs.end())
+            jobs.erase(it);
+    }
+
+    // coins read before the database was last flushed may be outdated
+    if (job->fFailed || job->pbase != pbase || job->hashBaseBlock != pbase->GetBestBlock()) {
+        LogPrint(BCLog::BENCH, "    - Prefetched coins discarded for block %s\n", hash.ToString());
+        return;
+    }
+
+    for (auto& entry : job->vCoins)
+        cache.EmplaceBaseCoin(entry.first, std::move(entry.second));
+    LogPrint(BCLog::BENCH, "    - Prefetched %u of %u coins for block %s\n", (unsigned int)job->vCoins.size(), (unsigned int)job->vOutpoints.size(), hash.ToString());
+}
+
+void CCoinsPrefetcher::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    for (const auto& job : jobs)
+        job->fFailed = true;
+    jobs.clear();
+    condDone.notify_all();
+
+    boost::this_thread::disable_interruption di;
+    while (nWorking > 0)
+        condDone.wait(lock);
+}
+
+void ThreadCoinsPrefetch()
+{
+    RenameThread("paicoin-prefetch");
+    coinsPrefetcher.Thread();
+}
@@ -0,0 +1,147 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#ifndef PAICOIN_COINSPREFETCH_H
+#define PAICOIN_COINSPREFETCH_H
+
+#include "chain.h"
+#include "coins.h"
+#include "primitives/block.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** Default for -coinsprefetchthreads, the number of threads warming the coins cache ahead of ConnectBlock */
+static const int DEFAULT_COINS_PREFETCH_THREADS = 2;
+/** Maximum number of coins prefetch threads */
+static const int MAX_COINS_PREFETCH_THREADS = 16;
+/** Default for -coinsprefetchdepth, the number of blocks ahead of the tip read in the background */
+static const int DEFAULT_COINS_PREFETCH_DEPTH = 8;
+/** Maximum -coinsprefetchdepth; ActivateBestChainStep looks at most this many blocks ahead */
+static const int MAX_COINS_PREFETCH_DEPTH = 32;
+
+// CCoinsPrefetcher reads the coins spent by a block from the coins database on
+// worker threads, before the block is connected. ConnectBlock looks every input
+// up serially on the validation thread, and with a small -dbcache most of those
+// lookups miss the cache and go to LevelDB one at a time; with the coins
+// already fetched, connecting the block only hits memory.
+//
+// Blocks are queued when they arrive and when they are among the next ones to
+// be connected, so that during the initial block download and reindexing the
+// blocks ahead of the tip are read from disk and deserialized (which also
+// computes their transaction hashes) and their coins fetched while the tip
+// connects; ConnectTip then takes both the block and its coins from here. The
+// inputs of a block are split in batches that are looked up by all the worker
+// threads in parallel. The stake inputs are included: the ticket spent by each
+// revocation and by each vote (whose first input is the stake base, which
+// spends nothing).
+//
+// The fetched coins only reflect the database as of the best block it had when
+// they were read, so they are discarded when the database was flushed in the
+// meantime, and they never replace coins already in the cache, which are newer.
+class CCoinsPrefetcher
+{
+public:
+    CCoinsPrefetcher();
+
+    // queue the prefetch of the coins spent by the given block
+    void Prefetch(CCoinsView* pbase, const std::shared_ptr<const CBlock>& pblock);
+
+    // queue the prefetch of the coins spent by the block stored for the given index;
+    // the block is read from disk by a worker thread. cs_main must be held.
+    void Prefetch(CCoinsView* pbase, const CBlockIndex* pindex);
+
+    // the block read by the workers for the given hash, waiting for the read if
+    // it is in progress; nullptr if it was not queued, not started or failed.
+    // cs_main must be held.
+    std::shared_ptr<const CBlock> GetBlock(const uint256& hash);
+
+    // move the coins prefetched for the block into the cache, which must be
+    // backed by pbase. Waits for the prefetch if it is in progress, but does
+    // not wait for one that has not started. cs_main must be held.
+    void Apply(const uint256& hash, CCoinsView* pbase, CCoinsViewCache& cache);
+
+    // drop all the queued and fetched blocks, waiting for the workers to leave
+    // the ones in progress. Must be called before the base views are destroyed.
+    void Clear();
+
+    // the loop of a worker thread; returns when the thread is interrupted
+    void Thread();
+
+    // the number of worker threads, set before starting them; with no workers
+    // nothing is queued
+    void SetThreads(int nThreadsIn) { nThreads = nThreadsIn; }
+    int GetThreads() const { return nThreads; }
+
+    // the number of blocks ahead of the one connecting to be queued
+    void SetDepth(int nDepthIn) { nDepth = nDepthIn; }
+    int GetDepth() const { return nThreads > 0 ? nDepth : 0; }
+
+    // cumulative time spent by the workers reading and deserializing blocks
+    // and fetching coins, and by the validation thread waiting for them, in
+    // microseconds
+    int64_t GetTimeRead() const { return nTimeRead; }
+    int64_t GetTimeFetch() const { return nTimeFetch; }
+    int64_t GetTimeWait() const { return nTimeWait; }
+
+private:
+    // number of inputs looked up by a worker at a time
+    static const size_t BATCH_SIZE = 64;
+    // number of blocks kept, queued or fetched, before the oldest are dropped
+    static const size_t MAX_JOBS = 2 * MAX_COINS_PREFETCH_DEPTH;
+
+    struct Job
+    {
+        uint256 hash;
+        CDiskBlockPos pos;
+        std::shared_ptr<const CBlock> pblock;
+        CCoinsView* pbase;
+
+        // set once the block is loaded and its inputs listed
+        bool fPrepared = false;
+        bool fPreparing = false;
+        bool fFailed = false;
+        uint256 hashBaseBlock;
+        std::vector<COutPoint> vOutpoints;
+        size_t nNextOutpoint = 0;
+        int nBatchesRunning = 0;
+
+        std::vector<std::pair<COutPoint, Coin>> vCoins;
+
+        bool IsStarted() const { return fPreparing || fPrepared; }
+        bool IsDone() const { return fFailed || (fPrepared && nNextOutpoint == vOutpoints.size() && nBatchesRunning == 0); }
+    };
+
+    void Enqueue(const std::shared_ptr<Job>& job);
+    std::list<std::shared_ptr<Job>>::iterator Find(const uint256& hash);
+
+    // load the block of the job and list its inputs; mutex must not be held
+    bool Prepare(Job& job);
+
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+    boost::condition_variable condDone;
+    std::list<std::shared_ptr<Job>> jobs; // oldest first
+    int nWorking; // workers busy outside the mutex
+    int nThreads;
+    int nDepth;
+
+    std::atomic<int64_t> nTimeRead;
+    std::atomic<int64_t> nTimeFetch;
+    std::atomic<int64_t> nTimeWait;
+};
+
+/** The coins prefetcher feeding pcoinsTip */
+extern CCoinsPrefetcher coinsPrefetcher;
+
+/** Run a coins prefetch worker thread */
+void ThreadCoinsPrefetch();
+
+#endif // PAICOIN_COINSPREFETCH_H
@@ -13,7 +13,12 @@
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <algorithm>
+#include <limits>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
 
 class CPAIcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -73,14 +78,83 @@ public:
     }
 };
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+CDBOptions GetDBProfileOptions(DBProfile profile, size_t nCacheSize)
+{
+    CDBOptions dbOptions;
+    dbOptions.nBlockCacheSize = nCacheSize / 2;
+    dbOptions.nWriteBufferSize = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
+    dbOptions.nMaxFileSize = 2 << 20;
+    dbOptions.nMaxOpenFiles = 64;
+    dbOptions.nBloomBits = 10;
+
+    switch (profile) {
+    case DBProfile::DEFAULT:
+        break;
+    case DBProfile::CHAINSTATE:
+        // Coins are looked up all over the key space, so with the few files
+        // kept open most reads would reopen a table; larger tables keep more
+        // of the set reachable through the open files.
+        dbOptions.nMaxFileSize = 8 << 20;
+        break;
+    case DBProfile::BLOCK_INDEX:
+        // Writes are small and synced as they come, while the index lookups
+        // benefit from cached blocks.
+        dbOptions.nBlockCacheSize = nCacheSize * 5 / 8;
+        dbOptions.nWriteBufferSize = nCacheSize / 8;
+        dbOptions.nMaxFileSize = 4 << 20;
+        break;
+    }
+    return dbOptions;
+}
+
+bool ParseDBOptions(const std::string& strOptions, CDBOptions& options, std::string& strError)
+{
+    // the sizes are in MiB, the counts are ints
+    static const int64_t MAX_SIZE_MIB = std::min<uint64_t>(std::numeric_limits<size_t>::max() >> 20, std::numeric_limits<int64_t>::max());
+    static const int64_t MAX_COUNT = std::numeric_limits<int>::max();
+
+    std::vector<std::string> vOptions;
+    boost::split(vOptions, strOptions, boost::is_any_of(","));
+    for (const std::string& strOption : vOptions) {
+        size_t nPos = strOption.find('=');
+        int64_t nValue;
+        if (nPos == std::string::npos || !ParseInt64(strOption.substr(nPos + 1), &nValue) || nValue < 0) {
+            strError = strprintf("invalid database option '%s'", strOption);
+            return false;
+        }
+        const std::string strKey = strOption.substr(0, nPos);
+        const bool fSize = strKey == "blockcache" || strKey == "writebuffer" || strKey == "maxfilesize";
+        if (nValue > (fSize ? MAX_SIZE_MIB : MAX_COUNT)) {
+            strError = strprintf("database option '%s' out of range", strOption);
+            return false;
+        }
+        if (strKey == "blockcache") {
+            options.nBlockCacheSize = static_cast<size_t>(nValue) << 20;
+        } else if (strKey == "writebuffer") {
+            options.nWriteBufferSize = static_cast<size_t>(nValue) << 20;
+        } else if (strKey == "maxfilesize" && nValue > 0) {
+            options.nMaxFileSize = static_cast<size_t>(nValue) << 20;
+        } else if (strKey == "maxopenfiles" && nValue > 0) {
+            options.nMaxOpenFiles = nValue;
+        } else if (strKey == "bloombits") {
+            options.nBloomBits = nValue;
+        } else {
+            strError = strprintf("invalid database option '%s'", strOption);
+            return false;
+        }
+    }
+    return true;
+}
+
+static leveldb::Options GetOptions(const CDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(dbOptions.nBlockCacheSize);
+    options.write_buffer_size = dbOptions.nWriteBufferSize;
+    options.max_file_size = dbOptions.nMaxFileSize;
+    options.filter_policy = dbOptions.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits) : nullptr;
     options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.max_open_files = dbOptions.nMaxOpenFiles;
     options.info_log = new CPAIcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -90,14 +164,19 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate) :
+    CDBWrapper(path, GetDBProfileOptions(DBProfile::DEFAULT, nCacheSize), fMemory, fWipe, obfuscate)
+{
+}
+
+CDBWrapper::CDBWrapper(const fs::path& path, const CDBOptions& dbOptionsIn, bool fMemory, bool fWipe, bool obfuscate) : dbOptions(dbOptionsIn)
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(dbOptions);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -155,6 +234,28 @@ CDBWrapper::~CDBWrapper()
     options.env = nullptr;
 }
 
+bool CDBWrapper::GetStats(CDBStats& stats) const
+{
+    std::string strUsage, strStats;
+    if (!pdb->GetProperty("leveldb.approximate-memory-usage", &strUsage) || !pdb->GetProperty("leveldb.stats", &strStats))
+        return false;
+
+    stats.nMemoryUsage = atoi64(strUsage);
+    stats.nBlockCacheUsage = options.block_cache->TotalCharge();
+
+    // the compaction statistics are only exposed as a table, one level per line
+    // after a three line header
+    stats.vLevels.clear();
+    std::vector<std::string> vLines;
+    boost::split(vLines, strStats, boost::is_any_of("\n"));
+    for (size_t i = 3; i < vLines.size(); ++i) {
+        CDBStats::Level level;
+        if (sscanf(vLines[i].c_str(), "%d %d %lf %lf %lf %lf", &level.nLevel, &level.nFiles, &level.dSize, &level.dCompactionTime, &level.dCompactionRead, &level.dCompactionWrite) == 6)
+            stats.vLevels.push_back(level);
+    }
+    return true;
+}
+
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
@@ -192,7 +293,9 @@ bool CDBWrapper::IsEmpty()
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() const { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
+void CDBIterator::SeekToLast() { piter->SeekToLast(); }
 void CDBIterator::Next() { piter->Next(); }
+void CDBIterator::Prev() { piter->Prev(); }
 
 namespace dbwrapper_private {
 
@@ -25,6 +25,61 @@ public:
     explicit dbwrapper_error(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+/** LevelDB settings of a database */
+struct CDBOptions
+{
+    //! memory for the LRU cache of uncompressed table blocks
+    size_t nBlockCacheSize;
+    //! memory for the write buffer; up to two may be held in memory simultaneously
+    size_t nWriteBufferSize;
+    //! size of the table files written by compactions
+    size_t nMaxFileSize;
+    //! number of table files kept open
+    int nMaxOpenFiles;
+    //! bits per key of the bloom filter, 0 for none
+    int nBloomBits;
+};
+
+/** Access patterns of the databases, each with its own LevelDB settings */
+enum class DBProfile
+{
+    //! the settings used for every database before profiles
+    DEFAULT,
+    //! chainstate/: random point reads of small coins, large flushes
+    CHAINSTATE,
+    //! blocks/index/: read in full at startup, small synced writes, point reads of the indexes
+    BLOCK_INDEX,
+};
+
+/** The settings of a database with the given profile, spending nCacheSize bytes of memory */
+CDBOptions GetDBProfileOptions(DBProfile profile, size_t nCacheSize);
+
+/**
+ * Override settings from a comma separated list of key=value pairs, with the
+ * keys blockcache, writebuffer and maxfilesize in MiB, maxopenfiles and
+ * bloombits. Returns false on a malformed list or an out of range value.
+ */
+bool ParseDBOptions(const std::string& strOptions, CDBOptions& options, std::string& strError);
+
+/** Statistics LevelDB keeps about a database */
+struct CDBStats
+{
+    struct Level
+    {
+        int nLevel;
+        int nFiles;
+        double dSize;            //!< MiB
+        double dCompactionTime;  //!< seconds
+        double dCompactionRead;  //!< MiB
+        double dCompactionWrite; //!< MiB
+    };
+
+    //! memory used by the block cache and the write buffers
+    size_t nMemoryUsage;
+    size_t nBlockCacheUsage;
+    std::vector<Level> vLevels;
+};
+
 class CDBWrapper;
 
 /** These should be considered an implementation detail of the specific database.
@@ -133,6 +188,7 @@ public:
     bool Valid() const;
 
     void SeekToFirst();
+    void SeekToLast();
 
     template<typename K> void Seek(const K& key) {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
@@ -143,6 +199,7 @@ public:
     }
 
     void Next();
+    void Prev();
 
     template<typename K> bool GetKey(K& key) {
         leveldb::Slice slKey = piter->key();
@@ -183,6 +240,9 @@ private:
     //! database options used
     leveldb::Options options;
 
+    //! the settings the options were made from
+    CDBOptions dbOptions;
+
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
@@ -219,8 +279,19 @@ public:
      *                        with a zero'd byte array.
      */
     CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    /**
+     * @param[in] dbOptions   The LevelDB settings, usually those of a DBProfile.
+     */
+    CDBWrapper(const fs::path& path, const CDBOptions& dbOptions, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
     ~CDBWrapper();
 
+    const CDBOptions& GetDBOptions() const { return dbOptions; }
+
+    /**
+     * Read the statistics LevelDB keeps about the database.
+     */
+    bool GetStats(CDBStats& stats) const;
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
@@ -11,6 +11,7 @@
 #include <chainparams.h>
 #include <httpserver.h>
 #include <key_io.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <random.h>
@@ -84,6 +85,8 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
 
     const auto strReply = JSONRPCReply(NullUniValue, objError, id);
 
+    // the part of a result already written is dropped
+    req->DiscardReplyChunks();
     req->WriteHeader("Content-Type", "application/json");
     req->WriteReply(eStatus, strReply);
 }
@@ -189,14 +192,26 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // the result may be written straight into the reply, as it is built
+            JSONStreamWriter stream([req](const std::string& chunk) { req->WriteReplyChunk(chunk); }, "{\"result\":");
+            jreq.stream = &stream;
             const auto result = tableRPC.execute(jreq);
+            jreq.stream = nullptr;
+
+            if (stream.HasOutput()) {
+                stream.WriteRaw(",\"error\":null,\"id\":" + jreq.id.write() + "}\n");
+                stream.Flush();
+                req->WriteHeader("Content-Type", "application/json");
+                req->WriteReply(HTTPStatusCode::OK);
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            strReply = JSONRPCExecBatch(jreq, valRequest.get_array(), QueueHTTPTask);
         else
             throw JSONRPCError(RPCErrorCode::PARSE_ERROR, "Top-level object parse error");
 
@@ -65,6 +65,22 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Task work item, queued by the request handlers */
+class HTTPTaskItem final : public HTTPClosure
+{
+public:
+    explicit HTTPTaskItem(const std::function<void()>& _task): task(_task)
+    {
+    }
+    void operator()() override
+    {
+        task();
+    }
+
+private:
+    std::function<void()> task;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -526,6 +542,17 @@ void StopHTTPServer()
     LogPrint(BCLog::HTTP, "Stopped HTTP server\n");
 }
 
+bool QueueHTTPTask(const std::function<void()>& task)
+{
+    if (!workQueue)
+        return false;
+    std::unique_ptr<HTTPTaskItem> item(new HTTPTaskItem(task));
+    if (!workQueue->Enqueue(item.get()))
+        return false;
+    item.release(); /* if true, queue took ownership */
+    return true;
+}
+
 struct event_base* EventBase()
 {
     return eventBase;
@@ -641,6 +668,23 @@ void HTTPRequest::WriteReply(HTTPStatusCode eStatus, const std::string& strReply
     req = nullptr; // transferred back to main thread
 }
 
+void HTTPRequest::WriteReplyChunk(const std::string& chunk)
+{
+    assert(!replySent && req);
+    // the output buffer is only used by the main http thread once the reply is sent
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+}
+
+void HTTPRequest::DiscardReplyChunks()
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_drain(evb, evbuffer_get_length(evb));
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
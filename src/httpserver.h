@@ -37,6 +37,12 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Queue a task on the work queue of the HTTP worker threads.
+ * Returns false if the queue is full or the server is not running, in which
+ * case the task is not run.
+ */
+bool QueueHTTPTask(const std::function<void()>& task);
+
 /** Change logging level for libevent. Removes BCLog::LIBEVENT from logCategories if
  * libevent doesn't support debug logging.*/
 bool UpdateHTTPServerLogging(bool enable);
@@ -119,6 +125,17 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(HTTPStatusCode eStatus, const std::string& strReply = "");
+
+    /**
+     * Append a chunk to the body of the reply, which is sent by WriteReply after
+     * the chunks. This lets a huge reply be written while it is built.
+     */
+    void WriteReplyChunk(const std::string& chunk);
+
+    /**
+     * Discard the chunks written so far, for instance to send an error instead.
+     */
+    void DiscardReplyChunks();
 };
 
 /** Event handler closure.
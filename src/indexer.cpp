@@ -0,0 +1,497 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#include "indexer.h"
+
+#include "blockcache.h"
+#include "blockfilterindex.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "init.h"
+#include "stake/staketx.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "undo.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <algorithm>
+#include <set>
+
+std::unique_ptr<CBaseIndexer> g_txindex;
+std::unique_ptr<CBaseIndexer> g_addrindex;
+
+CBaseIndexer::CBaseIndexer(const std::string& strNameIn) : strName(strNameIn), pindexBest(nullptr), fNotified(false), fStop(false)
+{
+    nThreads = std::max(1, std::min(GetNumCores(), MAX_INDEXER_THREADS));
+}
+
+CBaseIndexer::~CBaseIndexer()
+{
+    Stop();
+}
+
+bool CBaseIndexer::Start()
+{
+    CBlockLocator locator;
+    if (!ReadBestBlock(locator))
+        return error("%s: failed to read the best block of the %s", __func__, strName);
+
+    LOCK(cs_main);
+    if (!locator.IsNull()) {
+        BlockMap::iterator it = mapBlockIndex.find(locator.vHave[0]);
+        pindexBest = it != mapBlockIndex.end() ? it->second : FindForkInGlobalIndex(chainActive, locator);
+    }
+    LogPrintf("%s: %s starting at height %d\n", __func__, strName, pindexBest ? pindexBest.load()->nHeight : -1);
+
+    RegisterValidationInterface(this);
+    thread = boost::thread(&TraceThread<std::function<void()>>, strName.c_str(), [this] { Thread(); });
+    return true;
+}
+
+void CBaseIndexer::Stop()
+{
+    if (!thread.joinable())
+        return;
+
+    {
+        // the signals are sent with cs_main held
+        LOCK(cs_main);
+        UnregisterValidationInterface(this);
+    }
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+        condNotify.notify_all();
+    }
+    thread.join();
+}
+
+bool CBaseIndexer::IsSynced() const
+{
+    AssertLockHeld(cs_main);
+    return pindexBest == chainActive.Tip();
+}
+
+void CBaseIndexer::Notify()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fNotified = true;
+    condNotify.notify_all();
+}
+
+void CBaseIndexer::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    Notify();
+}
+
+void CBaseIndexer::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock)
+{
+    Notify();
+}
+
+bool CBaseIndexer::BuildBlock(const CBlockIndex* pindex, bool fConnect, std::unique_ptr<BlockEntries>& entries)
+{
+    // blocks read while catching up are not added to the block cache, to keep
+    // the recent blocks there
+    std::shared_ptr<const CBlock> pblock = blockCache.Get(pindex->GetBlockHash());
+    if (!pblock) {
+        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+        if (!ReadBlockFromDisk(*pblockRead, pindex, Params().GetConsensus()))
+            return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        pblock = pblockRead;
+    }
+    return BuildEntries(pindex, *pblock, fConnect, entries);
+}
+
+bool CBaseIndexer::Commit(CDBBatch& batch, const CBlockIndex* pindexNew)
+{
+    {
+        LOCK(cs_main);
+        WriteBestBlock(batch, chainActive.GetLocator(pindexNew));
+    }
+    if (!GetDB().WriteBatch(batch, true))
+        return false;
+    pindexBest = pindexNew;
+    return true;
+}
+
+bool CBaseIndexer::ConnectBlocks(const std::vector<const CBlockIndex*>& vpindex)
+{
+    std::vector<std::unique_ptr<BlockEntries>> vEntries(vpindex.size());
+    std::atomic<size_t> nNext(0);
+    std::atomic<bool> fFailed(false);
+
+    auto worker = [&]() {
+        for (size_t i = nNext++; i < vpindex.size() && !fFailed && !fStop; i = nNext++) {
+            if (!BuildBlock(vpindex[i], true, vEntries[i]))
+                fFailed = true;
+        }
+    };
+
+    // the calling thread is one of the workers
+    boost::thread_group workers;
+    const int nWorkers = std::min((int)vpindex.size(), nThreads);
+    for (int i = 1; i < nWorkers; ++i)
+        workers.create_thread(worker);
+    worker();
+    workers.join_all();
+
+    if (fFailed)
+        return false;
+    if (fStop)
+        return true;
+
+    CDBBatch batch(GetDB());
+    for (const auto& entries : vEntries) {
+        if (entries && !WriteEntries(batch, *entries, true))
+            return false;
+    }
+    return Commit(batch, vpindex.back());
+}
+
+bool CBaseIndexer::DisconnectBestBlock()
+{
+    const CBlockIndex* pindex = pindexBest;
+    std::unique_ptr<BlockEntries> entries;
+    if (!BuildBlock(pindex, false, entries))
+        return false;
+
+    CDBBatch batch(GetDB());
+    if (entries && !WriteEntries(batch, *entries, false))
+        return false;
+    return Commit(batch, pindex->pprev);
+}
+
+void CBaseIndexer::Thread()
+{
+    int64_t nLastLog = GetTime();
+    bool fSynced = false;
+
+    while (!fStop) {
+        std::vector<const CBlockIndex*> vpindex;
+        bool fDisconnect = false;
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindex = pindexBest;
+            if (pindex && !chainActive.Contains(pindex)) {
+                fDisconnect = true;
+            } else {
+                for (pindex = pindex ? chainActive.Next(pindex) : chainActive.Genesis(); pindex && vpindex.size() < INDEXER_BATCH_SIZE; pindex = chainActive.Next(pindex))
+                    vpindex.push_back(pindex);
+            }
+        }
+
+        if (!fDisconnect && vpindex.empty()) {
+            if (!fSynced && pindexBest) {
+                LogPrintf("%s is enabled at height %d\n", strName, pindexBest.load()->nHeight);
+                fSynced = true;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fNotified && !fStop)
+                condNotify.wait(lock);
+            fNotified = false;
+            continue;
+        }
+
+        if (fDisconnect ? !DisconnectBestBlock() : !ConnectBlocks(vpindex)) {
+            LogPrintf("*** Failed to write the %s\n", strName);
+            uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+            return;
+        }
+
+        if (!fSynced && GetTime() - nLastLog >= 30) {
+            LogPrintf("Syncing %s with block chain from height %d\n", strName, pindexBest.load()->nHeight);
+            nLastLog = GetTime();
+        }
+    }
+}
+
+// Index either: a) every data push >=8 bytes,  b) if no such pushes, the entire script
+static void GetAddrIndexIds(const CScript &script, std::set<uint160> &setAddrIds)
+{
+    CScript::const_iterator pc = script.begin();
+    CScript::const_iterator pend = script.end();
+    std::vector<unsigned char> data;
+    opcodetype opcode;
+    bool fHaveData = false;
+    while (pc < pend) {
+        script.GetOp(pc, opcode, data);
+        if (0 <= opcode && opcode <= OP_PUSHDATA4 && data.size() >= 8) { // data element
+            uint160 addrid;
+            if (data.size() <= 20) {
+                memcpy(&addrid, &data[0], data.size());
+            } else {
+                addrid = Hash160(data);
+            }
+            setAddrIds.insert(addrid);
+            fHaveData = true;
+        }
+    }
+    if (!fHaveData) {
+        setAddrIds.insert(Hash160(script));
+    }
+}
+
+/** Collect the changes connecting a block makes to the address index. The coins
+ *  spent by the block are taken from its undo data. With fOnlyRegular, only the
+ *  transactions DisconnectBlock() reverts for a disapproved block are included. */
+static void BuildAddrIndexDelta(const CBlock& block, const CBlockIndex* pindex, const CBlockUndo& blockundo, bool fOnlyRegular, CAddrIndexDelta& delta)
+{
+    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+    for (uint32_t i = 0; i < block.vtx.size(); pos.nTxOffset += ::GetSerializeSize(*block.vtx[i], SER_DISK, CLIENT_VERSION), ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const ETxClass txClass = ParseTxClass(tx);
+        if (fOnlyRegular && !tx.IsCoinBase() && txClass != TX_Regular)
+            continue;
+
+        std::set<uint160> setTxAddrIds;
+        if (!tx.IsCoinBase()) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            const unsigned startInput = txClass == TX_Vote ? voteStakeInputIndex : 0;    // first input in a vote is subsidy generation; skip it
+            for (unsigned j = startInput; j < tx.vin.size(); ++j) {
+                const Coin& coin = txundo.vprevout[j - startInput];
+                std::set<uint160> setAddrIds;
+                GetAddrIndexIds(coin.out.scriptPubKey, setAddrIds);
+                for (const uint160& addrid : setAddrIds) {
+                    CAddrIndexOutValue value(coin.out.nValue, coin.nHeight);
+                    value.spendingTxid = tx.GetHash();
+                    value.nSpendingHeight = pindex->nHeight;
+                    delta.vSpent.emplace_back(CAddrIndexOutKey(addrid, tx.vin[j].prevout), value);
+                }
+                setTxAddrIds.insert(setAddrIds.begin(), setAddrIds.end());
+            }
+        }
+        for (uint32_t o = 0; o < tx.vout.size(); ++o) {
+            const CTxOut& txout = tx.vout[o];
+            std::set<uint160> setAddrIds;
+            GetAddrIndexIds(txout.scriptPubKey, setAddrIds);
+            if (!txout.scriptPubKey.IsUnspendable()) {
+                for (const uint160& addrid : setAddrIds)
+                    delta.vCreated.emplace_back(CAddrIndexOutKey(addrid, COutPoint(tx.GetHash(), o)), CAddrIndexOutValue(txout.nValue, pindex->nHeight));
+            }
+            setTxAddrIds.insert(setAddrIds.begin(), setAddrIds.end());
+        }
+        for (const uint160& addrid : setTxAddrIds)
+            delta.vTxs.emplace_back(CAddrIndexTxKey(addrid, pindex->nHeight, i), pos);
+    }
+}
+
+static bool ReadBlockUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& blockundo)
+{
+    if (!UndoReadFromDisk(blockundo, pindex->GetUndoPos(), pindex->pprev->GetBlockHash()))
+        return error("%s: failure reading undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+    return true;
+}
+
+/** The transaction index maps the hash of each transaction in the chain to its
+ *  position in the block files. Disconnected transactions are left in place. */
+class CTxIndexer : public CBaseIndexer
+{
+public:
+    CTxIndexer() : CBaseIndexer("txindex") {}
+
+protected:
+    struct TxEntries : public BlockEntries
+    {
+        std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+    };
+
+    bool BuildEntries(const CBlockIndex* pindex, const CBlock& block, bool fConnect, std::unique_ptr<BlockEntries>& entries) override
+    {
+        // ConnectBlock skips the genesis block, whose outputs are not spendable
+        if (!fConnect || pindex->pprev == nullptr)
+            return true;
+
+        std::unique_ptr<TxEntries> txEntries(new TxEntries());
+        txEntries->vPos.reserve(block.vtx.size());
+        CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+        for (const auto& tx : block.vtx) {
+            txEntries->vPos.emplace_back(tx->GetHash(), pos);
+            pos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
+        }
+        entries = std::move(txEntries);
+        return true;
+    }
+
+    bool WriteEntries(CDBBatch& batch, const BlockEntries& entries, bool fConnect) override
+    {
+        pblocktree->WriteTxIndex(batch, static_cast<const TxEntries&>(entries).vPos);
+        return true;
+    }
+
+    CDBWrapper& GetDB() override { return *pblocktree; }
+
+    bool ReadBestBlock(CBlockLocator& locator) override
+    {
+        if (pblocktree->ReadIndexBestBlock(GetName(), locator))
+            return true;
+
+        // the index used to be written by ConnectBlock, up to the chain tip;
+        // it is adopted once, replacing the old flag with the best block
+        bool fIndexed = false;
+        if (!pblocktree->ReadFlag("txindex", fIndexed))
+            return true;
+
+        CDBBatch batch(*pblocktree);
+        if (fIndexed) {
+            LOCK(cs_main);
+            locator = chainActive.GetLocator();
+            WriteBestBlock(batch, locator);
+        }
+        pblocktree->EraseFlag(batch, "txindex");
+        return pblocktree->WriteBatch(batch, true);
+    }
+
+    void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator) override
+    {
+        pblocktree->WriteIndexBestBlock(batch, GetName(), locator);
+    }
+};
+
+/** The address index records the transactions involving each address and the
+ *  outputs paying to it (see CAddrIndexDelta). A block disapproved by its child
+ *  has its regular transactions removed while the child is connected. */
+class CAddrIndexer : public CBaseIndexer
+{
+public:
+    CAddrIndexer() : CBaseIndexer("addrindex") {}
+
+protected:
+    struct AddrEntries : public BlockEntries
+    {
+        CAddrIndexDelta delta;
+        // the regular transactions of the parent, when the block disapproves it
+        CAddrIndexDelta deltaDisapproved;
+    };
+
+    bool BuildEntries(const CBlockIndex* pindex, const CBlock& block, bool fConnect, std::unique_ptr<BlockEntries>& entries) override
+    {
+        // the genesis block has no undo data, its outputs are not spendable
+        if (pindex->pprev == nullptr)
+            return true;
+
+        std::unique_ptr<AddrEntries> addrEntries(new AddrEntries());
+
+        CBlockUndo blockundo;
+        if (!ReadBlockUndo(block, pindex, blockundo))
+            return false;
+        BuildAddrIndexDelta(block, pindex, blockundo, false, addrEntries->delta);
+
+        const CBlockIndex* pindexParent = pindex->pprev;
+        if (pindex->nHeight > 1 && !pindex->nVoteBits.isRttAccepted()) {
+            std::shared_ptr<const CBlock> pblockParent;
+            CBlockUndo blockundoParent;
+            if (!ReadBlockFromDiskCached(pblockParent, pindexParent, Params().GetConsensus()) || !ReadBlockUndo(*pblockParent, pindexParent, blockundoParent))
+                return false;
+            BuildAddrIndexDelta(*pblockParent, pindexParent, blockundoParent, true, addrEntries->deltaDisapproved);
+        }
+
+        entries = std::move(addrEntries);
+        return true;
+    }
+
+    bool WriteEntries(CDBBatch& batch, const BlockEntries& entries, bool fConnect) override
+    {
+        const AddrEntries& addrEntries = static_cast<const AddrEntries&>(entries);
+        if (fConnect) {
+            pblocktree->EraseAddrIndex(batch, addrEntries.deltaDisapproved);
+            pblocktree->WriteAddrIndex(batch, addrEntries.delta);
+        } else {
+            pblocktree->EraseAddrIndex(batch, addrEntries.delta);
+            pblocktree->WriteAddrIndex(batch, addrEntries.deltaDisapproved);
+        }
+        return true;
+    }
+
+    CDBWrapper& GetDB() override { return *pblocktree; }
+
+    bool ReadBestBlock(CBlockLocator& locator) override
+    {
+        if (pblocktree->ReadIndexBestBlock(GetName(), locator))
+            return true;
+
+        // the index used to be written by ConnectBlock, keyed by truncated
+        // hashes of the addresses; it is rebuilt from scratch
+        bool fIndexed = false;
+        if (!pblocktree->ReadFlag("addrindex", fIndexed) || !fIndexed)
+            return true;
+
+        LogPrintf("%s: removing the old address index\n", __func__);
+        return pblocktree->EraseLegacyAddrIndex() && pblocktree->WriteFlag("addrindex", false);
+    }
+
+    void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator) override
+    {
+        pblocktree->WriteIndexBestBlock(batch, GetName(), locator);
+    }
+};
+
+// start or stop one of the indexers; pfEnabled, if any, is the flag telling
+// the rest of the node whether the index is enabled
+template <typename Indexer, typename Factory>
+static bool SetIndexerEnabled(const std::string& strName, std::unique_ptr<Indexer>& indexerEnabled, bool* pfEnabled, bool fEnable, Factory factory, std::string& strError)
+{
+    if (fEnable) {
+        if (indexerEnabled)
+            return true;
+        if (fPruneMode) {
+            strError = strprintf(_("Prune mode is incompatible with -%s."), strName);
+            return false;
+        }
+
+        std::unique_ptr<Indexer> indexer(factory());
+        if (!indexer->Start()) {
+            strError = strprintf(_("Error loading the %s"), strName);
+            return false;
+        }
+
+        LOCK(cs_main);
+        indexerEnabled = std::move(indexer);
+        if (pfEnabled)
+            *pfEnabled = true;
+    } else {
+        std::unique_ptr<Indexer> indexer;
+        {
+            LOCK(cs_main);
+            indexer = std::move(indexerEnabled);
+            if (pfEnabled)
+                *pfEnabled = false;
+        }
+        // the best block stays in the database, so that enabling the index
+        // again only catches up with the blocks connected in the meantime
+        if (indexer)
+            indexer->Stop();
+    }
+    return true;
+}
+
+bool SetIndexEnabled(const std::string& strName, bool fEnable, std::string& strError)
+{
+    static CCriticalSection cs_indexers;
+    LOCK(cs_indexers);
+
+    if (strName == "txindex")
+        return SetIndexerEnabled(strName, g_txindex, &fTxIndex, fEnable, [] { return new CTxIndexer(); }, strError);
+    if (strName == "addrindex")
+        return SetIndexerEnabled(strName, g_addrindex, &fAddrIndex, fEnable, [] { return new CAddrIndexer(); }, strError);
+    if (strName == "blockfilterindex")
+        return SetIndexerEnabled(strName, g_blockfilterindex, nullptr, fEnable, [] { return new CBlockFilterIndex(BlockFilterType::BASIC); }, strError);
+
+    strError = strprintf(_("Unknown index: %s"), strName);
+    return false;
+}
+
+void StopIndexers()
+{
+    std::string strError;
+    SetIndexEnabled("txindex", false, strError);
+    SetIndexEnabled("addrindex", false, strError);
+    SetIndexEnabled("blockfilterindex", false, strError);
+}
@@ -0,0 +1,122 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+#ifndef PAICOIN_INDEXER_H
+#define PAICOIN_INDEXER_H
+
+#include "chain.h"
+#include "dbwrapper.h"
+#include "primitives/block.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/** Maximum number of blocks read and written at a time while an index catches up */
+static const size_t INDEXER_BATCH_SIZE = 64;
+/** Maximum number of threads reading the blocks of a batch */
+static const int MAX_INDEXER_THREADS = 8;
+
+// CBaseIndexer builds an optional index of the block chain on a thread of its
+// own, so that connecting a block never waits for index writes.
+//
+// The indexer keeps the locator of the last block it indexed in the database,
+// written in the same batch as the entries of the block, and follows the active
+// chain from there: BlockConnected and BlockDisconnected only wake its thread,
+// which connects the blocks of the active chain it does not have yet and
+// disconnects the ones that left it. When the index is far behind, e.g. because
+// it was just enabled or was disabled for a while, the blocks are read from the
+// block files and their entries built by several threads in parallel, a batch
+// at a time, and written in chain order.
+//
+// Until the indexer reaches the chain tip its index is incomplete; IsSynced()
+// tells the readers whether it can be relied upon.
+class CBaseIndexer : public CValidationInterface
+{
+public:
+    explicit CBaseIndexer(const std::string& strNameIn);
+    virtual ~CBaseIndexer();
+
+    // load the best block of the index and start following the active chain.
+    // cs_main must not be held
+    bool Start();
+
+    // stop following the chain, waiting for the batch being written.
+    // cs_main must not be held
+    void Stop();
+
+    const std::string& GetName() const { return strName; }
+
+    // the last block included in the index, nullptr if none
+    const CBlockIndex* GetBestBlockIndex() const { return pindexBest; }
+
+    // whether the index includes the whole active chain; cs_main must be held
+    bool IsSynced() const;
+
+protected:
+    // what connecting a block adds to the index, or disconnecting it removes
+    struct BlockEntries
+    {
+        virtual ~BlockEntries() {}
+    };
+
+    // build the entries of the block; called on the worker threads, without
+    // cs_main. Leaving entries empty means the block changes nothing
+    virtual bool BuildEntries(const CBlockIndex* pindex, const CBlock& block, bool fConnect, std::unique_ptr<BlockEntries>& entries) = 0;
+
+    // add the entries of a block to the batch; called in chain order
+    virtual bool WriteEntries(CDBBatch& batch, const BlockEntries& entries, bool fConnect) = 0;
+
+    virtual CDBWrapper& GetDB() = 0;
+
+    // the best block stored with the entries; an empty locator if there is none
+    virtual bool ReadBestBlock(CBlockLocator& locator) = 0;
+    virtual void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator) = 0;
+
+    void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
+
+private:
+    void Notify();
+    void Thread();
+
+    // read the block and build its entries
+    bool BuildBlock(const CBlockIndex* pindex, bool fConnect, std::unique_ptr<BlockEntries>& entries);
+    // index the blocks following the best block, which are consecutive
+    bool ConnectBlocks(const std::vector<const CBlockIndex*>& vpindex);
+    // remove the best block, which left the active chain, from the index
+    bool DisconnectBestBlock();
+    // write the batch with the locator of the new best block
+    bool Commit(CDBBatch& batch, const CBlockIndex* pindexNew);
+
+    const std::string strName;
+    std::atomic<const CBlockIndex*> pindexBest;
+    int nThreads;
+
+    boost::mutex mutex;
+    boost::condition_variable condNotify;
+    bool fNotified;
+    std::atomic<bool> fStop;
+    boost::thread thread;
+};
+
+/** Start or stop building the index with the given name (txindex, addrindex
+ *  or blockfilterindex) in the background. cs_main must not be held */
+bool SetIndexEnabled(const std::string& strName, bool fEnable, std::string& strError);
+
+/** Stop all the indexers, before the databases are closed */
+void StopIndexers();
+
+/** The indexers of the transaction and address indexes, when enabled. Protected by cs_main */
+extern std::unique_ptr<CBaseIndexer> g_txindex;
+extern std::unique_ptr<CBaseIndexer> g_addrindex;
+
+#endif // PAICOIN_INDEXER_H
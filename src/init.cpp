@@ -15,15 +15,20 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "blockcache.h"
+#include "blockfilterindex.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
+#include "coinsprefetch.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "indexer.h"
 #include "key.h"
+#include "lockprofile.h"
 #include "validation.h"
 #include "miner.h"
 #include "netbase.h"
@@ -53,6 +58,7 @@
 #include "warnings.h"
 #include <stdint.h>
 #include <stdio.h>
+#include <limits>
 #include <memory>
 
 #ifndef WIN32
@@ -222,6 +228,8 @@ void Shutdown()
         fFeeEstimatesInitialized = false;
     }
 
+    StopIndexers();
+
     // FlushStateToDisk generates a SetBestChain callback, which we should avoid missing
     if (pcoinsTip != nullptr) {
         FlushStateToDisk();
@@ -246,6 +254,8 @@ void Shutdown()
         pcoinsTip = nullptr;
         delete pcoinscatcher;
         pcoinscatcher = nullptr;
+        delete pcoinswritebehind;
+        pcoinswritebehind = nullptr;
         delete pcoinsdbview;
         pcoinsdbview = nullptr;
         delete pblocktree;
@@ -333,10 +343,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("Print this help message and exit"));
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-blockcachesize=<n>", strprintf(_("Keep up to <n> megabytes of recently used blocks in memory (default: %u)"), DEFAULT_BLOCK_CACHE_SIZE));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-coinsprefetchdepth=<n>", strprintf(_("Set the number of blocks ahead of the tip read from disk, along with the coins they spend, while the tip connects (1 to %d, default: %d)"), MAX_COINS_PREFETCH_DEPTH, DEFAULT_COINS_PREFETCH_DEPTH));
+    strUsage += HelpMessageOpt("-coinsprefetchthreads=<n>", strprintf(_("Set the number of threads reading the coins spent by a block ahead of its connection (0 to %d, default: %d)"), MAX_COINS_PREFETCH_THREADS, DEFAULT_COINS_PREFETCH_THREADS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), PAICOIN_CONF_FILENAME));
     if (mode == HMM_PAICOIND)
     {
@@ -346,7 +359,9 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     if (showDebug) {
+        strUsage += HelpMessageOpt("-dbasyncflush", strprintf("Write the flushed coins cache to the database in the background (default: %u)", DEFAULT_DB_ASYNC_FLUSH));
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
+        strUsage += HelpMessageOpt("-dboptions=<db>:<key>=<value>[,...]", "Override LevelDB settings of the blockindex or chainstate database, with the keys blockcache, writebuffer, maxfilesize (MiB), maxopenfiles and bloombits. Can be specified multiple times");
     }
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     if (showDebug)
@@ -376,8 +391,9 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifndef WIN32
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
-    strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
-    strUsage += HelpMessageOpt("-addrindex", strprintf(_("Maintain a full address index, used by the searchrawtransactions rpc call (default: %u)"), DEFAULT_ADDRINDEX));
+    strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call, built in the background (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-addrindex", strprintf(_("Maintain a full address index, used by the searchrawtransactions rpc call, built in the background (default: %u)"), DEFAULT_ADDRINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain an index of compact block filters (BIP 158), used by the getcfilter and getcfilterheader rpc calls, built in the background (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
 
 
     strUsage += HelpMessageGroup(_("Connection options:"));
@@ -432,6 +448,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubwinningtickets=<address>", _("Enable publish the winning tickets of the connected blocks in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubnewtickets=<address>", _("Enable publish the tickets purchased in the connected blocks in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubmissedtickets=<address>", _("Enable publish the tickets missed or expired in the connected blocks in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrevokedtickets=<address>", _("Enable publish the tickets revoked in the connected blocks in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubvote=<address>", _("Enable publish raw vote transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf(_("Set the number of notifications waiting to be published (default: %u)"), DEFAULT_ZMQ_QUEUE_SIZE));
+    strUsage += HelpMessageOpt("-zmqqueuedrop", strprintf(_("Drop the notifications while the queue is full, instead of delaying the validation (default: %u)"), DEFAULT_ZMQ_QUEUE_DROP));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -461,6 +484,7 @@ std::string HelpMessage(HelpMessageMode mode)
         _("If <category> is not supplied or if <category> = 1, output all debugging information.") + " " + _("<category> can be:") + " " + ListLogCategories() + ".");
     strUsage += HelpMessageOpt("-debugexclude=<category>", strprintf(_("Exclude debugging information for a category. Can be used in conjunction with -debug=1 to output debug logs for all categories except one or more specified categories.")));
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
+    strUsage += HelpMessageOpt("-lockprofilesample=<n>", strprintf(_("Sample one in <n> acquisitions of cs_main, mempool.cs and cs_wallet for the getlockstats RPC, 0 to only count them (default: %u)"), DEFAULT_LOCK_PROFILE_SAMPLE));
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), DEFAULT_LOGTIMESTAMPS));
     if (showDebug)
@@ -517,6 +541,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcserialversion", strprintf(_("Sets the serialization of raw transaction or block hex returned in non-verbose mode, non-segwit(0) or segwit(1) (default: %d)"), DEFAULT_RPC_SERIALIZE_VERSION));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchconcurrency=<n>", strprintf(_("Set the number of entries of a batch request that may run at the same time (default: %d)"), DEFAULT_RPC_BATCH_CONCURRENCY));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
@@ -910,6 +935,10 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX))
+            return InitError(_("Prune mode is incompatible with -addrindex."));
+        if (gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1031,6 +1060,13 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    int nCoinsPrefetchThreads = gArgs.GetArg("-coinsprefetchthreads", DEFAULT_COINS_PREFETCH_THREADS);
+    nCoinsPrefetchThreads = std::max(0, std::min(nCoinsPrefetchThreads, MAX_COINS_PREFETCH_THREADS));
+    coinsPrefetcher.SetThreads(nCoinsPrefetchThreads);
+    int nCoinsPrefetchDepth = gArgs.GetArg("-coinsprefetchdepth", DEFAULT_COINS_PREFETCH_DEPTH);
+    nCoinsPrefetchDepth = std::max(1, std::min(nCoinsPrefetchDepth, MAX_COINS_PREFETCH_DEPTH));
+    coinsPrefetcher.SetDepth(nCoinsPrefetchDepth);
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1119,6 +1155,11 @@ bool AppInitParameterInteraction()
 
     nMaxTipAge = gArgs.GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
+    const int64_t nLockProfileSample = gArgs.GetArg("-lockprofilesample", DEFAULT_LOCK_PROFILE_SAMPLE);
+    if (nLockProfileSample < 0 || nLockProfileSample > std::numeric_limits<unsigned int>::max())
+        return InitError(strprintf(_("Invalid -lockprofilesample '%d'"), nLockProfileSample));
+    SetLockProfileSample(nLockProfileSample);
+
     fEnableReplacement = gArgs.GetBoolArg("-mempoolreplacement", DEFAULT_ENABLE_REPLACEMENT);
     if ((!fEnableReplacement) && gArgs.IsArgSet("-mempoolreplacement")) {
         // Minimal effort at forwards compatibility
@@ -1268,6 +1309,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    LogPrintf("Using %u threads for coins prefetch, %u blocks ahead\n", coinsPrefetcher.GetThreads(), coinsPrefetcher.GetDepth());
+    for (int i = 0; i < coinsPrefetcher.GetThreads(); i++)
+        threadGroup.create_thread(&ThreadCoinsPrefetch);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1428,6 +1473,21 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
+    // LevelDB settings of each database, from its profile and -dboptions
+    CDBOptions blockTreeDBOptions = GetDBProfileOptions(DBProfile::BLOCK_INDEX, nBlockTreeDBCache);
+    CDBOptions coinsDBOptions = GetDBProfileOptions(DBProfile::CHAINSTATE, nCoinDBCache);
+    for (const std::string& strDBOptions : gArgs.GetArgs("-dboptions")) {
+        const size_t nPos = strDBOptions.find(':');
+        const std::string strDB = strDBOptions.substr(0, nPos);
+        CDBOptions* pdbOptions = strDB == "blockindex" ? &blockTreeDBOptions : strDB == "chainstate" ? &coinsDBOptions : nullptr;
+        std::string strError = "unknown database";
+        if (nPos == std::string::npos || !pdbOptions || !ParseDBOptions(strDBOptions.substr(nPos + 1), *pdbOptions, strError))
+            return InitError(strprintf(_("Invalid -dboptions '%s': %s"), strDBOptions, strError));
+    }
+    const int64_t nBlockCacheSize = std::max(gArgs.GetArg("-blockcachesize", DEFAULT_BLOCK_CACHE_SIZE), (int64_t)0) << 20;
+    blockCache.SetMaxSize(nBlockCacheSize);
+    LogPrintf("* Using %.1fMiB for recently used blocks\n", nBlockCacheSize * (1.0 / 1024 / 1024));
+
     bool fLoaded = false;
     while (!fLoaded && !fRequestShutdown) {
         bool fReset = fReindex;
@@ -1440,11 +1500,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
-                delete pcoinsdbview;
                 delete pcoinscatcher;
+                delete pcoinswritebehind;
+                delete pcoinsdbview;
                 delete pblocktree;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReset);
+                pblocktree = new CBlockTreeDB(blockTreeDBOptions, false, fReset);
 
                 if (fReset) {
                     pblocktree->WriteReindexing(true);
@@ -1455,9 +1516,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 if (fRequestShutdown) break;
 
-                // LoadBlockIndex will load fTxIndex from the db, or set it if
-                // we're reindexing. It will also load fHavePruned if we've
-                // ever removed a block file from disk.
+                // LoadBlockIndex will load fHavePruned if we've ever removed a
+                // block file from disk.
                 // Note that it also sets fReindex based on the disk flag!
                 // From here on out fReindex and fReset mean something different!
                 if (!LoadBlockIndex(chainparams)) {
@@ -1470,12 +1530,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 if (!mapBlockIndex.empty() && mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock) == 0)
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
 
-                // Check for changed -txindex state
-                if (fTxIndex != gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
-                    break;
-                }
-
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1495,8 +1549,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 // At this point we're either in reindex or we've loaded a useful
                 // block tree into mapBlockIndex!
 
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState);
-                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                pcoinsdbview = new CCoinsViewDB(coinsDBOptions, false, fReset || fReindexChainState);
+                pcoinswritebehind = new CCoinsViewWriteBehind(pcoinsdbview, gArgs.GetBoolArg("-dbasyncflush", DEFAULT_DB_ASYNC_FLUSH));
+                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinswritebehind);
 
                 // If necessary, upgrade from older database format.
                 // This is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
@@ -1524,12 +1579,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     assert(chainActive.Tip() != nullptr);
                 }
 
-                // Check for changed -addrindex state
-                if (fAddrIndex != gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -addrindex");
-                    break;
-                }
-
                 if (!fReset) {
                     // Note that RewindBlockIndex MUST run even if we're about to -reindex-chainstate.
                     // It both disconnects blocks based on chainActive, and drops block data in
@@ -1607,6 +1656,19 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    // The indexes are built in the background, catching up with the chain
+    // from where they were last left
+    const std::pair<std::string, bool> vIndexes[] = {
+        {"txindex", DEFAULT_TXINDEX},
+        {"addrindex", DEFAULT_ADDRINDEX},
+        {"blockfilterindex", DEFAULT_BLOCKFILTERINDEX},
+    };
+    for (const auto& index : vIndexes) {
+        std::string strError;
+        if (gArgs.GetBoolArg("-" + index.first, index.second) && !SetIndexEnabled(index.first, true, strError))
+            return InitError(strError);
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -0,0 +1,95 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "latencyhistogram.h"
+
+#include "crypto/common.h"
+
+#include <algorithm>
+#include <cmath>
+
+CLatencyHistogram::CLatencyHistogram()
+{
+    Reset();
+}
+
+int CLatencyHistogram::GetBucket(int64_t nMicros)
+{
+    if (nMicros < SUB_BUCKETS)
+        return nMicros;
+
+    // the leading bit selects the power of two, the next bits the bucket within it
+    const int nBits = CountBits(nMicros);
+    const int nSub = (nMicros >> (nBits - 1 - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS * (nBits - SUB_BUCKET_BITS) + nSub;
+}
+
+int64_t CLatencyHistogram::GetBucketUpperBound(int nBucket)
+{
+    if (nBucket < SUB_BUCKETS)
+        return nBucket;
+
+    const int nShift = nBucket / SUB_BUCKETS - 1;
+    const uint64_t nSub = nBucket % SUB_BUCKETS;
+    return static_cast<int64_t>(((SUB_BUCKETS + nSub + 1) << nShift) - 1);
+}
+
+void CLatencyHistogram::Record(int64_t nMicros)
+{
+    // the clock may step back
+    nMicros = std::max<int64_t>(nMicros, 0);
+
+    vBuckets[GetBucket(nMicros)].fetch_add(1, std::memory_order_relaxed);
+    nCount.fetch_add(1, std::memory_order_relaxed);
+    nTotal.fetch_add(nMicros, std::memory_order_relaxed);
+
+    int64_t nPrevMax = nMax.load(std::memory_order_relaxed);
+    while (nMicros > nPrevMax && !nMax.compare_exchange_weak(nPrevMax, nMicros, std::memory_order_relaxed)) {
+    }
+}
+
+void CLatencyHistogram::Reset()
+{
+    for (std::atomic<uint64_t>& bucket : vBuckets)
+        bucket.store(0, std::memory_order_relaxed);
+    nCount.store(0, std::memory_order_relaxed);
+    nTotal.store(0, std::memory_order_relaxed);
+    nMax.store(0, std::memory_order_relaxed);
+}
+
+int64_t CLatencyHistogram::GetPercentile(double dQuantile) const
+{
+    uint64_t vCounts[BUCKETS];
+    uint64_t nSamples = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        vCounts[i] = vBuckets[i].load(std::memory_order_relaxed);
+        nSamples += vCounts[i];
+    }
+    if (nSamples == 0)
+        return 0;
+
+    const uint64_t nRank = std::max<uint64_t>(std::ceil(dQuantile * nSamples), 1);
+    uint64_t nSeen = 0;
+    int nBucket = 0;
+    for (; nBucket < BUCKETS - 1; ++nBucket) {
+        nSeen += vCounts[nBucket];
+        if (nSeen >= nRank)
+            break;
+    }
+
+    // the largest sample is known exactly, and bounds the one of its bucket
+    return std::min(GetBucketUpperBound(nBucket), nMax.load(std::memory_order_relaxed));
+}
+
+CLatencyHistogram::Summary CLatencyHistogram::GetSummary() const
+{
+    Summary summary;
+    summary.nCount = nCount.load(std::memory_order_relaxed);
+    summary.nTotal = nTotal.load(std::memory_order_relaxed);
+    summary.nMax = nMax.load(std::memory_order_relaxed);
+    summary.nP50 = GetPercentile(0.5);
+    summary.nP90 = GetPercentile(0.9);
+    summary.nP99 = GetPercentile(0.99);
+    return summary;
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PAICOIN_LATENCYHISTOGRAM_H
+#define PAICOIN_LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * A histogram of durations in microseconds, cheap enough to record from hot
+ * paths: recording is a few relaxed atomic updates, without any lock.
+ *
+ * The buckets are exact below 8us, then each power of two is split in 8
+ * buckets, so that a percentile is reported within 12.5% of its true value.
+ * Reading the histogram while it is recorded to or reset gives a summary that
+ * may be off by the samples recorded meanwhile, which is fine for statistics.
+ */
+class CLatencyHistogram
+{
+public:
+    struct Summary {
+        uint64_t nCount;
+        int64_t nTotal;
+        int64_t nMax;
+        int64_t nP50;
+        int64_t nP90;
+        int64_t nP99;
+    };
+
+    CLatencyHistogram();
+
+    CLatencyHistogram(const CLatencyHistogram&) = delete;
+    CLatencyHistogram& operator=(const CLatencyHistogram&) = delete;
+
+    void Record(int64_t nMicros);
+    void Reset();
+
+    /** The value below which the fraction dQuantile (0 to 1) of the samples are, 0 when empty */
+    int64_t GetPercentile(double dQuantile) const;
+    Summary GetSummary() const;
+
+private:
+    static const int SUB_BUCKET_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKETS = SUB_BUCKETS * (64 - SUB_BUCKET_BITS);
+
+    std::atomic<uint64_t> vBuckets[BUCKETS];
+    std::atomic<uint64_t> nCount;
+    std::atomic<int64_t> nTotal;
+    std::atomic<int64_t> nMax;
+
+    static int GetBucket(int64_t nMicros);
+    static int64_t GetBucketUpperBound(int nBucket);
+};
+
+#endif // PAICOIN_LATENCYHISTOGRAM_H
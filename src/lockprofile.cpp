@@ -0,0 +1,134 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "lockprofile.h"
+
+#include "utiltime.h"
+
+#include <algorithm>
+
+static std::atomic<unsigned int> nLockProfileSample(DEFAULT_LOCK_PROFILE_SAMPLE);
+static std::atomic<int64_t> nLockProfilesResetTime(GetTime());
+
+CLockProfile::CLockProfile(const std::string& strNameIn) : strName(strNameIn), nAcquisitions(0), nContentions(0)
+{
+}
+
+bool CLockProfile::Acquiring()
+{
+    const uint64_t nAcquisition = nAcquisitions.fetch_add(1, std::memory_order_relaxed);
+    const unsigned int nSample = nLockProfileSample.load(std::memory_order_relaxed);
+    return nSample > 0 && nAcquisition % nSample == 0;
+}
+
+void CLockProfile::Record(const char* pszFile, int nLine, int64_t nWait, int64_t nHold)
+{
+    waitHistogram.Record(nWait);
+    holdHistogram.Record(nHold);
+
+    std::lock_guard<std::mutex> lock(csCallSites);
+    auto it = mapCallSites.find(std::make_pair(pszFile, nLine));
+    if (it == mapCallSites.end())
+        it = mapCallSites.emplace(std::make_pair(pszFile, nLine), CallSite{pszFile, nLine, 0, 0, 0, 0}).first;
+    CallSite& site = it->second;
+    ++site.nSamples;
+    site.nWait += nWait;
+    site.nHold += nHold;
+    site.nMaxHold = std::max(site.nMaxHold, nHold);
+}
+
+void CLockProfile::Reset()
+{
+    nAcquisitions.store(0, std::memory_order_relaxed);
+    nContentions.store(0, std::memory_order_relaxed);
+    waitHistogram.Reset();
+    holdHistogram.Reset();
+
+    std::lock_guard<std::mutex> lock(csCallSites);
+    mapCallSites.clear();
+}
+
+std::vector<CLockProfile::CallSite> CLockProfile::GetTopCallSites(size_t nCount) const
+{
+    // merge the sites of a header, which has a __FILE__ literal in each
+    // translation unit including it
+    std::map<std::pair<std::string, int>, CallSite> mapMerged;
+    {
+        std::lock_guard<std::mutex> lock(csCallSites);
+        for (const auto& entry : mapCallSites) {
+            const CallSite& site = entry.second;
+            auto it = mapMerged.emplace(std::make_pair(site.strFile, site.nLine), CallSite{site.strFile, site.nLine, 0, 0, 0, 0}).first;
+            it->second.nSamples += site.nSamples;
+            it->second.nWait += site.nWait;
+            it->second.nHold += site.nHold;
+            it->second.nMaxHold = std::max(it->second.nMaxHold, site.nMaxHold);
+        }
+    }
+
+    std::vector<CallSite> vSites;
+    vSites.reserve(mapMerged.size());
+    for (const auto& entry : mapMerged)
+        vSites.push_back(entry.second);
+
+    const size_t nTop = std::min(nCount, vSites.size());
+    std::partial_sort(vSites.begin(), vSites.begin() + nTop, vSites.end(), [](const CallSite& a, const CallSite& b) {
+        return a.nHold > b.nHold;
+    });
+    vSites.resize(nTop);
+    return vSites;
+}
+
+// the profiles outlive the mutexes of the static objects, which may be used
+// until the very end of the process, so they are never destroyed
+static std::mutex& GetLockProfilesMutex()
+{
+    static std::mutex* pcs = new std::mutex();
+    return *pcs;
+}
+
+static std::vector<CLockProfile*>& GetLockProfilesList()
+{
+    static std::vector<CLockProfile*>* pvProfiles = new std::vector<CLockProfile*>();
+    return *pvProfiles;
+}
+
+CLockProfile& GetLockProfile(const std::string& strName)
+{
+    std::lock_guard<std::mutex> lock(GetLockProfilesMutex());
+    std::vector<CLockProfile*>& vProfiles = GetLockProfilesList();
+    for (CLockProfile* pprofile : vProfiles) {
+        if (pprofile->GetName() == strName)
+            return *pprofile;
+    }
+    vProfiles.push_back(new CLockProfile(strName));
+    return *vProfiles.back();
+}
+
+std::vector<CLockProfile*> GetLockProfiles()
+{
+    std::lock_guard<std::mutex> lock(GetLockProfilesMutex());
+    return GetLockProfilesList();
+}
+
+void ResetLockProfiles()
+{
+    for (CLockProfile* pprofile : GetLockProfiles())
+        pprofile->Reset();
+    nLockProfilesResetTime = GetTime();
+}
+
+int64_t GetLockProfilesResetTime()
+{
+    return nLockProfilesResetTime;
+}
+
+void SetLockProfileSample(unsigned int nSample)
+{
+    nLockProfileSample = nSample;
+}
+
+unsigned int GetLockProfileSample()
+{
+    return nLockProfileSample;
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PAICOIN_LOCKPROFILE_H
+#define PAICOIN_LOCKPROFILE_H
+
+#include "latencyhistogram.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Default for -lockprofilesample */
+static const unsigned int DEFAULT_LOCK_PROFILE_SAMPLE = 100;
+
+/**
+ * The contention profile of a mutex, or of a family of mutexes like the
+ * cs_wallet of all the wallets, always compiled in and cheap enough for
+ * production.
+ *
+ * Each acquisition of a profiled CCriticalSection is counted, and so is each
+ * acquisition that has to wait. One in GetLockProfileSample() acquisitions is
+ * sampled: the time it waited for the mutex and the time it held it are
+ * recorded in histograms and charged to its call site, the __FILE__:__LINE__
+ * of its LOCK. The recursive acquisitions are counted but never sampled, as
+ * the outermost one holds the mutex for them.
+ */
+class CLockProfile
+{
+public:
+    struct CallSite {
+        std::string strFile;
+        int nLine;
+        uint64_t nSamples;
+        int64_t nWait;
+        int64_t nHold;
+        int64_t nMaxHold;
+    };
+
+    explicit CLockProfile(const std::string& strNameIn);
+
+    CLockProfile(const CLockProfile&) = delete;
+    CLockProfile& operator=(const CLockProfile&) = delete;
+
+    const std::string& GetName() const { return strName; }
+
+    /** Count an acquisition, returning whether it is sampled */
+    bool Acquiring();
+    /** Count an acquisition that waited for the mutex */
+    void Contended() { nContentions.fetch_add(1, std::memory_order_relaxed); }
+    /** Record a sampled acquisition, once the mutex is released */
+    void Record(const char* pszFile, int nLine, int64_t nWait, int64_t nHold);
+
+    void Reset();
+
+    uint64_t GetAcquisitions() const { return nAcquisitions.load(std::memory_order_relaxed); }
+    uint64_t GetContentions() const { return nContentions.load(std::memory_order_relaxed); }
+    const CLatencyHistogram& GetWaitHistogram() const { return waitHistogram; }
+    const CLatencyHistogram& GetHoldHistogram() const { return holdHistogram; }
+
+    /** The nCount call sites that held the mutex the longest, in all */
+    std::vector<CallSite> GetTopCallSites(size_t nCount) const;
+
+private:
+    const std::string strName;
+    std::atomic<uint64_t> nAcquisitions;
+    std::atomic<uint64_t> nContentions;
+    CLatencyHistogram waitHistogram;
+    CLatencyHistogram holdHistogram;
+
+    // the sampled call sites; __FILE__ is a literal, so its address identifies it
+    // within a translation unit
+    mutable std::mutex csCallSites;
+    std::map<std::pair<const char*, int>, CallSite> mapCallSites;
+};
+
+/** The profile with the given name, created on first use and never destroyed */
+CLockProfile& GetLockProfile(const std::string& strName);
+/** All the profiles, by order of creation */
+std::vector<CLockProfile*> GetLockProfiles();
+/** Clear all the profiles */
+void ResetLockProfiles();
+/** The time of the last reset, or of the start of the node */
+int64_t GetLockProfilesResetTime();
+
+/** Sample one in nSample acquisitions of the profiled mutexes, none if 0, though all are still counted */
+void SetLockProfileSample(unsigned int nSample);
+unsigned int GetLockProfileSample();
+
+#endif // PAICOIN_LOCKPROFILE_H
@@ -11,6 +11,7 @@
 
 #include "addrman.h"
 #include "arith_uint256.h"
+#include "blockcache.h"
 #include "blockencodings.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
@@ -36,6 +37,7 @@
 #include "validationinterface.h"
 
 #include <iterator>
+#include <list>
 
 #if defined(NDEBUG)
 # error "PAI Coin cannot be compiled without assertions."
@@ -826,6 +828,8 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
     bool fWitnessEnabled = IsWitnessEnabled(pindex->pprev, Params().GetConsensus());
     uint256 hashBlock(pblock->GetHash());
 
+    blockCache.Insert(pblock);
+
     {
         LOCK(cs_most_recent_block);
         most_recent_block_hash = hashBlock;
@@ -1041,7 +1045,7 @@ void static RelayMempoolStakeTxs(CNode* pfrom)
     }
 }
 
-void static RelayChainTips(CNode* pfrom, const Consensus::Params& consensusParams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, const int maxDepth = DEFAULT_HANDSHAKE_TIPS_DEPTH, CBlock *pExcludeBlock = nullptr)
+void static RelayChainTips(CNode* pfrom, const Consensus::Params& consensusParams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, const int maxDepth = DEFAULT_HANDSHAKE_TIPS_DEPTH, const uint256& excludeHash = uint256())
 {
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
 
@@ -1059,10 +1063,6 @@ void static RelayChainTips(CNode* pfrom, const Consensus::Params& consensusParam
         setLatestTips = setTips;
     }
 
-    uint256 excludeHash;
-    if (pExcludeBlock)
-        excludeHash = pExcludeBlock->GetHash();
-
     for (const CBlockIndex* pindex: setLatestTips) {
         if (pfrom->fPauseSend)
             break;
@@ -1073,21 +1073,19 @@ void static RelayChainTips(CNode* pfrom, const Consensus::Params& consensusParam
         if ((pindex->nStatus & BLOCK_HAVE_DATA) == 0)
             continue;
 
-        if (pExcludeBlock && (pindex->GetBlockHash() == excludeHash))
+        if (!excludeHash.IsNull() && (pindex->GetBlockHash() == excludeHash))
             continue;
 
         // Send block from disk
         std::shared_ptr<const CBlock> pblock;
-        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
+        if (!ReadBlockFromDiskCached(pblock, pindex, consensusParams))
             continue;
-        pblock = pblockRead;
 
         pfrom->PushChainTip(*pblock);
     }
 }
 
-void static RelayStakeTxsAndChainTipsIfNeeded(CBlock block, CNode* pfrom, const Consensus::Params& consensusParams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, uint256 chainTipHash = uint256())
+void static RelayStakeTxsAndChainTipsIfNeeded(const uint256& blockHash, CNode* pfrom, const Consensus::Params& consensusParams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, uint256 chainTipHash = uint256())
 {
     // send all the votes in mempool and the chain tips,
     // if not during the initial block download
@@ -1112,13 +1110,44 @@ void static RelayStakeTxsAndChainTipsIfNeeded(CBlock block, CNode* pfrom, const
     //if ((pfrom->nLastBlockTime < chainTipTime - tipsInterval) || (pfrom->nLastBlockTime > chainTipTime + tipsInterval))
     //    return;
 
-    if (block.GetHash() != chainTipHash)
+    if (blockHash != chainTipHash)
         return;
 
     RelayMempoolStakeTxs(pfrom);
 
     int depth = static_cast<int>(gArgs.GetArg("-handshaketipsdepth", DEFAULT_HANDSHAKE_TIPS_DEPTH));
-    RelayChainTips(pfrom, consensusParams, connman, interruptMsgProc, depth, &block);
+    RelayChainTips(pfrom, consensusParams, connman, interruptMsgProc, depth, blockHash);
+}
+
+// Blocks recently served to peers straight from the block files, in the stored
+// (network) serialization, most recently used first. A block that several peers
+// request during their initial block download is read from disk only once.
+static const size_t MAX_RECENT_RAW_BLOCKS = 16;
+static CCriticalSection cs_recent_raw_blocks;
+static std::list<std::pair<uint256, std::shared_ptr<const std::vector<unsigned char>>>> recent_raw_blocks;
+
+static std::shared_ptr<const std::vector<unsigned char>> ReadRecentRawBlock(const CBlockIndex* pindex, const CChainParams& chainparams)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    {
+        LOCK(cs_recent_raw_blocks);
+        for (auto it = recent_raw_blocks.begin(); it != recent_raw_blocks.end(); ++it) {
+            if (it->first == hash) {
+                recent_raw_blocks.splice(recent_raw_blocks.begin(), recent_raw_blocks, it);
+                return it->second;
+            }
+        }
+    }
+
+    std::shared_ptr<std::vector<unsigned char>> pblockRead = std::make_shared<std::vector<unsigned char>>();
+    if (!ReadRawBlockFromDisk(*pblockRead, pindex, chainparams.MessageStart()))
+        return nullptr;
+
+    LOCK(cs_recent_raw_blocks);
+    recent_raw_blocks.emplace_front(hash, pblockRead);
+    if (recent_raw_blocks.size() > MAX_RECENT_RAW_BLOCKS)
+        recent_raw_blocks.pop_back();
+    return pblockRead;
 }
 
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
@@ -1191,23 +1220,41 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    // Blocks are stored on disk in network serialization, so full blocks are
+                    // sent as stored, without deserializing them. Blocks accepted before segwit
+                    // was active cannot carry witness data, so their stored form is also valid
+                    // for peers that do not want witnesses.
+                    const bool fSendRaw = inv.type == MSG_WITNESS_BLOCK ||
+                        (inv.type == MSG_BLOCK && !(mi->second->nStatus & BLOCK_OPT_WITNESS));
+
                     std::shared_ptr<const CBlock> pblock;
+                    std::shared_ptr<const std::vector<unsigned char>> pblockRaw;
                     if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
                         pblock = a_recent_block;
+                    } else if (fSendRaw) {
+                        // Send stored block bytes from disk
+                        pblockRaw = ReadRecentRawBlock((*mi).second, Params());
+                        if (!pblockRaw)
+                            assert(!"cannot load block from disk");
                     } else {
                         // Send block from disk
-                        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-                        if (!ReadBlockFromDisk(*pblockRead, (*mi).second, consensusParams))
+                        if (!ReadBlockFromDiskCached(pblock, (*mi).second, consensusParams))
                             assert(!"cannot load block from disk");
-                        pblock = pblockRead;
                     }
-                    if (inv.type == MSG_BLOCK) {
+                    if (pblockRaw) {
+                        CSerializedNetMsg msg;
+                        msg.command = NetMsgType::BLOCK;
+                        msg.shared_data = pblockRaw;
+                        connman->PushMessage(pfrom, std::move(msg));
+                        RelayStakeTxsAndChainTipsIfNeeded(inv.hash, pfrom, consensusParams, connman, interruptMsgProc, chainActive.Tip()->GetBlockHash());
+                    }
+                    else if (inv.type == MSG_BLOCK) {
                         connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-                        RelayStakeTxsAndChainTipsIfNeeded(*pblock, pfrom, consensusParams, connman, interruptMsgProc, chainActive.Tip()->GetBlockHash());
+                        RelayStakeTxsAndChainTipsIfNeeded(inv.hash, pfrom, consensusParams, connman, interruptMsgProc, chainActive.Tip()->GetBlockHash());
                     }
                     else if (inv.type == MSG_WITNESS_BLOCK) {
                         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
-                        RelayStakeTxsAndChainTipsIfNeeded(*pblock, pfrom, consensusParams, connman, interruptMsgProc, chainActive.Tip()->GetBlockHash());
+                        RelayStakeTxsAndChainTipsIfNeeded(inv.hash, pfrom, consensusParams, connman, interruptMsgProc, chainActive.Tip()->GetBlockHash());
                     }
                     else if (inv.type == MSG_FILTERED_BLOCK)
                     {
@@ -1252,7 +1299,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                             }
                         } else {
                             connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCK, *pblock));
-                            RelayStakeTxsAndChainTipsIfNeeded(*pblock, pfrom, consensusParams, connman, interruptMsgProc, chainActive.Tip()->GetBlockHash());
+                            RelayStakeTxsAndChainTipsIfNeeded(inv.hash, pfrom, consensusParams, connman, interruptMsgProc, chainActive.Tip()->GetBlockHash());
                         }
                     }
 
@@ -2645,7 +2692,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         ProcessNewBlock(chainparams, pblock, forceProcessing, &fNewBlock);
         if (fNewBlock) {
             pfrom->nLastBlockTime = GetTime();
-            RelayStakeTxsAndChainTipsIfNeeded(*pblock, pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
+            RelayStakeTxsAndChainTipsIfNeeded(pblock->GetHash(), pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
         } else {
             LOCK(cs_main);
             mapBlockSource.erase(pblock->GetHash());
@@ -16,8 +16,19 @@
 #include "crypto/common.h"
 #include "chainparams.h"
 
+std::atomic<uint64_t> CBlockHeader::nHashesComputed{0};
+
 uint256 CBlockHeader::GetHash() const
 {
+    if (IsHashCacheValid())
+        return hashCache.hash;
+    return ComputeHash();
+}
+
+uint256 CBlockHeader::ComputeHash() const
+{
+    nHashesComputed.fetch_add(1, std::memory_order_relaxed);
+
     if (this->nVersion & HARDFORK_VERSION_BIT) {
         // between Hybrid PoW/PoS deployment and paicoin hasher deployment, use SHAKE-256;
         // afterwards, use paicoin hasher
@@ -61,6 +72,48 @@ void CBlockHeader::SetReadStakeDefaultBeforeFork()
     nStakeVersion = 0;
 }
 
+void CBlockHeader::CacheHash()
+{
+    hashCache.fValid = false;
+    hashCache.hash               = ComputeHash();
+    hashCache.nVersion           = nVersion;
+    hashCache.hashPrevBlock      = hashPrevBlock;
+    hashCache.hashMerkleRoot     = hashMerkleRoot;
+    hashCache.nTime              = nTime;
+    hashCache.nBits              = nBits;
+    hashCache.nNonce             = nNonce;
+    hashCache.nStakeDifficulty   = nStakeDifficulty;
+    hashCache.nVoteBits          = nVoteBits;
+    hashCache.nTicketPoolSize    = nTicketPoolSize;
+    hashCache.ticketLotteryState = ticketLotteryState;
+    hashCache.nVoters            = nVoters;
+    hashCache.nFreshStake        = nFreshStake;
+    hashCache.nRevocations       = nRevocations;
+    hashCache.extraData          = extraData;
+    hashCache.nStakeVersion      = nStakeVersion;
+    hashCache.fValid             = true;
+}
+
+bool CBlockHeader::IsHashCacheValid() const
+{
+    return hashCache.fValid
+        && hashCache.nVersion == nVersion
+        && hashCache.hashPrevBlock == hashPrevBlock
+        && hashCache.hashMerkleRoot == hashMerkleRoot
+        && hashCache.nTime == nTime
+        && hashCache.nBits == nBits
+        && hashCache.nNonce == nNonce
+        && hashCache.nStakeDifficulty == nStakeDifficulty
+        && hashCache.nVoteBits == nVoteBits
+        && hashCache.nTicketPoolSize == nTicketPoolSize
+        && hashCache.ticketLotteryState == ticketLotteryState
+        && hashCache.nVoters == nVoters
+        && hashCache.nFreshStake == nFreshStake
+        && hashCache.nRevocations == nRevocations
+        && hashCache.extraData == extraData
+        && hashCache.nStakeVersion == nStakeVersion;
+}
+
 bool CBlockHeader::isPaicoinHashBlock() const
 {
     return nTime >= Params().GetConsensus().nPaicoinHashTimestamp;
@@ -15,6 +15,7 @@
 #include "stake/votebits.h"
 
 #include <array>
+#include <atomic>
 
 static const int HARDFORK_VERSION_BIT = 0x80000000;
 /** Nodes collect new transactions into a block, hash them into a hash tree,
@@ -75,12 +76,15 @@ public:
         {
            SetReadStakeDefaultBeforeFork(); 
         }
+        if (ser_action.ForRead())
+            CacheHash();
     }
 
     void SetReadStakeDefaultBeforeFork();
 
     void SetNull()
     {
+        hashCache.fValid = false;
         nVersion = 0;
         hashPrevBlock.SetNull();
         hashMerkleRoot.SetNull();
@@ -103,14 +107,61 @@ public:
         return (nBits == 0);
     }
 
+    /** Returns the block hash, served from the hash cached at deserialization
+     * while the header fields are unchanged. */
     uint256 GetHash() const;
 
+    /** Hashes the header without consulting the cached hash. */
+    uint256 ComputeHash() const;
+
+    /** Hashes the header and caches the result for GetHash(). */
+    void CacheHash();
+
+    /** Sets the nonce and drops the cached hash. */
+    void SetNonce(uint32_t nNonceIn)
+    {
+        nNonce = nNonceIn;
+        hashCache.fValid = false;
+    }
+
+    /** Total number of header hashes computed by this process. */
+    static std::atomic<uint64_t> nHashesComputed;
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
     }
 
     bool isPaicoinHashBlock() const;
+
+private:
+    // memory only: the hash cached by CacheHash() together with a copy of the
+    // fields it was computed from. It is written on non-const paths only, so
+    // concurrent GetHash() calls on a shared header only ever read it; the
+    // copy catches the fields that are still written directly.
+    struct HashCache
+    {
+        bool       fValid = false;
+        uint256    hash;
+        int32_t    nVersion;
+        uint256    hashPrevBlock;
+        uint256    hashMerkleRoot;
+        uint32_t   nTime;
+        uint32_t   nBits;
+        uint32_t   nNonce;
+        int64_t    nStakeDifficulty;
+        VoteBits   nVoteBits;
+        uint32_t   nTicketPoolSize;
+        uint48     ticketLotteryState;
+        uint16_t   nVoters;
+        uint8_t    nFreshStake;
+        uint8_t    nRevocations;
+        uint256    extraData;
+        uint32_t   nStakeVersion;
+    };
+    HashCache hashCache;
+
+    bool IsHashCacheValid() const;
 };
 
 
@@ -151,23 +202,7 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        block.nVoteBits      = nVoteBits;
-        block.nStakeDifficulty = nStakeDifficulty;
-        block.nTicketPoolSize = nTicketPoolSize;
-        block.ticketLotteryState = ticketLotteryState;
-        block.nVoters        = nVoters;
-        block.nFreshStake    = nFreshStake;
-        block.nRevocations   = nRevocations;
-        block.extraData      = extraData;
-        block.nStakeVersion  = nStakeVersion;
-        return block;
+        return *static_cast<const CBlockHeader*>(this);
     }
 
     std::string ToString() const;
@@ -7,6 +7,7 @@
 //
 
 
+#include "blockfilterindex.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "core_io.h"
@@ -16,6 +17,8 @@
 #include "httpserver.h"
 #include "rpc/blockchain.h"
 #include "rpc/server.h"
+#include "stake/stakenode.h"
+#include "stake/staketx.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
@@ -29,6 +32,7 @@
 #include <iterator>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS{15}; //allow a max of 15 outpoints to be queried at once
+static const long MAX_STAKE_HISTORY_COUNT{2000}; //allow a max of 2000 blocks of stake history at once
 
 enum class RetFormat {
     UNDEF,
@@ -47,6 +51,29 @@ static const struct {
       {RetFormat::JSON, "json"},
 };
 
+// The stake state of a block of the active chain, for the stake history
+struct CStakeHistoryEntry {
+    uint32_t nHeight{0};
+    uint256 hashBlock;
+    int64_t nStakeDifficulty{0};
+    uint32_t nTicketPoolSize{0};
+
+    ADD_SERIALIZE_METHODS;
+
+    CStakeHistoryEntry() = default;
+    explicit CStakeHistoryEntry(const CBlockIndex* pindex) : nHeight(pindex->nHeight), hashBlock(pindex->GetBlockHash()),
+        nStakeDifficulty(pindex->nStakeDifficulty), nTicketPoolSize(pindex->nTicketPoolSize) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nHeight);
+        READWRITE(hashBlock);
+        READWRITE(nStakeDifficulty);
+        READWRITE(nTicketPoolSize);
+    }
+};
+
 struct CCoin {
     uint32_t nHeight{0};
     CTxOut out;
@@ -211,6 +238,138 @@ static bool rest_headers(HTTPRequest* req,
     }
 }
 
+static bool rest_block_filter(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const auto rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid URI format. Expected /rest/blockfilter/<filtertype>/<blockhash>.<ext>");
+
+    BlockFilterType filterType;
+    if (!BlockFilterTypeByName(path[0], filterType))
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Unknown filtertype " + path[0]);
+
+    uint256 hash;
+    if (!ParseHashStr(path[1], hash))
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid hash: " + path[1]);
+
+    BlockFilter filter;
+    {
+        LOCK(cs_main);
+        if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != filterType)
+            return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Index is not enabled for filtertype " + path[0]);
+        const auto it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
+            return RESTERR(req, HTTPStatusCode::NOT_FOUND, path[1] + " not found");
+        if (!g_blockfilterindex->LookupFilter(it->second, filter))
+            return RESTERR(req, HTTPStatusCode::NOT_FOUND, "Filter not found. Block filters are still in the process of being indexed.");
+    }
+
+    CDataStream ssFilter{SER_NETWORK, PROTOCOL_VERSION};
+    ssFilter << filter;
+
+    switch (rf) {
+    case RetFormat::BINARY: {
+        BinaryReply(req, ssFilter);
+        return true;
+    }
+
+    case RetFormat::HEX: {
+        HexReply(req, ssFilter);
+        return true;
+    }
+
+    case RetFormat::JSON: {
+        UniValue ret{UniValue::VOBJ};
+        ret.push_back(Pair("filter", HexStr(filter.GetEncodedFilter())));
+        JsonReply(req, ret);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTPStatusCode::NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_block_filter_headers(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const auto rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 3)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid URI format. Expected /rest/blockfilterheaders/<filtertype>/<count>/<blockhash>.<ext>");
+
+    BlockFilterType filterType;
+    if (!BlockFilterTypeByName(path[0], filterType))
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Unknown filtertype " + path[0]);
+
+    const auto count = strtol(path[1].c_str(), nullptr, 10);
+    if (count < 1 || count > 2000)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Header count out of range: " + path[1]);
+
+    uint256 hash;
+    if (!ParseHashStr(path[2], hash))
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid hash: " + path[2]);
+
+    // the headers of the blocks of the active chain from the given one
+    std::vector<uint256> filterHeaders;
+    filterHeaders.reserve(count);
+    {
+        LOCK(cs_main);
+        if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != filterType)
+            return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Index is not enabled for filtertype " + path[0]);
+        auto it = mapBlockIndex.find(hash);
+        const CBlockIndex *pindex{(it != mapBlockIndex.end()) ? it->second : nullptr};
+        while (pindex != nullptr && chainActive.Contains(pindex)) {
+            uint256 filterHeader;
+            if (!g_blockfilterindex->LookupFilterHeader(pindex, filterHeader))
+                break;
+            filterHeaders.push_back(filterHeader);
+            if (filterHeaders.size() == static_cast<unsigned long>(count))
+                break;
+            pindex = chainActive.Next(pindex);
+        }
+    }
+
+    CDataStream ssHeader{SER_NETWORK, PROTOCOL_VERSION};
+    for (const uint256& filterHeader : filterHeaders) {
+        ssHeader << filterHeader;
+    }
+
+    switch (rf) {
+    case RetFormat::BINARY: {
+        BinaryReply(req, ssHeader);
+        return true;
+    }
+
+    case RetFormat::HEX: {
+        HexReply(req, ssHeader);
+        return true;
+    }
+
+    case RetFormat::JSON: {
+        UniValue jsonHeaders{UniValue::VARR};
+        for (const uint256& filterHeader : filterHeaders) {
+            jsonHeaders.push_back(filterHeader.GetHex());
+        }
+        JsonReply(req, jsonHeaders);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTPStatusCode::NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static bool rest_block(HTTPRequest* req,
                        const std::string& strURIPart,
                        bool showTxDetails)
@@ -380,6 +539,257 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     }
 }
 
+static bool StakeTicketsReply(HTTPRequest* req, RetFormat rf, const CBlockIndex* pindex, const HashVector& tickets)
+{
+    CDataStream ssTickets{SER_NETWORK, PROTOCOL_VERSION};
+    ssTickets << static_cast<uint32_t>(pindex->nHeight) << pindex->GetBlockHash() << tickets;
+
+    switch (rf) {
+    case RetFormat::BINARY: {
+        BinaryReply(req, ssTickets);
+        return true;
+    }
+
+    case RetFormat::HEX: {
+        HexReply(req, ssTickets);
+        return true;
+    }
+
+    case RetFormat::JSON: {
+        UniValue jsonTickets{UniValue::VARR};
+        for (const uint256& ticketHash : tickets)
+            jsonTickets.push_back(ticketHash.GetHex());
+        UniValue ret{UniValue::VOBJ};
+        ret.push_back(Pair("height", pindex->nHeight));
+        ret.push_back(Pair("hash", pindex->GetBlockHash().GetHex()));
+        ret.push_back(Pair("tickets", jsonTickets));
+        JsonReply(req, ret);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTPStatusCode::NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+// the live, missed or revoked tickets after the block of the active chain at the given height
+static bool rest_stake_tickets(HTTPRequest* req, RetFormat rf, const std::vector<std::string>& path)
+{
+    if (path.size() != 3 || (path[1] != "live" && path[1] != "missed" && path[1] != "revoked"))
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid URI format. Expected /rest/stake/tickets/<live|missed|revoked>/<height>.<ext>");
+
+    int nHeight;
+    if (!ParseInt32(path[2], &nHeight) || nHeight < 0)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid height: " + path[2]);
+
+    const CBlockIndex* pindex;
+    HashVector tickets;
+    {
+        LOCK(cs_main);
+        if (nHeight > chainActive.Height())
+            return RESTERR(req, HTTPStatusCode::NOT_FOUND, "Block height out of range: " + path[2]);
+
+        pindex = chainActive[nHeight];
+        const auto& stakeNode = FetchStakeNode(chainActive[nHeight], Params().GetConsensus());
+        if (stakeNode == nullptr)
+            return RESTERR(req, HTTPStatusCode::NOT_FOUND, "Stake data not found at height " + path[2]);
+
+        if (path[1] == "live")
+            tickets = stakeNode->LiveTickets();
+        else if (path[1] == "missed")
+            tickets = stakeNode->MissedTickets();
+        else
+            tickets = stakeNode->RevokedTickets();
+    }
+
+    return StakeTicketsReply(req, rf, pindex, tickets);
+}
+
+// The stake node of a block of the active chain, or of a block with data whose
+// parent stake node is loaded, or null. A node that is not loaded yet is built
+// here from the blocks on disk and not stored in the block index, which is only
+// filled by validation.
+static std::shared_ptr<StakeNode> GetStakeNodeForREST(const CBlockIndex* pindex, const Consensus::Params& params)
+{
+    AssertLockHeld(cs_main);
+
+    const bool fConnectable = (pindex->nStatus & BLOCK_HAVE_DATA) && pindex->pprev != nullptr && pindex->pprev->pstakeNode != nullptr;
+    if (!fConnectable && !chainActive.Contains(pindex))
+        return nullptr;
+    if (pindex->pstakeNode != nullptr)
+        return pindex->pstakeNode;
+    if (!fConnectable)
+        return nullptr;
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, params))
+        return nullptr;
+    const SpentTicketsInBlock spentTickets = FindSpentTicketsInBlock(block);
+
+    // the tickets bought nTicketMaturity blocks earlier, as MaybeFetchNewTickets
+    HashVector newTickets;
+    if (pindex->newTickets != nullptr) {
+        newTickets = *pindex->newTickets;
+    } else if (pindex->nHeight >= params.nStakeEnabledHeight) {
+        const CBlockIndex* pmatureIndex = pindex->GetAncestor(pindex->nHeight - params.nTicketMaturity);
+        CBlock matureBlock;
+        if (pmatureIndex == nullptr || !(pmatureIndex->nStatus & BLOCK_HAVE_DATA) || !ReadBlockFromDisk(matureBlock, pmatureIndex, params))
+            return nullptr;
+        for (const auto& tx : StakeSlice(matureBlock.vtx, TX_BuyTicket))
+            newTickets.push_back(tx->GetHash());
+    }
+
+    return pindex->pprev->pstakeNode->ConnectNode(pindex->LotteryIV(), std::get<0>(spentTickets), std::get<1>(spentTickets), newTickets);
+}
+
+// the tickets winning the lottery of the given block, which vote on it in its children
+static bool rest_stake_winners(HTTPRequest* req, RetFormat rf, const std::vector<std::string>& path)
+{
+    if (path.size() != 2)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid URI format. Expected /rest/stake/winners/<blockhash>.<ext>");
+
+    uint256 hash;
+    if (!ParseHashStr(path[1], hash))
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid hash: " + path[1]);
+
+    const CBlockIndex* pindex;
+    HashVector winners;
+    {
+        LOCK(cs_main);
+        const auto it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
+            return RESTERR(req, HTTPStatusCode::NOT_FOUND, path[1] + " not found");
+
+        pindex = it->second;
+        const auto& stakeNode = GetStakeNodeForREST(pindex, Params().GetConsensus());
+        if (stakeNode == nullptr)
+            return RESTERR(req, HTTPStatusCode::NOT_FOUND, "Stake data not found for " + path[1]);
+        winners = stakeNode->Winners();
+    }
+
+    return StakeTicketsReply(req, rf, pindex, winners);
+}
+
+// the stake difficulty and the ticket pool size of the blocks of the active chain from the given one
+static bool rest_stake_history(HTTPRequest* req, RetFormat rf, const std::vector<std::string>& path)
+{
+    if (path.size() != 3)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid URI format. Expected /rest/stake/history/<count>/<blockhash>.<ext>");
+
+    const auto count = strtol(path[1].c_str(), nullptr, 10);
+    if (count < 1 || count > MAX_STAKE_HISTORY_COUNT)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Block count out of range: " + path[1]);
+
+    uint256 hash;
+    if (!ParseHashStr(path[2], hash))
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid hash: " + path[2]);
+
+    std::vector<CStakeHistoryEntry> history;
+    history.reserve(count);
+    {
+        LOCK(cs_main);
+        auto it = mapBlockIndex.find(hash);
+        const CBlockIndex *pindex{(it != mapBlockIndex.end()) ? it->second : nullptr};
+        while (pindex != nullptr && chainActive.Contains(pindex)) {
+            history.emplace_back(pindex);
+            if (history.size() == static_cast<unsigned long>(count))
+                break;
+            pindex = chainActive.Next(pindex);
+        }
+    }
+
+    CDataStream ssHistory{SER_NETWORK, PROTOCOL_VERSION};
+    ssHistory << history;
+
+    switch (rf) {
+    case RetFormat::BINARY: {
+        BinaryReply(req, ssHistory);
+        return true;
+    }
+
+    case RetFormat::HEX: {
+        HexReply(req, ssHistory);
+        return true;
+    }
+
+    case RetFormat::JSON: {
+        UniValue jsonHistory{UniValue::VARR};
+        for (const CStakeHistoryEntry& entry : history) {
+            UniValue jsonEntry{UniValue::VOBJ};
+            jsonEntry.push_back(Pair("height", static_cast<int>(entry.nHeight)));
+            jsonEntry.push_back(Pair("hash", entry.hashBlock.GetHex()));
+            jsonEntry.push_back(Pair("stakedifficulty", ValueFromAmount(entry.nStakeDifficulty)));
+            jsonEntry.push_back(Pair("poolsize", static_cast<int>(entry.nTicketPoolSize)));
+            jsonHistory.push_back(jsonEntry);
+        }
+        JsonReply(req, jsonHistory);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTPStatusCode::NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+// the value locked in the live tickets at the tip, from the stake outputs of the tickets
+static bool rest_stake_poolvalue(HTTPRequest* req, RetFormat rf, const std::vector<std::string>& path)
+{
+    if (path.size() != 1)
+        return RESTERR(req, HTTPStatusCode::BAD_REQUEST, "Invalid URI format. Expected /rest/stake/poolvalue.<ext>");
+
+    const CBlockIndex* pindex;
+    CAmount nPoolValue;
+    if (!GetTicketPoolValue(pindex, nPoolValue))
+        return RESTERR(req, HTTPStatusCode::INTERNAL_SERVER_ERROR, "Stake output of a live ticket not found");
+
+    CDataStream ssValue{SER_NETWORK, PROTOCOL_VERSION};
+    ssValue << static_cast<uint32_t>(pindex->nHeight) << pindex->GetBlockHash() << nPoolValue;
+
+    switch (rf) {
+    case RetFormat::BINARY: {
+        BinaryReply(req, ssValue);
+        return true;
+    }
+
+    case RetFormat::HEX: {
+        HexReply(req, ssValue);
+        return true;
+    }
+
+    case RetFormat::JSON: {
+        UniValue ret{UniValue::VOBJ};
+        ret.push_back(Pair("height", pindex->nHeight));
+        ret.push_back(Pair("hash", pindex->GetBlockHash().GetHex()));
+        ret.push_back(Pair("value", ValueFromAmount(nPoolValue)));
+        JsonReply(req, ret);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTPStatusCode::NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_stake(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const auto rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path[0] == "tickets")
+        return rest_stake_tickets(req, rf, path);
+    if (path[0] == "winners")
+        return rest_stake_winners(req, rf, path);
+    if (path[0] == "history")
+        return rest_stake_history(req, rf, path);
+    if (path[0] == "poolvalue")
+        return rest_stake_poolvalue(req, rf, path);
+    return RESTERR(req, HTTPStatusCode::NOT_FOUND, "Unknown stake data " + path[0] + " (available: tickets, winners, history, poolvalue)");
+}
+
 static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -567,6 +977,9 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/blockfilter/", rest_block_filter},
+      {"/rest/blockfilterheaders/", rest_block_filter_headers},
+      {"/rest/stake/", rest_stake},
       {"/rest/getutxos", rest_getutxos},
 };
 
@@ -9,6 +9,8 @@
 
 #include "rpc/blockchain.h"
 
+#include "blockcache.h"
+#include "blockfilterindex.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -18,11 +20,13 @@
 #include "consensus/validation.h"
 #include "validation.h"
 #include "core_io.h"
+#include "indexer.h"
 #include "net.h"
 #include "netbase.h"
 #include "policy/feerate.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -184,6 +188,25 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
+static bool BlockIncludesStake(const CBlockIndex* blockindex)
+{
+    return (!gArgs.GetBoolArg("-testnet", false)) || IsHybridConsensusForkEnabled(blockindex, Params().GetConsensus());
+}
+
+// the details of a transaction of a block, with the ticket of a revocation
+static UniValue blockTxToJSON(const CTransaction& tx, bool includeStake)
+{
+    UniValue objTx{UniValue::VOBJ};
+    std::map<uint256, CTransactionRef> prevOutMap;
+    if (ETxClass::TX_RevokeTicket == ParseTxClass(tx)) {
+        // extract the revoked ticket tx here
+        const auto& ticketHash = tx.vin[revocationStakeInputIndex].prevout.hash;
+        prevOutMap[ticketHash] = GetTicket(ticketHash);
+    }
+    TxToUniv(tx, uint256(), objTx, includeStake, true, RPCSerializationFlags(), &prevOutMap);
+    return objTx;
+}
+
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
 {
     UniValue result{UniValue::VOBJ};
@@ -201,22 +224,12 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("versionHex", strprintf("%08x", block.nVersion)));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    bool includeStake = (!gArgs.GetBoolArg("-testnet", false)) || IsHybridConsensusForkEnabled(blockindex, Params().GetConsensus());
+    bool includeStake = BlockIncludesStake(blockindex);
     UniValue txs{UniValue::VARR};
     for(const auto& tx : block.vtx)
     {
         if(txDetails)
-        {
-            UniValue objTx{UniValue::VOBJ};
-            std::map<uint256, CTransactionRef> prevOutMap;
-            if (ETxClass::TX_RevokeTicket == ParseTxClass(*tx)) {
-                // extract the revoked ticket tx here
-                const auto& ticketHash = tx->vin[revocationStakeInputIndex].prevout.hash;
-                prevOutMap[ticketHash] = GetTicket(ticketHash);
-            }
-            TxToUniv(*tx, uint256(), objTx, includeStake, true, RPCSerializationFlags(), &prevOutMap);
-            txs.push_back(objTx);
-        }
+            txs.push_back(blockTxToJSON(*tx, includeStake));
         else
             txs.push_back(tx->GetHash().GetHex());
     }
@@ -257,8 +270,7 @@ UniValue getblockcount(const JSONRPCRequest& request)
             + HelpExampleRpc("getblockcount", "")
         };
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainTipSnapshotForRPC()->nHeight;
 }
 
 UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -274,8 +286,15 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             + HelpExampleRpc("getbestblockhash", "")
         };
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetChainTipSnapshotForRPC()->hashBlock.GetHex();
+}
+
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshotForRPC()
+{
+    std::shared_ptr<const CChainTipSnapshot> snapshot = GetChainTipSnapshot();
+    if (snapshot == nullptr || snapshot->pstakeNode == nullptr)
+        throw JSONRPCError(RPCErrorCode::IN_WARMUP, "The chain is not loaded yet");
+    return snapshot;
 }
 
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex * pindex)
@@ -541,7 +560,21 @@ UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
-    return mempoolToJSON(fVerbose);
+    if (!fVerbose)
+        return mempoolToJSON(fVerbose);
+
+    // the entries are written one by one, instead of a whole tree
+    return StreamResult(request, [](JSONStreamWriter& writer) {
+        LOCK(mempool.cs);
+        writer.BeginObject();
+        for (const CTxMemPoolEntry& e : mempool.mapTx)
+        {
+            UniValue info{UniValue::VOBJ};
+            entryToJSON(info, e);
+            writer.KeyValue(e.GetTx().GetHash().ToString(), info);
+        }
+        writer.EndObject();
+    });
 }
 
 UniValue getmempoolancestors(const JSONRPCRequest& request)
@@ -838,8 +871,6 @@ UniValue getblock(const JSONRPCRequest& request)
             + HelpExampleRpc("getblock", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         };
 
-    LOCK(cs_main);
-
     const auto& strHash = request.params[0].get_str();
     const auto hash = uint256S(strHash);
 
@@ -851,31 +882,61 @@ UniValue getblock(const JSONRPCRequest& request)
             verbosity = request.params[1].get_bool() ? 1 : 0;
     }
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, "Block not found");
+    std::shared_ptr<const CBlock> pblock;
+    UniValue blockHeader;
+    bool includeStake;
+    {
+        LOCK(cs_main);
 
-    const auto * const pblockindex = mapBlockIndex[hash];
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Block not available (pruned data)");
+        const auto * const pblockindex = mapBlockIndex[hash];
 
-    CBlock block;
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-        // Block not found on disk. This could be because we have the block
-        // header in our index but don't have the block (for example if a
-        // non-whitelisted node sends us an unrequested long chain of valid
-        // blocks, we add the headers to our index, but don't accept the
-        // block).
-        throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Block not found on disk");
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Block not available (pruned data)");
 
-    if (verbosity <= 0)
-    {
-        CDataStream ssBlock{SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags()};
-        ssBlock << block;
-        return HexStr(ssBlock);
+        if (!ReadBlockFromDiskCached(pblock, pblockindex, Params().GetConsensus()))
+            // Block not found on disk. This could be because we have the block
+            // header in our index but don't have the block (for example if a
+            // non-whitelisted node sends us an unrequested long chain of valid
+            // blocks, we add the headers to our index, but don't accept the
+            // block).
+            throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Block not found on disk");
+
+        if (verbosity <= 0)
+        {
+            CDataStream ssBlock{SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags()};
+            ssBlock << *pblock;
+            return HexStr(ssBlock);
+        }
+
+        if (verbosity == 1)
+            return blockToJSON(*pblock, pblockindex, false);
+
+        blockHeader = blockToJSON(*pblock, pblockindex, false);
+        includeStake = BlockIncludesStake(pblockindex);
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    // the details of the transactions are written one by one, out of the lock
+    return StreamResult(request, [&](JSONStreamWriter& writer) {
+        writer.BeginObject();
+        const auto& keys = blockHeader.getKeys();
+        const auto& values = blockHeader.getValues();
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] != "tx") {
+                writer.KeyValue(keys[i], values[i]);
+                continue;
+            }
+
+            writer.Key("tx");
+            writer.BeginArray();
+            for (const auto& tx : pblock->vtx)
+                writer.Value(blockTxToJSON(*tx, includeStake));
+            writer.EndArray();
+        }
+        writer.EndObject();
+    });
 }
 
 struct CCoinsStats
@@ -1454,6 +1515,242 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+UniValue getblockcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || !request.params.empty())
+        throw std::runtime_error{
+            "getblockcacheinfo\n"
+            "\nReturns details on the cache of recently used blocks.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": xxxxx,             (numeric) Number of cached blocks\n"
+            "  \"usage\": xxxxx,              (numeric) Memory usage of the cached blocks\n"
+            "  \"maxusage\": xxxxx,           (numeric) Maximum memory usage of the cached blocks (see -blockcachesize)\n"
+            "  \"hits\": xxxxx,               (numeric) Number of lookups served from the cache\n"
+            "  \"misses\": xxxxx              (numeric) Number of lookups that had to read the block from disk\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockcacheinfo", "")
+            + HelpExampleRpc("getblockcacheinfo", "")
+        };
+
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("blocks", static_cast<uint64_t>(blockCache.Count())));
+    ret.push_back(Pair("usage", static_cast<uint64_t>(blockCache.DynamicMemoryUsage())));
+    ret.push_back(Pair("maxusage", static_cast<uint64_t>(blockCache.GetMaxSize())));
+    ret.push_back(Pair("hits", blockCache.GetHits()));
+    ret.push_back(Pair("misses", blockCache.GetMisses()));
+
+    return ret;
+}
+
+static UniValue DBStatsToJSON(const CDBWrapper& db)
+{
+    const CDBOptions& dbOptions = db.GetDBOptions();
+    UniValue options{UniValue::VOBJ};
+    options.push_back(Pair("blockcache", static_cast<uint64_t>(dbOptions.nBlockCacheSize)));
+    options.push_back(Pair("writebuffer", static_cast<uint64_t>(dbOptions.nWriteBufferSize)));
+    options.push_back(Pair("maxfilesize", static_cast<uint64_t>(dbOptions.nMaxFileSize)));
+    options.push_back(Pair("maxopenfiles", dbOptions.nMaxOpenFiles));
+    options.push_back(Pair("bloombits", dbOptions.nBloomBits));
+
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("options", options));
+
+    CDBStats stats;
+    if (!db.GetStats(stats))
+        return ret;
+
+    ret.push_back(Pair("memoryusage", static_cast<uint64_t>(stats.nMemoryUsage)));
+    ret.push_back(Pair("blockcacheusage", static_cast<uint64_t>(stats.nBlockCacheUsage)));
+    ret.push_back(Pair("memtableusage", static_cast<uint64_t>(stats.nMemoryUsage - std::min(stats.nMemoryUsage, stats.nBlockCacheUsage))));
+    UniValue levels{UniValue::VARR};
+    for (const CDBStats::Level& level : stats.vLevels) {
+        UniValue obj{UniValue::VOBJ};
+        obj.push_back(Pair("level", level.nLevel));
+        obj.push_back(Pair("files", level.nFiles));
+        obj.push_back(Pair("size", level.dSize));
+        obj.push_back(Pair("compactiontime", level.dCompactionTime));
+        obj.push_back(Pair("compactionread", level.dCompactionRead));
+        obj.push_back(Pair("compactionwrite", level.dCompactionWrite));
+        levels.push_back(obj);
+    }
+    ret.push_back(Pair("levels", levels));
+    return ret;
+}
+
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || !request.params.empty())
+        throw std::runtime_error{
+            "getdbstats\n"
+            "\nReturns the settings and the LevelDB statistics of the databases.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                    (json object) The database: blockindex or chainstate\n"
+            "    \"options\": {               (json object) The LevelDB settings (see -dboptions)\n"
+            "      \"blockcache\": xxxxx,     (numeric) Size of the block cache in bytes\n"
+            "      \"writebuffer\": xxxxx,    (numeric) Size of the write buffer in bytes\n"
+            "      \"maxfilesize\": xxxxx,    (numeric) Size of the table files in bytes\n"
+            "      \"maxopenfiles\": xxxxx,   (numeric) Number of table files kept open\n"
+            "      \"bloombits\": xxxxx,      (numeric) Bits per key of the bloom filter\n"
+            "    },\n"
+            "    \"memoryusage\": xxxxx,      (numeric) Memory used by the block cache and the memtables\n"
+            "    \"blockcacheusage\": xxxxx,  (numeric) Memory used by the block cache\n"
+            "    \"memtableusage\": xxxxx,    (numeric) Memory used by the memtables\n"
+            "    \"levels\": [                (json array) The non-empty levels\n"
+            "      {\n"
+            "        \"level\": n,             (numeric) The level\n"
+            "        \"files\": n,             (numeric) Number of table files\n"
+            "        \"size\": x.xxx,          (numeric) Size of the tables in MiB\n"
+            "        \"compactiontime\": x.xxx, (numeric) Time spent compacting into the level in seconds\n"
+            "        \"compactionread\": x.xxx, (numeric) Data read by those compactions in MiB\n"
+            "        \"compactionwrite\": x.xxx (numeric) Data written by those compactions in MiB\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        };
+
+    LOCK(cs_main);
+
+    UniValue ret{UniValue::VOBJ};
+    if (pblocktree)
+        ret.push_back(Pair("blockindex", DBStatsToJSON(*pblocktree)));
+    if (pcoinsdbview)
+        ret.push_back(Pair("chainstate", DBStatsToJSON(pcoinsdbview->GetDB())));
+
+    return ret;
+}
+
+UniValue latencySummaryToJSON(const CLatencyHistogram::Summary& summary)
+{
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("count", summary.nCount));
+    ret.push_back(Pair("total", summary.nTotal));
+    ret.push_back(Pair("average", summary.nCount > 0 ? summary.nTotal / static_cast<int64_t>(summary.nCount) : 0));
+    ret.push_back(Pair("p50", summary.nP50));
+    ret.push_back(Pair("p90", summary.nP90));
+    ret.push_back(Pair("p99", summary.nP99));
+    ret.push_back(Pair("max", summary.nMax));
+    return ret;
+}
+
+UniValue getvalidationstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error{
+            "getvalidationstats ( reset )\n"
+            "\nReturns the latencies of the stages of the block connection, stake stages included,\n"
+            "recorded since the start of the node or the last reset.\n"
+            "The percentiles are within 12.5% of their exact value.\n"
+            "\nArguments:\n"
+            "1. reset         (boolean, optional, default=false) Clear the statistics once returned\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"since\": xxxxx,          (numeric) The time the recording started, in seconds since epoch (Jan 1 1970 GMT)\n"
+            "  \"stages\": {               (json object) The stages, by name\n"
+            "    \"name\": {               (json object) A stage, in microseconds\n"
+            "      \"count\": n,           (numeric) Number of times the stage ran\n"
+            "      \"total\": n,           (numeric) Total time spent in the stage\n"
+            "      \"average\": n,         (numeric) Average latency\n"
+            "      \"p50\": n,             (numeric) Median latency\n"
+            "      \"p90\": n,             (numeric) 90th percentile latency\n"
+            "      \"p99\": n,             (numeric) 99th percentile latency\n"
+            "      \"max\": n              (numeric) Highest latency\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationstats", "")
+            + HelpExampleCli("getvalidationstats", "true")
+            + HelpExampleRpc("getvalidationstats", "")
+        };
+
+    const bool fReset = !request.params[0].isNull() && request.params[0].get_bool();
+
+    UniValue stages{UniValue::VOBJ};
+    for (int i = 0; i < static_cast<int>(ValidationStage::COUNT); ++i) {
+        const ValidationStage stage = static_cast<ValidationStage>(i);
+        stages.push_back(Pair(GetValidationStageName(stage), latencySummaryToJSON(GetValidationStageHistogram(stage).GetSummary())));
+    }
+
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("since", GetValidationStatsResetTime()));
+    ret.push_back(Pair("stages", stages));
+
+    if (fReset)
+        ResetValidationStats();
+
+    return ret;
+}
+
+static UniValue IndexInfoToJSON(const CBaseIndexer& indexer)
+{
+    AssertLockHeld(cs_main);
+    const CBlockIndex* pindexBest = indexer.GetBestBlockIndex();
+
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("synced", indexer.IsSynced()));
+    ret.push_back(Pair("best_block_height", pindexBest ? pindexBest->nHeight : -1));
+    return ret;
+}
+
+UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || !request.params.empty())
+        throw std::runtime_error{
+            "getindexinfo\n"
+            "\nReturns the status of the enabled indexes, which are built in the background.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                  (json object) The index: txindex, addrindex or blockfilterindex\n"
+            "    \"synced\": true|false,    (boolean) Whether the index includes the whole active chain\n"
+            "    \"best_block_height\": n   (numeric) The height of the last block included in the index\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+        };
+
+    LOCK(cs_main);
+
+    UniValue ret{UniValue::VOBJ};
+    if (g_txindex)
+        ret.push_back(Pair(g_txindex->GetName(), IndexInfoToJSON(*g_txindex)));
+    if (g_addrindex)
+        ret.push_back(Pair(g_addrindex->GetName(), IndexInfoToJSON(*g_addrindex)));
+    if (g_blockfilterindex)
+        ret.push_back(Pair(g_blockfilterindex->GetName(), IndexInfoToJSON(*g_blockfilterindex)));
+    return ret;
+}
+
+UniValue setindex(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 2)
+        throw std::runtime_error{
+            "setindex \"name\" enable\n"
+            "\nEnables or disables an index. An enabled index is built in the background, from the\n"
+            "block it was last left at; use getindexinfo to follow its progress.\n"
+            "\nArguments:\n"
+            "1. \"name\"    (string, required) The index: txindex, addrindex or blockfilterindex\n"
+            "2. enable      (boolean, required) Whether to maintain the index\n"
+            "\nExamples:\n"
+            + HelpExampleCli("setindex", "\"txindex\" true")
+            + HelpExampleRpc("setindex", "\"txindex\", true")
+        };
+
+    std::string strError;
+    if (!SetIndexEnabled(request.params[0].get_str(), request.params[1].get_bool(), strError))
+        throw JSONRPCError(RPCErrorCode::INVALID_PARAMETER, strError);
+
+    return NullUniValue;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1869,14 +2166,14 @@ UniValue ComputeBlocksTxFees(uint32_t startBlockHeight, uint32_t endBlockHeight,
             continue;
         }
 
-        CBlock block;
-        if (!ReadBlockFromDisk(block, blockIndex, Params().GetConsensus())) {
+        std::shared_ptr<const CBlock> pblock;
+        if (!ReadBlockFromDiskCached(pblock, blockIndex, Params().GetConsensus())) {
             continue;
         }
 
-        for (size_t i=1; i<block.vtx.size(); i++) // skip coinbase
+        for (size_t i=1; i<pblock->vtx.size(); i++) // skip coinbase
         {
-            const auto& tx = *block.vtx[i];
+            const auto& tx = *pblock->vtx[i];
             auto txCl = ParseTxClass(tx);
             if (txCl == txClass) {
                 txFees.push_back(computeTransactionFee(tx));
@@ -2045,44 +2342,78 @@ UniValue getblocksubsidy(const JSONRPCRequest& request)
     return result;
 }
 
+// the enabled filter index of the type named by the parameter; cs_main must be held
+static const CBlockFilterIndex& GetBlockFilterIndex(const UniValue& filterType)
+{
+    AssertLockHeld(cs_main);
+    BlockFilterType type = BlockFilterType::BASIC;
+    if (!filterType.isNull() && !BlockFilterTypeByName(filterType.get_str(), type))
+        throw JSONRPCError(RPCErrorCode::INVALID_PARAMETER, "Unknown filtertype");
+    if (!g_blockfilterindex || g_blockfilterindex->GetFilterType() != type)
+        throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Index is not enabled for filtertype " + BlockFilterTypeName(type) + ", see -blockfilterindex");
+    return *g_blockfilterindex;
+}
+
+static const CBlockIndex* GetFilterBlockIndex(const UniValue& hash)
+{
+    AssertLockHeld(cs_main);
+    const auto it = mapBlockIndex.find(ParseHashV(hash, "hash"));
+    if (it == mapBlockIndex.end())
+        throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, "Block not found");
+    return it->second;
+}
+
 UniValue getcfilter(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 2)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error{
-            "getcfilter ( hash filtertype )\n"
-            "\nReturns the committed filter for a block.\n"
+            "getcfilter \"hash\" ( \"filtertype\" )\n"
+            "\nReturns the committed filter (BIP 158) for a block. Requires -blockfilterindex.\n"
             "\nArguments:\n"
-            "1. hash        (hash)   The block hash of the filter being queried.\n"
-            "2. filtertype  (string) The type of committed filter to return.\n"
+            "1. \"hash\"        (string, required) The block hash of the filter being queried.\n"
+            "2. \"filtertype\"  (string, optional, default=basic) The type of committed filter to return.\n"
             "\nResult:\n"
-            "{\n"
-            "   \"filterbytes\":  (serialized bytes) The committed filter serialized with the N value and encoded as a hex string\n"
-            "}\n"
+            "\"filterbytes\"    (string) The committed filter serialized with the N value and encoded as a hex string\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getcfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
         };
-    
-    UniValue result{UniValue::VSTR};
-    result.setStr("000000");
-    return result;
+
+    LOCK(cs_main);
+    const CBlockFilterIndex& index = GetBlockFilterIndex(request.params[1]);
+    const CBlockIndex* pindex = GetFilterBlockIndex(request.params[0]);
+
+    BlockFilter filter;
+    if (!index.LookupFilter(pindex, filter))
+        throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Filter not found. Block filters are still in the process of being indexed.");
+    return HexStr(filter.GetEncodedFilter());
 }
 
 UniValue getcfilterheader(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 2)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error{
-            "getcfilterheader ( hash filtertype )\n"
+            "getcfilterheader \"hash\" ( \"filtertype\" )\n"
             "\nReturns the filter header hash committing to all filters in the chain up through a block.\n"
+            "Requires -blockfilterindex.\n"
             "\nArguments:\n"
-            "1. hash        (hash)   The block hash of the filter header being queried.\n"
-            "2. filtertype  (string) The type of committed filter to return the header commitment for.\n"
+            "1. \"hash\"        (string, required) The block hash of the filter header being queried.\n"
+            "2. \"filtertype\"  (string, optional, default=basic) The type of committed filter to return the header commitment for.\n"
             "\nResult:\n"
-            "{\n"
-            "   \"filterbytes\":  (serialized bytes) The filter header commitment hash\n"
-            "}\n"
+            "\"header\"         (string) The filter header commitment hash\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcfilterheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getcfilterheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
         };
-    
-    UniValue result{UniValue::VSTR};
-    result.setStr("000000");
-    return result;
+
+    LOCK(cs_main);
+    const CBlockFilterIndex& index = GetBlockFilterIndex(request.params[1]);
+    const CBlockIndex* pindex = GetFilterBlockIndex(request.params[0]);
+
+    uint256 header;
+    if (!index.LookupFilterHeader(pindex, header))
+        throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Filter not found. Block filters are still in the process of being indexed.");
+    return header.GetHex();
 }
 
 UniValue getvoteinfo(const JSONRPCRequest& request)
@@ -2173,31 +2504,36 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       {}, true },
     { "blockchain",         "getbestblock",           &getbestblock,           {} },
-    { "blockchain",         "getblockcount",          &getblockcount,          {} },
-    { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
-    { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
-    { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
+    { "blockchain",         "getblockcount",          &getblockcount,          {}, true },
+    { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"}, true },
+    { "blockchain",         "getblockcacheinfo",      &getblockcacheinfo,      {} },
+    { "blockchain",         "getblockhash",           &getblockhash,           {"height"}, true },
+    { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"}, true },
     { "blockchain",         "getblocksubsidy",        &getblocksubsidy,        {"height","voters"} },
     { "blockchain",         "getcfilter",             &getcfilter,             {"hash","filtertype"} },
-    { "blockchain",         "getcfilterheader",       &getcfilterheader,       {} },
+    { "blockchain",         "getcfilterheader",       &getcfilterheader,       {"hash","filtertype"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
     { "blockchain",         "setactivechaintip",      &setactivechaintip,      {"hash"} },
     { "blockchain",         "getcoinsupply",          &getcoinsupply,          {} },
     { "blockchain",         "getcurrentnet",          &getcurrentnet,          {} },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
+    { "blockchain",         "getdbstats",             &getdbstats,             {} },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          {}, true },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           {} },
     { "blockchain",         "getinfo",                &getinfo,                {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
-    { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"} },
+    { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"}, true },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
-    { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"}, true },
+    { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"}, true },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "getvalidationstats",     &getvalidationstats,     {"reset"} },
     { "blockchain",         "getvoteinfo",            &getvoteinfo,            {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
+    { "blockchain",         "setindex",               &setindex,               {"name","enable"} },
     { "blockchain",         "txfeeinfo",              &txfeeinfo,              {"blocks", "rangestart", "rangeend"} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
     { "blockchain",         "version",                &version,                {} },
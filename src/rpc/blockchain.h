@@ -9,12 +9,15 @@
 #define PAICOIN_RPC_BLOCKCHAIN_H
 
 #include "amount.h"
+#include "latencyhistogram.h"
 #include "stake/staketx.h"
+#include <memory>
 #include <vector>
 
 class CBlock;
 class CBlockIndex;
 class UniValue;
+struct CChainTipSnapshot;
 
 /**
  * Get the difficulty of the net wrt to the given block index, or the chain tip if
@@ -25,6 +28,9 @@ class UniValue;
  */
 double GetDifficulty(const CBlockIndex* blockindex = nullptr);
 
+/** The snapshot of the chain tip, read without cs_main; throws if the chain is not loaded yet */
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshotForRPC();
+
 /** Callback for when block tip changed. */
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 
@@ -40,6 +46,9 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
+/** Latency histogram summary to JSON, in microseconds */
+UniValue latencySummaryToJSON(const CLatencyHistogram::Summary& summary);
+
 CAmount ComputeMeanAmount(const std::vector<CAmount>& txFees);
 CAmount ComputeMedianAmount(std::vector<CAmount> txFees);
 CAmount ComputeStdDevAmount(const std::vector<CAmount>& txFees);
@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+
+#include "rpc/jsonstream.h"
+
+#include <assert.h>
+
+JSONStreamWriter::JSONStreamWriter(const Sink& sinkIn, const std::string& strPrefixIn, size_t nChunkSizeIn)
+    : sink(sinkIn), strPrefix(strPrefixIn), nChunkSize(nChunkSizeIn), fOutput(false), fAfterKey(false)
+{
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    BeginElement();
+    Write("{");
+    vEmpty.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    Write("}");
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    BeginElement();
+    Write("[");
+    vEmpty.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!vEmpty.empty());
+    vEmpty.pop_back();
+    Write("]");
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    BeginElement();
+    Write(UniValue(key).write());
+    Write(":");
+    fAfterKey = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    BeginElement();
+    Write(value.write());
+}
+
+void JSONStreamWriter::KeyValue(const std::string& key, const UniValue& value)
+{
+    Key(key);
+    Value(value);
+}
+
+void JSONStreamWriter::WriteRaw(const std::string& str)
+{
+    Write(str);
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (buffer.empty())
+        return;
+
+    sink(buffer);
+    buffer.clear();
+}
+
+void JSONStreamWriter::Write(const std::string& str)
+{
+    if (!fOutput) {
+        fOutput = true;
+        buffer = strPrefix;
+    }
+
+    buffer += str;
+    if (buffer.size() >= nChunkSize)
+        Flush();
+}
+
+void JSONStreamWriter::BeginElement()
+{
+    // a value after its key, or an element of an object or array
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (vEmpty.empty())
+        return;
+    if (!vEmpty.back())
+        Write(",");
+    vEmpty.back() = false;
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PAICOIN_RPC_JSONSTREAM_H
+#define PAICOIN_RPC_JSONSTREAM_H
+
+#include <univalue.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Writes a JSON document piece by piece, handing it to a sink in chunks of
+ * about nChunkSize bytes, so a huge result is never held as a whole in a
+ * UniValue tree or in a single string. The separators between the elements
+ * of the objects and arrays are written as needed.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string& chunk)> Sink;
+
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    /** strPrefix is written before the document, once anything is written */
+    explicit JSONStreamWriter(const Sink& sinkIn, const std::string& strPrefix = "", size_t nChunkSizeIn = DEFAULT_CHUNK_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    /** The key of the next value of an object */
+    void Key(const std::string& key);
+    void Value(const UniValue& value);
+    void KeyValue(const std::string& key, const UniValue& value);
+
+    /** Text written as is, out of the document */
+    void WriteRaw(const std::string& str);
+
+    /** Hand the pending output to the sink */
+    void Flush();
+
+    /** Whether anything was written, even if still pending */
+    bool HasOutput() const { return fOutput; }
+
+private:
+    Sink sink;
+    std::string strPrefix;
+    size_t nChunkSize;
+    std::string buffer;
+    bool fOutput;
+    // for each open object or array, whether it has no element yet
+    std::vector<bool> vEmpty;
+    bool fAfterKey;
+
+    void Write(const std::string& str);
+    void BeginElement();
+};
+
+#endif // PAICOIN_RPC_JSONSTREAM_H
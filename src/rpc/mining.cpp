@@ -23,6 +23,7 @@
 #include <policy/policy.h>
 #include <pow.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <rpc/mining.h>
 #include <rpc/server.h>
 #include <txmempool.h>
@@ -135,7 +136,7 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
         while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetHash(), pblock->nBits, pblock->nVersion, Params().GetConsensus())) {
-            ++pblock->nNonce;
+            pblock->SetNonce(pblock->nNonce + 1);
             --nMaxTries;
         }
         if (nMaxTries == 0) {
@@ -949,13 +950,11 @@ UniValue existsexpiredtickets(const JSONRPCRequest& request)
 
     auto result = UniValue{UniValue::VOBJ};
 
-    LOCK(cs_main);
-
-    CBlockIndex* pblockindex = chainActive.Tip();
+    const auto& snapshot = GetChainTipSnapshotForRPC();
 
     for (unsigned int idx = 0; idx < vTxids.size(); idx++) {
         const auto& tx = vTxids[idx];
-        const auto& exists = pblockindex->pstakeNode->ExistsExpiredTicket(tx);
+        const auto& exists = snapshot->pstakeNode->ExistsExpiredTicket(tx);
         result.push_back(Pair(tx.GetHex(), exists));
     }
 
@@ -979,9 +978,7 @@ UniValue existsliveticket(const JSONRPCRequest& request)
 
     const auto& txhash = ParseHashStr(request.params[0].get_str(), "txhash");
 
-    LOCK(cs_main);
-    CBlockIndex* pblockindex = chainActive.Tip();
-    const auto& exists = pblockindex->pstakeNode->ExistsLiveTicket(txhash);
+    const auto& exists = GetChainTipSnapshotForRPC()->pstakeNode->ExistsLiveTicket(txhash);
     return UniValue(exists);
 }
 
@@ -1013,13 +1010,11 @@ UniValue existslivetickets(const JSONRPCRequest& request)
 
     auto result = UniValue{UniValue::VOBJ};
 
-    LOCK(cs_main);
-
-    CBlockIndex* pblockindex = chainActive.Tip();
+    const auto& snapshot = GetChainTipSnapshotForRPC();
 
     for (unsigned int idx = 0; idx < vTxids.size(); idx++) {
         const auto& tx = vTxids[idx];
-        const auto& exists = pblockindex->pstakeNode->ExistsLiveTicket(tx);
+        const auto& exists = snapshot->pstakeNode->ExistsLiveTicket(tx);
         result.push_back(Pair(tx.GetHex(), exists));
     }
 
@@ -1054,13 +1049,11 @@ UniValue existsmissedtickets(const JSONRPCRequest& request)
 
     auto result = UniValue{UniValue::VOBJ};
 
-    LOCK(cs_main);
-
-    CBlockIndex* pblockindex = chainActive.Tip();
+    const auto& snapshot = GetChainTipSnapshotForRPC();
 
     for (unsigned int idx = 0; idx < vTxids.size(); idx++) {
         const auto& tx = vTxids[idx];
-        const auto& exists = pblockindex->pstakeNode->ExistsMissedTicket(tx);
+        const auto& exists = snapshot->pstakeNode->ExistsMissedTicket(tx);
         result.push_back(Pair(tx.GetHex(), exists));
     }
 
@@ -1080,28 +1073,22 @@ UniValue getticketpoolvalue(const JSONRPCRequest& request)
             + HelpExampleRpc("getticketpoolvalue", "")
         };
 
-    LOCK(cs_main);
-    CBlockIndex* pblockindex = chainActive.Tip();
-    const auto& liveTickets = pblockindex->pstakeNode->LiveTickets();
-    auto sum = CAmount{};
-    for (const auto& tx : liveTickets){
-        const COutPoint out{tx, static_cast<uint32_t>(ticketStakeOutputIndex)};
-        Coin coin;
-        if (!pcoinsTip->GetCoin(out, coin)) {
-            return NullUniValue;
-        }
-        sum += coin.out.nValue;
-    }
-    return ValueFromAmount(sum);
+    const CBlockIndex* pindexTip;
+    CAmount nPoolValue;
+    if (!GetTicketPoolValue(pindexTip, nPoolValue))
+        throw JSONRPCError(RPCErrorCode::DATABASE_ERROR, "Stake output of a live ticket not found");
+    return ValueFromAmount(nPoolValue);
 }
 
-static int getTicketPurchaseHeight(const uint256& hashBlock)
+// the height of the block of a ticket, in the chain of the given block
+static int getTicketPurchaseHeight(const uint256& hashBlock, const CBlockIndex* pblockindex)
 {
     auto purchaseHeight = -1;
+    LOCK(cs_main);
     BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
     if (mi != mapBlockIndex.end() && (*mi).second) {
         CBlockIndex* pindex = (*mi).second;
-        if (chainActive.Contains(pindex))
+        if (pblockindex->GetAncestor(pindex->nHeight) == pindex)
             purchaseHeight = pindex->nHeight;
     }
     if (purchaseHeight < Params().GetConsensus().nHybridConsensusHeight)
@@ -1131,39 +1118,52 @@ UniValue livetickets(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
-    auto nHeight = chainActive.Height();
+    const auto& snapshot = GetChainTipSnapshotForRPC();
+    auto nHeight = snapshot->nHeight;
     if (!request.params[1].isNull()) {
         nHeight = request.params[1].get_int();
-        if (nHeight < 0 || nHeight > chainActive.Height())
+        if (nHeight < 0 || nHeight > snapshot->nHeight)
             throw JSONRPCError(RPCErrorCode::INVALID_PARAMETER, "Block height out of range");
     }
 
-    LOCK(cs_main);
-    CBlockIndex* pblockindex = chainActive[nHeight];
-    const auto& liveTickets = pblockindex->pstakeNode->LiveTickets();
-    auto result = UniValue{UniValue::VOBJ};
-    auto array = UniValue{UniValue::VARR};
-    for (const auto& txhash : liveTickets){
-        if (fVerbose) {
-            CTransactionRef tx;
-            uint256 hashBlock;
-            if (!GetTransaction(txhash, tx, Params().GetConsensus(), hashBlock, true, false))
-                throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, "No such blockchain transaction");
+    // the stake nodes below the tip may still have to be loaded, under the lock,
+    // and are only used through the pointer taken there
+    const CBlockIndex* pblockindex = snapshot->pindex->GetAncestor(nHeight);
+    std::shared_ptr<StakeNode> pstakeNode;
+    if (pblockindex == snapshot->pindex) {
+        pstakeNode = snapshot->pstakeNode;
+    } else {
+        LOCK(cs_main);
+        pstakeNode = FetchStakeNode(const_cast<CBlockIndex*>(pblockindex), Params().GetConsensus());
+    }
+    const HashVector liveTickets = pstakeNode->LiveTickets();
 
-            auto info = UniValue{UniValue::VOBJ};
-            info.pushKV("txid", txhash.GetHex());
-            StakingToUniv(*tx, info, false);
+    return StreamResult(request, [&](JSONStreamWriter& writer) {
+        writer.BeginObject();
+        writer.Key("tickets");
+        writer.BeginArray();
+        for (const auto& txhash : liveTickets){
+            if (fVerbose) {
+                CTransactionRef tx;
+                uint256 hashBlock;
+                if (!GetTransaction(txhash, tx, Params().GetConsensus(), hashBlock, true, false))
+                    throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, "No such blockchain transaction");
 
-            const auto& purchaseHeight =  getTicketPurchaseHeight(hashBlock);
-            info.push_back(Pair("purchase_height", purchaseHeight));
+                auto info = UniValue{UniValue::VOBJ};
+                info.pushKV("txid", txhash.GetHex());
+                StakingToUniv(*tx, info, false);
 
-            array.push_back(info);
-        } else {
-            array.push_back(txhash.GetHex());
+                const auto& purchaseHeight =  getTicketPurchaseHeight(hashBlock, pblockindex);
+                info.push_back(Pair("purchase_height", purchaseHeight));
+
+                writer.Value(info);
+            } else {
+                writer.Value(txhash.GetHex());
+            }
         }
-    }
-    result.push_back(Pair("tickets",array));
-    return result;
+        writer.EndArray();
+        writer.EndObject();
+    });
 }
 
 UniValue winningtickets(const JSONRPCRequest& request)
@@ -1183,10 +1183,11 @@ UniValue winningtickets(const JSONRPCRequest& request)
             + HelpExampleRpc("winningtickets", "")
         };
 
-    auto nHeight = chainActive.Height();
+    const auto& snapshot = GetChainTipSnapshotForRPC();
+    auto nHeight = snapshot->nHeight;
     if (!request.params[0].isNull()) {
         nHeight = request.params[0].get_int();
-        if (nHeight < 0 || nHeight > chainActive.Height())
+        if (nHeight < 0 || nHeight > snapshot->nHeight)
             throw JSONRPCError(RPCErrorCode::INVALID_PARAMETER, "Block height out of range");
     }
 
@@ -1243,50 +1244,66 @@ UniValue missedtickets(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
-    auto nHeight = chainActive.Height();
+    const auto& snapshot = GetChainTipSnapshotForRPC();
+    auto nHeight = snapshot->nHeight;
     if (!request.params[1].isNull()) {
         nHeight = request.params[1].get_int();
-        if (nHeight < 0 || nHeight > chainActive.Height())
+        if (nHeight < 0 || nHeight > snapshot->nHeight)
             throw JSONRPCError(RPCErrorCode::INVALID_PARAMETER, "Block height out of range");
     }
 
-    LOCK(cs_main);
-    CBlockIndex* pblockindex = chainActive[nHeight];
-    const auto& missedTickets = pblockindex->pstakeNode->MissedTickets();
-    auto result = UniValue{UniValue::VOBJ};
-    auto array = UniValue{UniValue::VARR};
-    for (const auto& txhash : missedTickets){
-        if (fVerbose) {
-            CTransactionRef tx;
-            uint256 hashBlock;
-            if (!GetTransaction(txhash, tx, Params().GetConsensus(), hashBlock, true, false))
-                throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, "No such blockchain transaction");
-
-            auto info = UniValue{UniValue::VOBJ};
-            info.pushKV("txid", txhash.GetHex());
-            StakingToUniv(*tx, info, false);
-
-            const auto& purchaseHeight =  getTicketPurchaseHeight(hashBlock);
-            info.push_back(Pair("purchase_height", purchaseHeight));
-
-            const auto& bExpired = pblockindex->pstakeNode->ExistsExpiredTicket(txhash);
-            info.push_back(Pair("cause", bExpired ? "expiration" : "missed_vote"));
-            if (!bExpired) {
-                auto missedHeight = nHeight - 1;
-                for (; missedHeight > purchaseHeight + Params().GetConsensus().nTicketMaturity 
-                       && chainActive[missedHeight]->pstakeNode->ExistsMissedTicket(txhash); --missedHeight);
-                info.push_back(Pair("missed_height", missedHeight + 1));
+    // the stake nodes below the tip may still have to be loaded, under the lock,
+    // and are only used through the pointer taken there
+    const CBlockIndex* pblockindex = snapshot->pindex->GetAncestor(nHeight);
+    std::shared_ptr<StakeNode> pstakeNode;
+    if (pblockindex == snapshot->pindex) {
+        pstakeNode = snapshot->pstakeNode;
+    } else {
+        LOCK(cs_main);
+        pstakeNode = FetchStakeNode(const_cast<CBlockIndex*>(pblockindex), Params().GetConsensus());
+    }
+    const HashVector missedTickets = pstakeNode->MissedTickets();
+
+    return StreamResult(request, [&](JSONStreamWriter& writer) {
+        writer.BeginObject();
+        writer.Key("tickets");
+        writer.BeginArray();
+        for (const auto& txhash : missedTickets){
+            if (fVerbose) {
+                CTransactionRef tx;
+                uint256 hashBlock;
+                if (!GetTransaction(txhash, tx, Params().GetConsensus(), hashBlock, true, false))
+                    throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, "No such blockchain transaction");
+
+                auto info = UniValue{UniValue::VOBJ};
+                info.pushKV("txid", txhash.GetHex());
+                StakingToUniv(*tx, info, false);
+
+                const auto& purchaseHeight =  getTicketPurchaseHeight(hashBlock, pblockindex);
+                info.push_back(Pair("purchase_height", purchaseHeight));
+
+                const auto& bExpired = pstakeNode->ExistsExpiredTicket(txhash);
+                info.push_back(Pair("cause", bExpired ? "expiration" : "missed_vote"));
+                if (!bExpired) {
+                    auto missedHeight = nHeight - 1;
+                    {
+                        LOCK(cs_main);
+                        for (; missedHeight > purchaseHeight + Params().GetConsensus().nTicketMaturity
+                               && FetchStakeNode(const_cast<CBlockIndex*>(pblockindex->GetAncestor(missedHeight)), Params().GetConsensus())->ExistsMissedTicket(txhash); --missedHeight);
+                    }
+                    info.push_back(Pair("missed_height", missedHeight + 1));
+                } else {
+                    info.push_back(Pair("missed_height", nullptr));
+                }
+
+                writer.Value(info);
             } else {
-                info.push_back(Pair("missed_height", nullptr));
+                writer.Value(txhash.GetHex());
             }
-
-            array.push_back(info);
-        } else {
-            array.push_back(txhash.GetHex());
         }
-    }
-    result.push_back(Pair("tickets",array));
-    return result;
+        writer.EndArray();
+        writer.EndObject();
+    });
 }
 
 UniValue ticketfeeinfo(const JSONRPCRequest& request)
@@ -1799,14 +1816,14 @@ static const CRPCCommand commands[] =
     { "mining",             "getblocktemplate",             &getblocktemplate,              {"template_request"} },
     { "mining",             "submitblock",                  &submitblock,                   {"hexdata","dummy"} },
 
-    { "mining",             "existsexpiredtickets",         &existsexpiredtickets,          {"txhashes"} },
-    { "mining",             "existsliveticket",             &existsliveticket,              {"txhash"} },
-    { "mining",             "existsmissedtickets",          &existsmissedtickets,           {"txhashes"} },
-    { "mining",             "existslivetickets",            &existslivetickets,             {"txhashes"} },
-    { "mining",             "getticketpoolvalue",           &getticketpoolvalue,            {} },
-    { "mining",             "livetickets",                  &livetickets,                   {"verbose", "blockheight"} },
-    { "mining",             "winningtickets",               &winningtickets,                {"blockheight"} },
-    { "mining",             "missedtickets",                &missedtickets,                 {"verbose", "blockheight"} },
+    { "mining",             "existsexpiredtickets",         &existsexpiredtickets,          {"txhashes"}, true },
+    { "mining",             "existsliveticket",             &existsliveticket,              {"txhash"}, true },
+    { "mining",             "existsmissedtickets",          &existsmissedtickets,           {"txhashes"}, true },
+    { "mining",             "existslivetickets",            &existslivetickets,             {"txhashes"}, true },
+    { "mining",             "getticketpoolvalue",           &getticketpoolvalue,            {}, true },
+    { "mining",             "livetickets",                  &livetickets,                   {"verbose", "blockheight"}, true },
+    { "mining",             "winningtickets",               &winningtickets,                {"blockheight"}, true },
+    { "mining",             "missedtickets",                &missedtickets,                 {"verbose", "blockheight"}, true },
     { "mining",             "ticketfeeinfo",                &ticketfeeinfo,                 {"blocks","windows"} },
     { "mining",             "ticketsforaddress",            &ticketsforaddress,             {"address"} },
     { "mining",             "ticketvwap",                   &ticketvwap,                    {"start","stop"} },
@@ -12,6 +12,7 @@
 #include <core_io.h>
 #include <init.h>
 #include <key_io.h>
+#include <lockprofile.h>
 #include <validation.h>
 #include <httpserver.h>
 #include <txmempool.h>
@@ -30,6 +31,7 @@
 #include <warnings.h>
 
 #include <stdint.h>
+#include <algorithm>
 #include <iterator>
 #include <string>
 #include <bitset>
@@ -153,6 +155,104 @@ UniValue existsaddresses(const JSONRPCRequest& request)
     return ret;
 }
 
+static CTxDestination AddressIndexDestination(const std::string& strAddress)
+{
+    if (!fAddrIndex)
+        throw JSONRPCError(RPCErrorCode::MISC_ERROR, "Address index not enabled");
+
+    CTxDestination destination = DecodeDestination(strAddress);
+    if (!IsValidDestination(destination))
+        throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, std::string("Invalid PAIcoin address: ") + strAddress);
+    return destination;
+}
+
+UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error{
+            "getaddressbalance \"address\"\n"
+            "\nReturns the balance of an address, from the address index (requires -addrindex).\n"
+            "\nArguments:\n"
+            "1. \"address\"     (string, required) The paicoin address\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\": x.xxx,   (numeric) The value of the unspent outputs paying to the address in " + CURRENCY_UNIT + "\n"
+            "  \"received\": x.xxx,  (numeric) The value of all the outputs ever paying to the address in " + CURRENCY_UNIT + "\n"
+            "  \"unspent\": n,       (numeric) The number of unspent outputs\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressbalance", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"")
+            + HelpExampleRpc("getaddressbalance", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"")
+        };
+
+    const CTxDestination destination = AddressIndexDestination(request.params[0].get_str());
+
+    std::vector<std::pair<COutPoint, CAddrIndexOutValue>> outputs;
+    if (!FindOutputsByDestination(destination, outputs, false))
+        throw JSONRPCError(RPCErrorCode::DATABASE_ERROR, "Cannot search for address");
+
+    CAmount nBalance = 0, nReceived = 0;
+    int nUnspent = 0;
+    for (const auto& output : outputs) {
+        nReceived += output.second.nValue;
+        if (!output.second.IsSpent()) {
+            nBalance += output.second.nValue;
+            ++nUnspent;
+        }
+    }
+
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("balance", ValueFromAmount(nBalance)));
+    ret.push_back(Pair("received", ValueFromAmount(nReceived)));
+    ret.push_back(Pair("unspent", nUnspent));
+    return ret;
+}
+
+UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error{
+            "getaddressutxos \"address\"\n"
+            "\nReturns the unspent outputs paying to an address, from the address index (requires -addrindex).\n"
+            "\nArguments:\n"
+            "1. \"address\"     (string, required) The paicoin address\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"hash\",     (string) The transaction id\n"
+            "    \"vout\": n,          (numeric) The output index\n"
+            "    \"amount\": x.xxx,    (numeric) The output value in " + CURRENCY_UNIT + "\n"
+            "    \"height\": n         (numeric) The height of the block containing the transaction\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressutxos", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"")
+            + HelpExampleRpc("getaddressutxos", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"")
+        };
+
+    const CTxDestination destination = AddressIndexDestination(request.params[0].get_str());
+
+    std::vector<std::pair<COutPoint, CAddrIndexOutValue>> outputs;
+    if (!FindOutputsByDestination(destination, outputs, true))
+        throw JSONRPCError(RPCErrorCode::DATABASE_ERROR, "Cannot search for address");
+
+    // oldest first, as the index keeps them by outpoint
+    std::sort(outputs.begin(), outputs.end(), [](const std::pair<COutPoint, CAddrIndexOutValue>& a, const std::pair<COutPoint, CAddrIndexOutValue>& b) {
+        return a.second.nHeight < b.second.nHeight || (a.second.nHeight == b.second.nHeight && a.first < b.first);
+    });
+
+    UniValue ret{UniValue::VARR};
+    for (const auto& output : outputs) {
+        UniValue obj{UniValue::VOBJ};
+        obj.push_back(Pair("txid", output.first.hash.GetHex()));
+        obj.push_back(Pair("vout", static_cast<int>(output.first.n)));
+        obj.push_back(Pair("amount", ValueFromAmount(output.second.nValue)));
+        obj.push_back(Pair("height", output.second.nHeight));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
 UniValue existsmempooltxs(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -593,6 +693,88 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+static UniValue LockProfileToJSON(const CLockProfile& profile, size_t nCallSites)
+{
+    UniValue callsites{UniValue::VARR};
+    for (const CLockProfile::CallSite& site : profile.GetTopCallSites(nCallSites)) {
+        UniValue obj{UniValue::VOBJ};
+        obj.push_back(Pair("site", strprintf("%s:%d", site.strFile, site.nLine)));
+        obj.push_back(Pair("samples", site.nSamples));
+        obj.push_back(Pair("wait", site.nWait));
+        obj.push_back(Pair("hold", site.nHold));
+        obj.push_back(Pair("maxhold", site.nMaxHold));
+        callsites.push_back(obj);
+    }
+
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("acquisitions", profile.GetAcquisitions()));
+    ret.push_back(Pair("contentions", profile.GetContentions()));
+    ret.push_back(Pair("wait", latencySummaryToJSON(profile.GetWaitHistogram().GetSummary())));
+    ret.push_back(Pair("hold", latencySummaryToJSON(profile.GetHoldHistogram().GetSummary())));
+    ret.push_back(Pair("callsites", callsites));
+    return ret;
+}
+
+UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        throw std::runtime_error{
+            "getlockstats ( count reset )\n"
+            "\nReturns the contention profiles of cs_main, mempool.cs and cs_wallet, recorded since\n"
+            "the start of the node or the last reset. Every acquisition is counted, and one in\n"
+            "-lockprofilesample acquisitions is timed and charged to the file and line locking the mutex.\n"
+            "The times are in microseconds and the percentiles within 12.5% of their exact value.\n"
+            "\nArguments:\n"
+            "1. count         (numeric, optional, default=10) The number of call sites reported per mutex\n"
+            "2. reset         (boolean, optional, default=false) Clear the profiles once returned\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"since\": xxxxx,            (numeric) The time the recording started, in seconds since epoch (Jan 1 1970 GMT)\n"
+            "  \"sample\": n,               (numeric) One in how many acquisitions are sampled\n"
+            "  \"locks\": {                 (json object) The profiled mutexes, by name\n"
+            "    \"name\": {\n"
+            "      \"acquisitions\": n,     (numeric) Number of acquisitions\n"
+            "      \"contentions\": n,      (numeric) Number of acquisitions that waited for the mutex\n"
+            "      \"wait\": {...},         (json object) The waits of the samples: count, total, average, p50, p90, p99 and max\n"
+            "      \"hold\": {...},         (json object) How long the samples held the mutex, as for wait\n"
+            "      \"callsites\": [         (json array) The call sites that held the mutex the longest in all\n"
+            "        {\n"
+            "          \"site\": \"file:line\", (string) The call site\n"
+            "          \"samples\": n,        (numeric) Number of samples\n"
+            "          \"wait\": n,           (numeric) Total wait of the samples\n"
+            "          \"hold\": n,           (numeric) Total hold of the samples\n"
+            "          \"maxhold\": n         (numeric) Longest hold of a sample\n"
+            "        }, ...\n"
+            "      ]\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "20 true")
+            + HelpExampleRpc("getlockstats", "")
+        };
+
+    const int nCallSites = request.params[0].isNull() ? 10 : request.params[0].get_int();
+    if (nCallSites < 0)
+        throw JSONRPCError(RPCErrorCode::INVALID_PARAMETER, "Negative count");
+    const bool fReset = !request.params[1].isNull() && request.params[1].get_bool();
+
+    UniValue locks{UniValue::VOBJ};
+    for (const CLockProfile* pprofile : GetLockProfiles())
+        locks.push_back(Pair(pprofile->GetName(), LockProfileToJSON(*pprofile, nCallSites)));
+
+    UniValue ret{UniValue::VOBJ};
+    ret.push_back(Pair("since", GetLockProfilesResetTime()));
+    ret.push_back(Pair("sample", static_cast<uint64_t>(GetLockProfileSample())));
+    ret.push_back(Pair("locks", locks));
+
+    if (fReset)
+        ResetLockProfiles();
+
+    return ret;
+}
+
 static uint32_t getCategoryMask(UniValue cats) {
     cats = cats.get_array();
     uint32_t mask{0};
@@ -676,10 +858,13 @@ UniValue echo(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
+    { "control",            "getlockstats",           &getlockstats,           {"count","reset"} },
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} }, /* uses wallet if enabled */
     { "util",               "existsaddress",          &existsaddress,          {"address"} },
     { "util",               "existsaddresses",        &existsaddresses,        {"addresses"} },
+    { "util",               "getaddressbalance",      &getaddressbalance,      {"address"} },
+    { "util",               "getaddressutxos",        &getaddressutxos,        {"address"} },
     { "util",               "existsmempooltxs",       &existsmempooltxs,       {"txhashes"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
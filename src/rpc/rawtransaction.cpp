@@ -342,25 +342,21 @@ UniValue searchrawtransactions(const JSONRPCRequest& request)
     if (!IsValidDestination(destination))
         throw JSONRPCError(RPCErrorCode::INVALID_ADDRESS_OR_KEY, std::string("Invalid PAIcoin address: ") + name_);
 
-    std::set<CExtDiskTxPos> setpos;
-    if (!FindTransactionsByDestination(destination, setpos))
-        throw JSONRPCError(RPCErrorCode::DATABASE_ERROR, "Cannot search for address");
-
-    if (nSkip < 0)
-        nSkip += setpos.size();
-    if (nSkip < 0)
-        nSkip = 0;
     if (nCount < 0)
         nCount = 0;
-    
-    auto it = setpos.cbegin();
 
-    while (it != setpos.end() && nSkip--) ++it;
+    // Only the requested page is read from the index, which keeps the
+    // transactions of an address in chain order. A negative skip counts
+    // from the most recent transaction, and starts from the first one when
+    // the address has fewer transactions.
+    std::vector<CExtDiskTxPos> vpos;
+    if (!FindTransactionsByDestination(destination, vpos, nSkip, nCount))
+        throw JSONRPCError(RPCErrorCode::DATABASE_ERROR, "Cannot search for address");
 
     bool isTestnet = gArgs.GetBoolArg("-testnet", false);
 
     UniValue result(UniValue::VARR);
-    while (it != setpos.end() && nCount--) {
+    for (auto it = vpos.cbegin(); it != vpos.end(); ++it) {
         CTransactionRef tx;
         uint256 hashBlock;
         if (!ReadTransaction(tx, *it, hashBlock))
@@ -381,7 +377,6 @@ UniValue searchrawtransactions(const JSONRPCRequest& request)
         } else {
             result.push_back(strHex);
         }
-        ++it;
     }
 
     if (fReverse){
@@ -1231,11 +1226,11 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      {"txid","verbose"} },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      {"txid","verbose"}, true },
     { "rawtransactions",    "searchrawtransactions",  &searchrawtransactions,  {"address","verbose","skip","count","vinextra","reverse","filteraddrs"} },
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   {"inputs","outputs","locktime","replaceable"} },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   {"hexstring"} },
-    { "rawtransactions",    "decodescript",           &decodescript,           {"hexstring"} },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   {"hexstring"}, true },
+    { "rawtransactions",    "decodescript",           &decodescript,           {"hexstring"}, true },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     {"hexstring","allowhighfees"} },
     { "rawtransactions",    "combinerawtransaction",  &combinerawtransaction,  {"txs"} },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     {"hexstring","prevtxs","privkeys","sighashtype"} }, /* uses wallet if enabled */
@@ -13,6 +13,7 @@
 #include <init.h>
 #include <key_io.h>
 #include <random.h>
+#include <rpc/jsonstream.h>
 #include <sync.h>
 #include <ui_interface.h>
 #include <util.h>
@@ -26,7 +27,10 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
+#include <atomic>
+#include <condition_variable>
 #include <memory> // for unique_ptr
+#include <mutex>
 #include <unordered_map>
 #include <iterator>
 
@@ -422,15 +426,109 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+static bool IsConcurrentRequest(const UniValue& req)
 {
+    if (!req.isObject())
+        return false;
+    const auto& valMethod = find_value(req, "method");
+    if (!valMethod.isStr())
+        return false;
+    const auto pcmd = tableRPC[valMethod.get_str()];
+    return pcmd != nullptr && pcmd->fConcurrent;
+}
+
+/**
+ * The entries of a batch being executed concurrently. The queued tasks claim
+ * the entries one by one, as does the thread of the batch, which so never
+ * waits for a task that did not start, and the tasks that start late find
+ * nothing left to do. The requests are only accessed for a claimed entry.
+ */
+struct CBatchExecution
+{
+    const JSONRPCRequest* jreq;
+    const UniValue* vReq;
+    size_t nBegin;
+    size_t nEnd;
+    std::vector<UniValue> vReplies;
+
+    std::atomic<size_t> nNext;
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t nDone;
+
+    CBatchExecution(const JSONRPCRequest& jreqIn, const UniValue& vReqIn, size_t nBeginIn, size_t nEndIn)
+        : jreq(&jreqIn), vReq(&vReqIn), nBegin(nBeginIn), nEnd(nEndIn), vReplies(nEndIn - nBeginIn), nNext(nBeginIn), nDone(0) {}
+
+    void Run()
+    {
+        for (size_t reqIdx = nNext++; reqIdx < nEnd; reqIdx = nNext++) {
+            UniValue reply = JSONRPCExecOne(*jreq, (*vReq)[reqIdx]);
+
+            std::lock_guard<std::mutex> lock(cs);
+            vReplies[reqIdx - nBegin] = std::move(reply);
+            if (++nDone == nEnd - nBegin)
+                cond.notify_all();
+        }
+    }
+
+    void WaitDone()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this] { return nDone == nEnd - nBegin; });
+    }
+};
+
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCTaskQueue& queueTask)
+{
+    const size_t nConcurrency = static_cast<size_t>(std::max((long)gArgs.GetArg("-rpcbatchconcurrency", DEFAULT_RPC_BATCH_CONCURRENCY), 1L));
+
     UniValue ret{UniValue::VARR};
-    for (size_t reqIdx{0}; reqIdx < vReq.size(); ++reqIdx)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    for (size_t reqIdx{0}; reqIdx < vReq.size();) {
+        // the run of concurrent entries starting here, if any
+        size_t reqEnd{reqIdx};
+        while (reqEnd < vReq.size() && IsConcurrentRequest(vReq[reqEnd]))
+            ++reqEnd;
+
+        if (!queueTask || nConcurrency == 1 || reqEnd - reqIdx < 2) {
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+            ++reqIdx;
+            continue;
+        }
+
+        auto execution = std::make_shared<CBatchExecution>(jreq, vReq, reqIdx, reqEnd);
+        const size_t nTasks = std::min(nConcurrency, reqEnd - reqIdx) - 1;
+        for (size_t i = 0; i < nTasks; ++i)
+            if (!queueTask([execution] { execution->Run(); }))
+                break;
+        execution->Run();
+        execution->WaitDone();
+
+        for (UniValue& reply : execution->vReplies)
+            ret.push_back(std::move(reply));
+        reqIdx = reqEnd;
+    }
 
     return ret.write() + "\n";
 }
 
+UniValue StreamResult(const JSONRPCRequest& request, const std::function<void(JSONStreamWriter& writer)>& writeResult)
+{
+    if (request.stream) {
+        writeResult(*request.stream);
+        return NullUniValue;
+    }
+
+    std::string strResult;
+    JSONStreamWriter writer([&strResult](const std::string& chunk) { strResult += chunk; });
+    writeResult(writer);
+    writer.Flush();
+
+    UniValue result;
+    if (!result.read(strResult))
+        throw JSONRPCError(RPCErrorCode::INTERNAL_ERROR, "Invalid result");
+    return result;
+}
+
 /**
  * Process named arguments into a vector of positional arguments, based on the
  * passed-in specification for the RPC call's arguments.
@@ -22,8 +22,11 @@
 #include <univalue.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION{1};
+/** The number of entries of a batch request that may run at the same time */
+static const int DEFAULT_RPC_BATCH_CONCURRENCY{4};
 
 class CRPCCommand;
+class JSONStreamWriter;
 
 namespace RPCServer
 {
@@ -49,6 +52,8 @@ public:
     bool fHelp{false};
     std::string URI;
     std::string authUser;
+    /** Where the result may be written while it is built, see StreamResult; null when the result is returned */
+    JSONStreamWriter* stream{nullptr};
 
     void parse(const UniValue& valRequest);
 };
@@ -133,10 +138,17 @@ typedef UniValue(*rpcfn_type)(const JSONRPCRequest& jsonRequest);
 class CRPCCommand
 {
 public:
+    CRPCCommand(const std::string& categoryIn, const std::string& nameIn, rpcfn_type actorIn,
+                const std::vector<std::string>& argNamesIn, bool fConcurrentIn = false)
+        : category(categoryIn), name(nameIn), actor(actorIn), argNames(argNamesIn), fConcurrent(fConcurrentIn) {}
+
     std::string category;
     std::string name;
     rpcfn_type actor;
     std::vector<std::string> argNames;
+    // whether the handler may run at the same time as the other entries of a
+    // batch, which it may if it only reads and takes the locks it needs
+    bool fConcurrent;
 };
 
 /**
@@ -194,7 +206,24 @@ extern std::string HelpExampleRpc(const std::string& methodname, const std::stri
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+
+/** Runs a task on another thread, or returns false, in which case the task is not run */
+typedef std::function<bool(const std::function<void()>& task)> RPCTaskQueue;
+
+/**
+ * Execute the entries of a batch request and return the array of their replies.
+ * The consecutive entries of concurrent commands are spread over queueTask, up to
+ * -rpcbatchconcurrency at a time, while the other entries run alone, in order.
+ */
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCTaskQueue& queueTask = nullptr);
+
+/**
+ * Write the result of a request with writeResult, into the stream of the request
+ * if it has one, in which case the null value is returned, or else into the
+ * value returned. The data of a huge result should be collected beforehand,
+ * so the locks are not held while it is written.
+ */
+UniValue StreamResult(const JSONRPCRequest& request, const std::function<void(JSONStreamWriter& writer)>& writeResult);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
@@ -8,6 +8,7 @@
 #include "chain.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "rpc/blockchain.h"
 #include "rpc/safemode.h"
 #include "rpc/server.h"
 #include "sync.h"
@@ -142,10 +143,9 @@ UniValue getstakedifficulty(const JSONRPCRequest& request)
         );
 
 
-    LOCK(cs_main);
-    const auto& blockHeader = chainActive.Tip()->GetBlockHeader();
-    const auto& currentSdiff = blockHeader.nStakeDifficulty;
-    const auto& nextSdiff = CalculateNextRequiredStakeDifficulty(chainActive.Tip(), Params().GetConsensus());
+    const auto& snapshot = GetChainTipSnapshotForRPC();
+    const auto& currentSdiff = snapshot->nStakeDifficulty;
+    const auto& nextSdiff = snapshot->nNextStakeDifficulty;
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("current", ValueFromAmount(currentSdiff)));
@@ -361,7 +361,7 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "stakeapi",           "estimatestakediff",      &estimatestakediff,      {"numtickets"}   },
-    { "stakeapi",           "getstakedifficulty",     &getstakedifficulty,     {}               },
+    { "stakeapi",           "getstakedifficulty",     &getstakedifficulty,     {},              true },
     { "stakeapi",           "getstakeversioninfo",    &getstakeversioninfo,    {"count"}        },
     { "stakeapi",           "getstakeversions",       &getstakeversions,       {"hash", "count"}},
 };
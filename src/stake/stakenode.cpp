@@ -60,6 +60,17 @@ HashVector StakeNode::ExpiredByBlock() const
     return expired;
 }
 
+HashVector StakeNode::RevokedByBlock() const
+{
+    HashVector revoked;
+    for (const auto& it : databaseUndoUpdate) {
+        if (it.revoked) {
+            revoked.push_back(it.ticketHash);
+        }
+    }
+    return revoked;
+}
+
 bool StakeNode::ExistsLiveTicket(const uint256& ticket) const
 {
     return liveTickets.has(ticket);
@@ -185,6 +185,10 @@ public:
     // includes the initial expiration of the ticket, not when an expired ticket is
     // revoked. This is unlike MissedByBlock that includes the revocation as well.
     HashVector ExpiredByBlock() const;
+
+    // RevokedByBlock returns the missed or expired tickets that were revoked in
+    // this block.
+    HashVector RevokedByBlock() const;
     
     // ExistsLiveTicket returns whether or not a ticket exists in the live ticket
     // treap for this stake node.
@@ -23,6 +23,45 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+void CCriticalSection::LockProfiled(const char* pszName, const char* pszFile, int nLine)
+{
+    const bool fSample = pprofile->Acquiring();
+    const int64_t nStart = fSample ? GetTimeMicros() : 0;
+    if (!try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
+        PrintLockContention(pszName, pszFile, nLine);
+#endif
+        pprofile->Contended();
+        lock();
+    }
+
+    // only the thread holding the mutex changes its depth and its sample
+    if (++nProfiledDepth == 1 && fSample) {
+        pszSampleFile = pszFile;
+        nSampleLine = nLine;
+        nSampleStart = nStart;
+        nSampleAcquired = GetTimeMicros();
+    }
+}
+
+void CCriticalSection::UnlockProfiled()
+{
+    if (--nProfiledDepth > 0 || !pszSampleFile) {
+        unlock();
+        return;
+    }
+
+    // record once released, not to hold the mutex any longer
+    const char* pszFile = pszSampleFile;
+    const int64_t nWait = nSampleAcquired - nSampleStart;
+    const int64_t nAcquired = nSampleAcquired;
+    const int nLine = nSampleLine;
+    pszSampleFile = nullptr;
+    const int64_t nReleased = GetTimeMicros();
+    unlock();
+    pprofile->Record(pszFile, nLine, nWait, nReleased - nAcquired);
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
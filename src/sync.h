@@ -6,7 +6,9 @@
 #ifndef PAICOIN_SYNC_H
 #define PAICOIN_SYNC_H
 
+#include "lockprofile.h"
 #include "threadsafety.h"
+#include "utiltime.h"
 
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
@@ -91,9 +93,30 @@ void static inline DeleteLock(void* cs) {}
 class CCriticalSection : public AnnotatedMixin<boost::recursive_mutex>
 {
 public:
+    CCriticalSection() : pprofile(nullptr), nProfiledDepth(0), pszSampleFile(nullptr), nSampleLine(0), nSampleStart(0), nSampleAcquired(0) {}
+
+    /** A mutex whose acquisitions through LOCK are profiled, see lockprofile.h */
+    explicit CCriticalSection(CLockProfile& profile) : pprofile(&profile), nProfiledDepth(0), pszSampleFile(nullptr), nSampleLine(0), nSampleStart(0), nSampleAcquired(0) {}
+
     ~CCriticalSection() {
         DeleteLock((void*)this);
     }
+
+    /** Acquire it when profiled, through LOCK or ENTER_CRITICAL_SECTION */
+    void LockProfiled(const char* pszName, const char* pszFile, int nLine);
+    /** Release it when profiled, recording the sample of the outermost acquisition */
+    void UnlockProfiled();
+
+    CLockProfile* const pprofile;
+    // how many times the thread holding it acquired it, when profiled
+    int nProfiledDepth;
+
+private:
+    // the sampled outermost acquisition of the thread holding it, if any
+    const char* pszSampleFile;
+    int nSampleLine;
+    int64_t nSampleStart;
+    int64_t nSampleAcquired;
 };
 
 /** Wrapped boost mutex: supports waiting but not recursive locking */
@@ -113,10 +136,19 @@ class SCOPED_LOCKABLE CMutexLock
 private:
     boost::unique_lock<Mutex> lock;
     bool recursive;
+    // whether the mutex is held and profiled
+    bool fProfiled;
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()), recursive);
+        if (lock.mutex()->pprofile) {
+            Mutex* pmutex = lock.release();
+            pmutex->LockProfiled(pszName, pszFile, nLine);
+            lock = boost::unique_lock<Mutex>(*pmutex, boost::adopt_lock);
+            fProfiled = true;
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -131,13 +163,18 @@ private:
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()), recursive, true);
         lock.try_lock();
-        if (!lock.owns_lock())
+        if (!lock.owns_lock()) {
             LeaveCritical();
+        } else if (lock.mutex()->pprofile) {
+            lock.mutex()->pprofile->Acquiring();
+            ++lock.mutex()->nProfiledDepth;
+            fProfiled = true;
+        }
         return lock.owns_lock();
     }
 
 public:
-    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fRecursive, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : lock(mutexIn, boost::defer_lock), recursive(fRecursive)
+    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fRecursive, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : lock(mutexIn, boost::defer_lock), recursive(fRecursive), fProfiled(false)
     {
         if (fTry)
             TryEnter(pszName, pszFile, nLine);
@@ -145,7 +182,7 @@ public:
             Enter(pszName, pszFile, nLine);
     }
 
-    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fRecursive, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(pmutexIn) : recursive(fRecursive)
+    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fRecursive, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(pmutexIn) : recursive(fRecursive), fProfiled(false)
     {
         if (!pmutexIn) return;
 
@@ -158,8 +195,11 @@ public:
 
     ~CMutexLock() UNLOCK_FUNCTION()
     {
-        if (lock.owns_lock())
+        if (lock.owns_lock()) {
+            if (fProfiled)
+                lock.release()->UnlockProfiled();
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -177,15 +217,45 @@ typedef CMutexLock<CCriticalSection> CCriticalBlock;
 #define LOCK2(cs1, cs2) CCriticalBlock criticalblock1(cs1, #cs1, __FILE__, __LINE__, true), criticalblock2(cs2, #cs2, __FILE__, __LINE__, true)
 #define TRY_LOCK(cs, name) CCriticalBlock name(cs, #cs, __FILE__, __LINE__, true, true)
 
+/** The acquisition and release of ENTER_CRITICAL_SECTION and LEAVE_CRITICAL_SECTION */
+template <typename MutexType>
+inline void LockSection(MutexType& cs, const char*, const char*, int)
+{
+    cs.lock();
+}
+
+template <typename MutexType>
+inline void UnlockSection(MutexType& cs)
+{
+    cs.unlock();
+}
+
+/** As LOCK does, so that a profiled mutex released and acquired again within a LOCK keeps its depth and its samples */
+inline void LockSection(CCriticalSection& cs, const char* pszName, const char* pszFile, int nLine)
+{
+    if (cs.pprofile)
+        cs.LockProfiled(pszName, pszFile, nLine);
+    else
+        cs.lock();
+}
+
+inline void UnlockSection(CCriticalSection& cs)
+{
+    if (cs.pprofile)
+        cs.UnlockProfiled();
+    else
+        cs.unlock();
+}
+
 #define ENTER_CRITICAL_SECTION(cs, recursive)                            \
     {                                                                    \
         EnterCritical(#cs, __FILE__, __LINE__, (void*)(&cs), recursive); \
-        (cs).lock();                                                     \
+        LockSection(cs, #cs, __FILE__, __LINE__);                        \
     }
 
 #define LEAVE_CRITICAL_SECTION(cs) \
     {                              \
-        (cs).unlock();             \
+        UnlockSection(cs);         \
         LeaveCritical();           \
     }
 
@@ -0,0 +1,147 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txdb.h"
+#include "utilstrencodings.h"
+
+#include "test/test_paicoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addrindex_tests, TestingSetup)
+
+static CDiskTxPos MakePos(int nHeight, uint32_t nTxIndex)
+{
+    return CDiskTxPos(CDiskBlockPos(0, nHeight * 1000), 1 + nTxIndex * 100);
+}
+
+BOOST_AUTO_TEST_CASE(addrindex_paging)
+{
+    CBlockTreeDB db(1 << 20, true);
+    const uint160 addrid = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    const uint160 addridPrev = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121313"));
+    const uint160 addridNext = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121315"));
+
+    // entries of the neighbouring addresses must not leak into the pages;
+    // heights above 255 check the big-endian ordering
+    CAddrIndexDelta delta;
+    const std::vector<std::pair<int, uint32_t>> vEntries = {{2, 0}, {2, 3}, {300, 1}, {7, 2}, {256, 0}};
+    for (const auto& entry : vEntries)
+        delta.vTxs.emplace_back(CAddrIndexTxKey(addrid, entry.first, entry.second), MakePos(entry.first, entry.second));
+    delta.vTxs.emplace_back(CAddrIndexTxKey(addridPrev, 5, 0), MakePos(5, 0));
+    delta.vTxs.emplace_back(CAddrIndexTxKey(addridNext, 1, 0), MakePos(1, 0));
+    BOOST_CHECK(db.WriteAddrIndex(delta));
+
+    std::vector<CExtDiskTxPos> vpos;
+    BOOST_CHECK(db.ReadAddrIndex(addrid, vpos));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 5U);
+    const std::vector<std::pair<int, uint32_t>> vOrdered = {{2, 0}, {2, 3}, {7, 2}, {256, 0}, {300, 1}};
+    for (size_t i = 0; i < vpos.size(); ++i) {
+        BOOST_CHECK_EQUAL(vpos[i].nHeight, (unsigned int)vOrdered[i].first);
+        BOOST_CHECK(vpos[i] == CExtDiskTxPos(MakePos(vOrdered[i].first, vOrdered[i].second), vOrdered[i].first));
+    }
+
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndex(addrid, vpos, 1, 2));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 2U);
+    BOOST_CHECK_EQUAL(vpos[0].nHeight, 2U);
+    BOOST_CHECK_EQUAL(vpos[1].nHeight, 7U);
+
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndex(addrid, vpos, 1, 2, true));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 2U);
+    BOOST_CHECK_EQUAL(vpos[0].nHeight, 256U);
+    BOOST_CHECK_EQUAL(vpos[1].nHeight, 7U);
+
+    // the last address in the database is read backwards from its end
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndex(addridNext, vpos, 0, 10, true));
+    BOOST_CHECK_EQUAL(vpos.size(), 1U);
+
+    // a negative skip counts from the end, clamped to the first transaction
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndexPage(addrid, vpos, -2, 10));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 2U);
+    BOOST_CHECK_EQUAL(vpos[0].nHeight, 256U);
+    BOOST_CHECK_EQUAL(vpos[1].nHeight, 300U);
+
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndexPage(addrid, vpos, -4, 2));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 2U);
+    BOOST_CHECK_EQUAL(vpos[0].nHeight, 2U);
+    BOOST_CHECK_EQUAL(vpos[1].nHeight, 7U);
+
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndexPage(addrid, vpos, -100, 3));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 3U);
+    BOOST_CHECK_EQUAL(vpos[0].nHeight, 2U);
+    BOOST_CHECK_EQUAL(vpos[2].nHeight, 7U);
+
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndexPage(addrid, vpos, 3, 10));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 2U);
+    BOOST_CHECK_EQUAL(vpos[0].nHeight, 256U);
+
+    BOOST_CHECK(db.EraseAddrIndex(delta));
+    vpos.clear();
+    BOOST_CHECK(db.ReadAddrIndex(addrid, vpos));
+    BOOST_CHECK(vpos.empty());
+}
+
+BOOST_AUTO_TEST_CASE(addrindex_spent_outputs)
+{
+    CBlockTreeDB db(1 << 20, true);
+    const uint160 addrid = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    const COutPoint outpoint1(InsecureRand256(), 0);
+    const COutPoint outpoint2(InsecureRand256(), 1);
+    const uint256 spendingTxid = InsecureRand256();
+
+    // block 1 creates two outputs
+    CAddrIndexDelta delta1;
+    delta1.vCreated.emplace_back(CAddrIndexOutKey(addrid, outpoint1), CAddrIndexOutValue(10, 1));
+    delta1.vCreated.emplace_back(CAddrIndexOutKey(addrid, outpoint2), CAddrIndexOutValue(20, 1));
+    BOOST_CHECK(db.WriteAddrIndex(delta1));
+
+    // block 2 spends the first one
+    CAddrIndexDelta delta2;
+    CAddrIndexOutValue spent(10, 1);
+    spent.spendingTxid = spendingTxid;
+    spent.nSpendingHeight = 2;
+    delta2.vSpent.emplace_back(CAddrIndexOutKey(addrid, outpoint1), spent);
+    BOOST_CHECK(db.WriteAddrIndex(delta2));
+
+    std::vector<std::pair<COutPoint, CAddrIndexOutValue>> outputs;
+    BOOST_CHECK(db.ReadAddrIndexOutputs(addrid, outputs, true));
+    BOOST_REQUIRE_EQUAL(outputs.size(), 1U);
+    BOOST_CHECK(outputs[0].first == outpoint2);
+    BOOST_CHECK_EQUAL(outputs[0].second.nValue, 20);
+
+    outputs.clear();
+    BOOST_CHECK(db.ReadAddrIndexOutputs(addrid, outputs, false));
+    BOOST_REQUIRE_EQUAL(outputs.size(), 2U);
+    for (const auto& output : outputs) {
+        BOOST_CHECK_EQUAL(output.second.IsSpent(), output.first == outpoint1);
+        if (output.second.IsSpent()) {
+            BOOST_CHECK(output.second.spendingTxid == spendingTxid);
+            BOOST_CHECK_EQUAL(output.second.nSpendingHeight, 2);
+        }
+    }
+
+    // disconnecting block 2 makes the output unspent again
+    BOOST_CHECK(db.EraseAddrIndex(delta2));
+    outputs.clear();
+    BOOST_CHECK(db.ReadAddrIndexOutputs(addrid, outputs, true));
+    BOOST_CHECK_EQUAL(outputs.size(), 2U);
+    outputs.clear();
+    BOOST_CHECK(db.ReadAddrIndexOutputs(addrid, outputs, false));
+    for (const auto& output : outputs)
+        BOOST_CHECK(!output.second.IsSpent());
+
+    BOOST_CHECK(db.EraseAddrIndex(delta1));
+    outputs.clear();
+    BOOST_CHECK(db.ReadAddrIndexOutputs(addrid, outputs, false));
+    BOOST_CHECK(outputs.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+#include "core_memusage.h"
+
+#include "test/test_paicoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CBlock> MakeBlock(uint32_t nNonce, size_t nTxs = 1)
+{
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    pblock->nVersion = 1;
+    pblock->nBits = 0x207fffff;
+    pblock->nNonce = nNonce;
+    for (size_t i = 0; i < nTxs; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = i;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        pblock->vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    return pblock;
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_get_insert)
+{
+    CBlockCache cache(1 << 20);
+
+    const auto pblock = MakeBlock(1);
+    BOOST_CHECK(cache.Get(pblock->GetHash()) == nullptr);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 1U);
+
+    cache.Insert(pblock);
+    BOOST_CHECK(cache.Get(pblock->GetHash()) == pblock);
+    BOOST_CHECK_EQUAL(cache.GetHits(), 1U);
+    BOOST_CHECK_EQUAL(cache.Count(), 1U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() >= RecursiveDynamicUsage(*pblock));
+
+    // inserting the same block again does not duplicate it
+    cache.Insert(pblock);
+    BOOST_CHECK_EQUAL(cache.Count(), 1U);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Count(), 0U);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0U);
+    BOOST_CHECK(cache.Get(pblock->GetHash()) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_budget)
+{
+    const size_t nBlockBytes = sizeof(CBlock) + RecursiveDynamicUsage(*MakeBlock(0, 10));
+
+    CBlockCache cache(1 << 20);
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        blocks.push_back(MakeBlock(i, 10));
+        cache.Insert(blocks.back());
+    }
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= cache.GetMaxSize());
+    BOOST_CHECK(cache.Count() < blocks.size());
+    BOOST_CHECK(cache.Count() * nBlockBytes == cache.DynamicMemoryUsage());
+
+    // the most recently inserted block is always kept
+    BOOST_CHECK(cache.Get(blocks.back()->GetHash()) == blocks.back());
+
+    // shrinking the budget evicts blocks, a zero budget evicts all of them
+    const size_t nCount = cache.Count();
+    cache.SetMaxSize(cache.GetMaxSize() / 2);
+    BOOST_CHECK(cache.Count() < nCount);
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= cache.GetMaxSize());
+    cache.SetMaxSize(0);
+    BOOST_CHECK_EQUAL(cache.Count(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_large_block)
+{
+    // a block larger than the budget divided by the number of shards is kept,
+    // and the older blocks of every shard are evicted to make room for it
+    const auto plarge = MakeBlock(0, 2000);
+    const size_t nLargeBytes = sizeof(CBlock) + RecursiveDynamicUsage(*plarge);
+
+    CBlockCache cache(nLargeBytes * 3 / 2);
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    for (uint32_t i = 1; i <= 100; ++i) {
+        blocks.push_back(MakeBlock(i, 10));
+        cache.Insert(blocks.back());
+    }
+    cache.Insert(plarge);
+    BOOST_CHECK(cache.Get(plarge->GetHash()) == plarge);
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= cache.GetMaxSize());
+
+    // the blocks used last are the ones left beside it
+    BOOST_CHECK(cache.Get(blocks.front()->GetHash()) == nullptr);
+    BOOST_CHECK(cache.Get(blocks.back()->GetHash()) == blocks.back());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,157 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+#include "script/standard.h"
+#include "stake/staketx.h"
+#include "utilstrencodings.h"
+
+#include "test/test_paicoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+static GCSFilter::Element ScriptElement(const CScript& script)
+{
+    return GCSFilter::Element(script.begin(), script.end());
+}
+
+static CScript P2PKH(unsigned char c)
+{
+    return GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, c))));
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_match)
+{
+    GCSFilter::ElementSet included, excluded;
+    for (int i = 0; i < 100; ++i) {
+        GCSFilter::Element element1(32);
+        element1[0] = i;
+        included.insert(std::move(element1));
+
+        GCSFilter::Element element2(32);
+        element2[1] = i;
+        excluded.insert(std::move(element2));
+    }
+
+    const GCSFilter filter(GCSFilter::Params(0, 0, 10, 1 << 10), included);
+    BOOST_CHECK_EQUAL(filter.GetN(), 100U);
+    for (const auto& element : included) {
+        BOOST_CHECK(filter.Match(element));
+
+        GCSFilter::ElementSet elements = excluded;
+        elements.insert(element);
+        BOOST_CHECK(filter.MatchAny(elements));
+    }
+
+    // decoding the filter gives the same filter
+    const GCSFilter filterDecoded(filter.GetParams(), filter.GetEncoded());
+    BOOST_CHECK_EQUAL(filterDecoded.GetN(), 100U);
+    for (const auto& element : included)
+        BOOST_CHECK(filterDecoded.Match(element));
+
+    // malformed encodings are rejected
+    std::vector<unsigned char> vTruncated = filter.GetEncoded();
+    vTruncated.pop_back();
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), vTruncated), std::ios_base::failure);
+    std::vector<unsigned char> vExtended = filter.GetEncoded();
+    vExtended.push_back(0);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), vExtended), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_empty)
+{
+    const GCSFilter filter;
+    BOOST_CHECK_EQUAL(filter.GetN(), 0U);
+    BOOST_CHECK(filter.GetEncoded() == std::vector<unsigned char>(1, 0));
+    BOOST_CHECK(!filter.Match(GCSFilter::Element(1, 0)));
+
+    const GCSFilter filterDecoded(filter.GetParams(), filter.GetEncoded());
+    BOOST_CHECK_EQUAL(filterDecoded.GetN(), 0U);
+}
+
+// The basic filter of the genesis block of the Bitcoin testnet, from the BIP 158
+// test vectors: the encoding does not depend on the chain
+BOOST_AUTO_TEST_CASE(blockfilter_bip158_vector)
+{
+    const uint256 blockHash = uint256S("000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943");
+    const std::vector<unsigned char> vScript = ParseHex("4104678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac");
+
+    const GCSFilter filter(GCSFilter::Params(blockHash.GetUint64(0), blockHash.GetUint64(1), BASIC_FILTER_P, BASIC_FILTER_M), GCSFilter::ElementSet{vScript});
+    BOOST_CHECK_EQUAL(HexStr(filter.GetEncoded()), "019dfca8");
+
+    const BlockFilter blockFilter(BlockFilterType::BASIC, blockHash, filter.GetEncoded());
+    BOOST_CHECK(blockFilter.GetFilter().Match(vScript));
+    BOOST_CHECK_EQUAL(blockFilter.ComputeHeader(uint256()).GetHex(), "21584579b7eb08997773e5aeff3a7f932700042d0ed2a6129012b7d7ae81b750");
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_basic)
+{
+    const CScript scriptIncluded1 = P2PKH(1);
+    const CScript scriptIncluded2 = P2PKH(2);
+    const CScript scriptSpent = P2PKH(3);
+    const CScript scriptNotSpent = P2PKH(4);
+    const CScript scriptReward = P2PKH(5);
+    const CScript scriptOpReturn = CScript() << OP_RETURN << std::vector<unsigned char>(4, 0);
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(100, scriptIncluded1);
+    coinbase.vout.emplace_back(0, scriptOpReturn);
+    coinbase.vout.emplace_back(0, CScript());
+
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(uint256S("01"), 0));
+    tx.vout.emplace_back(100, scriptIncluded2);
+
+    // a ticket, whose contribution names the address the rewards are paid to
+    CMutableTransaction ticket;
+    ticket.vin.emplace_back(COutPoint(uint256S("02"), 0));
+    ticket.vout.emplace_back(0, GetScriptForBuyTicketDecl(BuyTicketData{1}));
+    ticket.vout.emplace_back(90, scriptIncluded2);
+    ticket.vout.emplace_back(0, GetScriptForTicketContrib(TicketContribData(1, CKeyID(uint160(std::vector<unsigned char>(20, 5))), 100)));
+    ticket.vout.emplace_back(10, scriptIncluded1);
+    BOOST_CHECK(ParseTxClass(ticket) == TX_BuyTicket);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(tx));
+    block.vtx.push_back(MakeTransactionRef(ticket));
+
+    CBlockUndo blockUndo;
+    blockUndo.vtxundo.emplace_back();
+    blockUndo.vtxundo.back().vprevout.emplace_back(CTxOut(100, scriptSpent), 1, false, TX_Regular);
+    blockUndo.vtxundo.emplace_back();
+    blockUndo.vtxundo.back().vprevout.emplace_back(CTxOut(100, scriptOpReturn), 1, false, TX_Regular);
+
+    const BlockFilter blockFilter(BlockFilterType::BASIC, block, blockUndo);
+    BOOST_CHECK(blockFilter.GetBlockHash() == block.GetHash());
+
+    const GCSFilter& filter = blockFilter.GetFilter();
+    BOOST_CHECK_EQUAL(filter.GetN(), 4U);
+    BOOST_CHECK(filter.Match(ScriptElement(scriptIncluded1)));
+    BOOST_CHECK(filter.Match(ScriptElement(scriptIncluded2)));
+    BOOST_CHECK(filter.Match(ScriptElement(scriptSpent)));
+    BOOST_CHECK(filter.Match(ScriptElement(scriptReward)));
+    BOOST_CHECK(!filter.Match(ScriptElement(scriptNotSpent)));
+    BOOST_CHECK(!filter.Match(ScriptElement(scriptOpReturn)));
+
+    // the filter is rebuilt from its serialization
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << blockFilter;
+    BlockFilter blockFilterDecoded;
+    stream >> blockFilterDecoded;
+    BOOST_CHECK(blockFilterDecoded.GetFilterType() == BlockFilterType::BASIC);
+    BOOST_CHECK(blockFilterDecoded.GetBlockHash() == blockFilter.GetBlockHash());
+    BOOST_CHECK(blockFilterDecoded.GetEncodedFilter() == blockFilter.GetEncodedFilter());
+    BOOST_CHECK(blockFilterDecoded.ComputeHeader(uint256()) == blockFilter.ComputeHeader(uint256()));
+
+    BlockFilterType filterType;
+    BOOST_CHECK(BlockFilterTypeByName("basic", filterType));
+    BOOST_CHECK(filterType == BlockFilterType::BASIC);
+    BOOST_CHECK(!BlockFilterTypeByName("extended", filterType));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,7 @@
 #include "undo.h"
 #include "utilstrencodings.h"
 #include "test/test_paicoin.h"
+#include "txdb.h"
 #include "validation.h"
 #include "consensus/validation.h"
 
@@ -859,4 +860,73 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_emplace_base)
+{
+    CCoinsView base;
+    CCoinsViewCacheTest cache(&base);
+
+    const COutPoint outpoint(InsecureRand256(), 0);
+    Coin coin;
+    coin.out.nValue = 5;
+    coin.nHeight = 1;
+
+    // a prefetched coin is cached clean, as if it had been fetched
+    cache.EmplaceBaseCoin(outpoint, Coin(coin));
+    BOOST_CHECK(cache.HaveCoinInCache(outpoint));
+    BOOST_CHECK_EQUAL(cache.map().at(outpoint).flags, 0);
+    BOOST_CHECK_EQUAL(cache.AccessCoin(outpoint).out.nValue, 5);
+    cache.SelfTest();
+
+    // a cached entry, e.g. one spent since the prefetch, is never replaced
+    BOOST_CHECK(cache.SpendCoin(outpoint));
+    Coin stale;
+    stale.out.nValue = 7;
+    cache.EmplaceBaseCoin(outpoint, std::move(stale));
+    BOOST_CHECK(!cache.HaveCoin(outpoint));
+    BOOST_CHECK_EQUAL(cache.map().at(outpoint).flags, DIRTY);
+    cache.SelfTest();
+}
+
+BOOST_FIXTURE_TEST_CASE(ccoins_write_behind, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    for (bool fAsync : {false, true}) {
+        CCoinsViewWriteBehind writebehind(&db, fAsync);
+
+        const COutPoint outpoint(InsecureRand256(), 0);
+        const COutPoint spent(InsecureRand256(), 1);
+        const uint256 hashBlock = InsecureRand256();
+        {
+            CCoinsViewCache cache(&writebehind);
+            Coin coin;
+            coin.out.nValue = 5;
+            coin.nHeight = 1;
+            cache.AddCoin(outpoint, Coin(coin), false);
+            cache.AddCoin(spent, std::move(coin), false);
+            cache.SetBestBlock(hashBlock);
+            const size_t nUsage = cache.DynamicMemoryUsage();
+            BOOST_CHECK(cache.Flush());
+            // the flushed entries count against the cache budget until written
+            BOOST_CHECK(writebehind.DynamicMemoryUsage() == nUsage || !writebehind.IsWriting());
+        }
+        {
+            // a block spends a coin while the flush may still be in progress
+            CCoinsViewCache cache(&writebehind);
+            BOOST_CHECK(cache.GetBestBlock() == hashBlock);
+            BOOST_CHECK_EQUAL(cache.AccessCoin(outpoint).out.nValue, 5);
+            BOOST_CHECK(cache.SpendCoin(spent));
+            cache.SetBestBlock(InsecureRand256());
+            BOOST_CHECK(cache.Flush());
+        }
+
+        BOOST_CHECK(writebehind.Sync());
+        BOOST_CHECK(!writebehind.IsWriting());
+        BOOST_CHECK_EQUAL(writebehind.DynamicMemoryUsage(), 0U);
+        BOOST_CHECK(db.GetBestBlock() == writebehind.GetBestBlock());
+        BOOST_CHECK(db.HaveCoin(outpoint));
+        BOOST_CHECK(!db.HaveCoin(spent));
+        BOOST_CHECK(!writebehind.HaveCoin(spent));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -322,5 +322,46 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 }
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles)
+{
+    const size_t nCacheSize = 8 << 20;
+
+    // the default profile keeps the settings used before profiles
+    CDBOptions dbOptions = GetDBProfileOptions(DBProfile::DEFAULT, nCacheSize);
+    BOOST_CHECK_EQUAL(dbOptions.nBlockCacheSize, nCacheSize / 2);
+    BOOST_CHECK_EQUAL(dbOptions.nWriteBufferSize, nCacheSize / 4);
+    BOOST_CHECK_EQUAL(dbOptions.nMaxOpenFiles, 64);
+    BOOST_CHECK_EQUAL(dbOptions.nBloomBits, 10);
+
+    // a profile spends no more than its budget, with two write buffers
+    for (DBProfile profile : {DBProfile::CHAINSTATE, DBProfile::BLOCK_INDEX}) {
+        CDBOptions profileOptions = GetDBProfileOptions(profile, nCacheSize);
+        BOOST_CHECK_LE(profileOptions.nBlockCacheSize + 2 * profileOptions.nWriteBufferSize, nCacheSize);
+    }
+
+    std::string strError;
+    BOOST_CHECK(ParseDBOptions("blockcache=16,writebuffer=4,maxfilesize=32,maxopenfiles=200,bloombits=0", dbOptions, strError));
+    BOOST_CHECK_EQUAL(dbOptions.nBlockCacheSize, 16 << 20);
+    BOOST_CHECK_EQUAL(dbOptions.nWriteBufferSize, 4 << 20);
+    BOOST_CHECK_EQUAL(dbOptions.nMaxFileSize, 32 << 20);
+    BOOST_CHECK_EQUAL(dbOptions.nMaxOpenFiles, 200);
+    BOOST_CHECK_EQUAL(dbOptions.nBloomBits, 0);
+    BOOST_CHECK(!ParseDBOptions("blockcache", dbOptions, strError));
+    BOOST_CHECK(!ParseDBOptions("compression=1", dbOptions, strError));
+    BOOST_CHECK(!ParseDBOptions("writebuffer=9223372036854775807", dbOptions, strError));
+    BOOST_CHECK(!ParseDBOptions("bloombits=4294967296", dbOptions, strError));
+    BOOST_CHECK_EQUAL(dbOptions.nWriteBufferSize, 4 << 20);
+    BOOST_CHECK(!ParseDBOptions("maxopenfiles=0", dbOptions, strError));
+    BOOST_CHECK(!ParseDBOptions("unknown=1", dbOptions, strError));
+
+    // a database opens with the settings and reports its statistics
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CDBWrapper dbw(ph, GetDBProfileOptions(DBProfile::CHAINSTATE, nCacheSize), true, false, false);
+    BOOST_CHECK_EQUAL(dbw.GetDBOptions().nMaxFileSize, GetDBProfileOptions(DBProfile::CHAINSTATE, nCacheSize).nMaxFileSize);
+    BOOST_CHECK(dbw.Write('k', InsecureRand256()));
+    CDBStats stats;
+    BOOST_CHECK(dbw.GetStats(stats));
+    BOOST_CHECK_GE(stats.nMemoryUsage, stats.nBlockCacheUsage);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
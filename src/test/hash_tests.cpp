@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "primitives/block.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_paicoin.h"
 
@@ -147,4 +149,51 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(block_header_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.nTime = 1231006505;
+    header.nBits = 0x1d00ffff;
+    header.hashMerkleRoot = InsecureRand256();
+
+    // a header built in memory is hashed on every call
+    const uint64_t nBefore = CBlockHeader::nHashesComputed;
+    const uint256 hash = header.GetHash();
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::nHashesComputed - nBefore, 2U);
+
+    // a deserialized header is hashed once, and copies carry the hash along
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << header;
+    CBlockHeader received;
+    stream >> received;
+    BOOST_CHECK_EQUAL(CBlockHeader::nHashesComputed - nBefore, 3U);
+    const CBlockHeader copy = received;
+    BOOST_CHECK(received.GetHash() == hash);
+    BOOST_CHECK(copy.GetHash() == hash);
+    BOOST_CHECK_EQUAL(CBlockHeader::nHashesComputed - nBefore, 3U);
+
+    // the nonce setter drops the cached hash
+    received.SetNonce(received.nNonce + 1);
+    const uint256 hashNonce = received.GetHash();
+    BOOST_CHECK(hashNonce != hash);
+    BOOST_CHECK(hashNonce == received.ComputeHash());
+
+    // so does writing a field directly
+    received.CacheHash();
+    received.hashPrevBlock = InsecureRand256();
+    BOOST_CHECK(received.GetHash() != hashNonce);
+    BOOST_CHECK(received.GetHash() == received.ComputeHash());
+
+    received.nVersion |= HARDFORK_VERSION_BIT;
+    received.nFreshStake = 5;
+    received.CacheHash();
+    received.nFreshStake = 6;
+    BOOST_CHECK(received.GetHash() == received.ComputeHash());
+
+    received.SetNull();
+    BOOST_CHECK(received.GetHash() == received.ComputeHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilterindex.h"
+#include "indexer.h"
+#include "txdb.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include "test/test_paicoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+struct IndexerSetup : public TestChain100Setup {
+    ~IndexerSetup()
+    {
+        StopIndexers();
+    }
+};
+
+template <typename Indexer>
+static bool WaitForSync(const std::unique_ptr<Indexer>& indexer)
+{
+    for (int i = 0; i < 3000; ++i) {
+        {
+            LOCK(cs_main);
+            if (indexer && indexer->IsSynced())
+                return true;
+        }
+        MilliSleep(10);
+    }
+    return false;
+}
+
+BOOST_FIXTURE_TEST_SUITE(indexer_tests, IndexerSetup)
+
+BOOST_AUTO_TEST_CASE(indexer_catch_up_and_follow)
+{
+    const CKeyID keyid = coinbaseKey.GetPubKey().GetID();
+
+    // the indexes are enabled after the chain was built
+    std::string strError;
+    BOOST_REQUIRE(SetIndexEnabled("txindex", true, strError));
+    BOOST_REQUIRE(SetIndexEnabled("addrindex", true, strError));
+    BOOST_CHECK(!SetIndexEnabled("nosuchindex", true, strError));
+    BOOST_REQUIRE(WaitForSync(g_txindex));
+    BOOST_REQUIRE(WaitForSync(g_addrindex));
+
+    for (const CTransaction& tx : coinbaseTxns) {
+        CDiskTxPos pos;
+        BOOST_CHECK(pblocktree->ReadTxIndex(tx.GetHash(), pos));
+    }
+    std::vector<CExtDiskTxPos> vpos;
+    BOOST_CHECK(FindTransactionsByDestination(keyid, vpos));
+    BOOST_CHECK_EQUAL(vpos.size(), coinbaseTxns.size());
+
+    // blocks connected afterwards are indexed by the indexer thread
+    const CBlock block = CreateAndProcessBlock({}, CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG);
+    BOOST_REQUIRE(WaitForSync(g_txindex));
+    BOOST_REQUIRE(WaitForSync(g_addrindex));
+    CDiskTxPos pos;
+    BOOST_CHECK(pblocktree->ReadTxIndex(block.vtx[0]->GetHash(), pos));
+    CTransactionRef tx;
+    uint256 hashBlock;
+    BOOST_CHECK(GetTransaction(block.vtx[0]->GetHash(), tx, Params().GetConsensus(), hashBlock, false));
+    BOOST_CHECK(hashBlock == block.GetHash());
+    vpos.clear();
+    BOOST_CHECK(FindTransactionsByDestination(keyid, vpos, -1, 1));
+    BOOST_REQUIRE_EQUAL(vpos.size(), 1U);
+    BOOST_CHECK_EQUAL(vpos[0].nHeight, (unsigned int)chainActive.Height());
+
+    // a disabled index resumes from its best block
+    BOOST_REQUIRE(SetIndexEnabled("txindex", false, strError));
+    BOOST_CHECK(!fTxIndex);
+    const CBlock block2 = CreateAndProcessBlock({}, CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG);
+    BOOST_CHECK(!pblocktree->ReadTxIndex(block2.vtx[0]->GetHash(), pos));
+    BOOST_REQUIRE(SetIndexEnabled("txindex", true, strError));
+    BOOST_CHECK(fTxIndex);
+    BOOST_REQUIRE(WaitForSync(g_txindex));
+    BOOST_CHECK(pblocktree->ReadTxIndex(block2.vtx[0]->GetHash(), pos));
+
+    // disconnected blocks are removed from the address index
+    {
+        CValidationState state;
+        LOCK(cs_main);
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    BOOST_REQUIRE(WaitForSync(g_addrindex));
+    vpos.clear();
+    BOOST_CHECK(FindTransactionsByDestination(keyid, vpos));
+    BOOST_CHECK_EQUAL(vpos.size(), coinbaseTxns.size() + 1);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilterindex_headers)
+{
+    const CScript coinbaseScript = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const GCSFilter::Element coinbaseElement(coinbaseScript.begin(), coinbaseScript.end());
+
+    std::string strError;
+    BOOST_REQUIRE(SetIndexEnabled("blockfilterindex", true, strError));
+    BOOST_REQUIRE(WaitForSync(g_blockfilterindex));
+
+    // every block is indexed, from the genesis block, and each header
+    // commits to the filter and to the header of the parent
+    LOCK(cs_main);
+    uint256 headerPrev;
+    for (const CBlockIndex* pindex = chainActive.Genesis(); pindex; pindex = chainActive.Next(pindex)) {
+        BlockFilter filter;
+        uint256 header;
+        BOOST_REQUIRE(g_blockfilterindex->LookupFilter(pindex, filter));
+        BOOST_REQUIRE(g_blockfilterindex->LookupFilterHeader(pindex, header));
+        BOOST_CHECK(filter.GetBlockHash() == pindex->GetBlockHash());
+        BOOST_CHECK(header == filter.ComputeHeader(headerPrev));
+        headerPrev = header;
+
+        // the coinbase outputs of the test chain pay to the coinbase key
+        if (pindex->nHeight > 0)
+            BOOST_CHECK(filter.GetFilter().Match(coinbaseElement));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
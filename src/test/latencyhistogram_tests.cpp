@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "latencyhistogram.h"
+
+#include "test/test_paicoin.h"
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(latencyhistogram_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+    CLatencyHistogram histogram;
+    const CLatencyHistogram::Summary summary = histogram.GetSummary();
+    BOOST_CHECK_EQUAL(summary.nCount, 0U);
+    BOOST_CHECK_EQUAL(summary.nTotal, 0);
+    BOOST_CHECK_EQUAL(summary.nMax, 0);
+    BOOST_CHECK_EQUAL(summary.nP50, 0);
+    BOOST_CHECK_EQUAL(summary.nP99, 0);
+}
+
+BOOST_AUTO_TEST_CASE(small_values_exact)
+{
+    CLatencyHistogram histogram;
+    for (int64_t n = 1; n <= 10; ++n)
+        histogram.Record(n);
+
+    const CLatencyHistogram::Summary summary = histogram.GetSummary();
+    BOOST_CHECK_EQUAL(summary.nCount, 10U);
+    BOOST_CHECK_EQUAL(summary.nTotal, 55);
+    BOOST_CHECK_EQUAL(summary.nMax, 10);
+    BOOST_CHECK_EQUAL(summary.nP50, 5);
+    BOOST_CHECK_EQUAL(summary.nP90, 9);
+    BOOST_CHECK_EQUAL(summary.nP99, 10);
+}
+
+BOOST_AUTO_TEST_CASE(percentiles_bounded_error)
+{
+    CLatencyHistogram histogram;
+    for (int64_t n = 1; n <= 100000; ++n)
+        histogram.Record(n);
+
+    // a percentile is the upper bound of its bucket, at most 12.5% above it
+    for (double dQuantile : {0.5, 0.9, 0.99}) {
+        const int64_t nExact = dQuantile * 100000;
+        const int64_t nPercentile = histogram.GetPercentile(dQuantile);
+        BOOST_CHECK(nPercentile >= nExact);
+        BOOST_CHECK(nPercentile <= nExact + nExact / 8);
+    }
+    BOOST_CHECK_EQUAL(histogram.GetPercentile(1.0), 100000);
+}
+
+BOOST_AUTO_TEST_CASE(extremes)
+{
+    CLatencyHistogram histogram;
+    histogram.Record(-5);
+    histogram.Record(std::numeric_limits<int64_t>::max());
+
+    const CLatencyHistogram::Summary summary = histogram.GetSummary();
+    BOOST_CHECK_EQUAL(summary.nCount, 2U);
+    BOOST_CHECK_EQUAL(summary.nMax, std::numeric_limits<int64_t>::max());
+    BOOST_CHECK_EQUAL(summary.nP50, 0);
+    BOOST_CHECK_EQUAL(summary.nP99, std::numeric_limits<int64_t>::max());
+}
+
+BOOST_AUTO_TEST_CASE(reset)
+{
+    CLatencyHistogram histogram;
+    histogram.Record(1000);
+    histogram.Reset();
+    BOOST_CHECK_EQUAL(histogram.GetSummary().nCount, 0U);
+    BOOST_CHECK_EQUAL(histogram.GetPercentile(0.5), 0);
+
+    histogram.Record(20);
+    BOOST_CHECK_EQUAL(histogram.GetSummary().nMax, 20);
+    BOOST_CHECK_EQUAL(histogram.GetPercentile(0.5), 20);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
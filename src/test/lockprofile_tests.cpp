@@ -0,0 +1,116 @@
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "lockprofile.h"
+#include "sync.h"
+
+#include "test/test_paicoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(lockprofile_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(counts_and_samples)
+{
+    const unsigned int nPrevSample = GetLockProfileSample();
+    SetLockProfileSample(2);
+
+    CLockProfile profile("test");
+    CCriticalSection cs(profile);
+    for (int i = 0; i < 10; ++i) {
+        LOCK(cs);
+    }
+
+    BOOST_CHECK_EQUAL(profile.GetAcquisitions(), 10U);
+    BOOST_CHECK_EQUAL(profile.GetContentions(), 0U);
+    BOOST_CHECK_EQUAL(profile.GetWaitHistogram().GetSummary().nCount, 5U);
+    BOOST_CHECK_EQUAL(profile.GetHoldHistogram().GetSummary().nCount, 5U);
+
+    const std::vector<CLockProfile::CallSite> vSites = profile.GetTopCallSites(10);
+    BOOST_REQUIRE_EQUAL(vSites.size(), 1U);
+    BOOST_CHECK_EQUAL(vSites[0].strFile, __FILE__);
+    BOOST_CHECK_EQUAL(vSites[0].nSamples, 5U);
+
+    profile.Reset();
+    BOOST_CHECK_EQUAL(profile.GetAcquisitions(), 0U);
+    BOOST_CHECK(profile.GetTopCallSites(10).empty());
+
+    SetLockProfileSample(nPrevSample);
+}
+
+BOOST_AUTO_TEST_CASE(recursive_not_sampled)
+{
+    const unsigned int nPrevSample = GetLockProfileSample();
+    SetLockProfileSample(1);
+
+    CLockProfile profile("test");
+    CCriticalSection cs(profile);
+    {
+        LOCK(cs);
+        {
+            LOCK(cs);
+        }
+        TRY_LOCK(cs, lockTry);
+        BOOST_CHECK(static_cast<bool>(lockTry));
+    }
+
+    // the three acquisitions are counted, only the outermost one is timed
+    BOOST_CHECK_EQUAL(profile.GetAcquisitions(), 3U);
+    BOOST_CHECK_EQUAL(profile.GetHoldHistogram().GetSummary().nCount, 1U);
+    BOOST_CHECK_EQUAL(cs.nProfiledDepth, 0);
+
+    SetLockProfileSample(nPrevSample);
+}
+
+BOOST_AUTO_TEST_CASE(left_and_entered_within_lock)
+{
+    const unsigned int nPrevSample = GetLockProfileSample();
+    SetLockProfileSample(1);
+
+    CLockProfile profile("test");
+    CCriticalSection cs(profile);
+    {
+        LOCK(cs);
+        LEAVE_CRITICAL_SECTION(cs);
+        BOOST_CHECK_EQUAL(cs.nProfiledDepth, 0);
+
+        // released meanwhile, so neither acquisition is charged for the wait
+        {
+            LOCK(cs);
+        }
+        MilliSleep(100);
+
+        ENTER_CRITICAL_SECTION(cs, true);
+        BOOST_CHECK_EQUAL(cs.nProfiledDepth, 1);
+    }
+
+    // the acquisition by LOCK in between is not taken as recursive, and is sampled
+    BOOST_CHECK_EQUAL(profile.GetAcquisitions(), 3U);
+    BOOST_CHECK_EQUAL(profile.GetHoldHistogram().GetSummary().nCount, 3U);
+    BOOST_CHECK_EQUAL(cs.nProfiledDepth, 0);
+    for (const CLockProfile::CallSite& site : profile.GetTopCallSites(10))
+        BOOST_CHECK(site.nMaxHold < 100000);
+
+    SetLockProfileSample(nPrevSample);
+}
+
+BOOST_AUTO_TEST_CASE(top_call_sites)
+{
+    CLockProfile profile("test");
+    profile.Record("a.cpp", 1, 0, 10);
+    profile.Record("b.cpp", 2, 5, 100);
+    profile.Record("a.cpp", 1, 0, 30);
+    profile.Record("c.cpp", 3, 0, 20);
+
+    const std::vector<CLockProfile::CallSite> vSites = profile.GetTopCallSites(2);
+    BOOST_REQUIRE_EQUAL(vSites.size(), 2U);
+    BOOST_CHECK_EQUAL(vSites[0].strFile, "b.cpp");
+    BOOST_CHECK_EQUAL(vSites[0].nWait, 5);
+    BOOST_CHECK_EQUAL(vSites[1].strFile, "a.cpp");
+    BOOST_CHECK_EQUAL(vSites[1].nSamples, 2U);
+    BOOST_CHECK_EQUAL(vSites[1].nHold, 40);
+    BOOST_CHECK_EQUAL(vSites[1].nMaxHold, 30);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
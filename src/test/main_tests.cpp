@@ -10,6 +10,7 @@
 #include "validation.h"
 #include "consensus/tx_verify.h"
 #include "net.h"
+#include "streams.h"
 
 #include "test/test_paicoin.h"
 
@@ -104,4 +105,32 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_AUTO_TEST_CASE(read_raw_block_from_disk)
+{
+    const CChainParams& chainparams = Params();
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive.Tip();
+    }
+    BOOST_REQUIRE(pindex != nullptr);
+
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()));
+
+    // the stored bytes are exactly the network serialization of the block
+    std::vector<unsigned char> rawBlock;
+    BOOST_REQUIRE(ReadRawBlockFromDisk(rawBlock, pindex, chainparams.MessageStart()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    BOOST_CHECK(std::vector<unsigned char>(ss.begin(), ss.end()) == rawBlock);
+
+    // a foreign network magic is rejected
+    CMessageHeader::MessageStartChars otherMessageStart;
+    memcpy(otherMessageStart, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE);
+    otherMessageStart[0] ^= 0xff;
+    BOOST_CHECK(!ReadRawBlockFromDisk(rawBlock, pindex, otherMessageStart));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,10 +8,12 @@
 
 #include "rpc/server.h"
 #include "rpc/client.h"
+#include "rpc/jsonstream.h"
 
 #include "base58.h"
 #include "core_io.h"
 #include "netbase.h"
+#include "validation.h"
 
 #include "test/test_paicoin.h"
 
@@ -20,6 +22,8 @@
 
 #include <univalue.h>
 
+#include <thread>
+
 UniValue CallRPC(std::string args)
 {
     std::vector<std::string> vArgs;
@@ -261,6 +265,119 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_stream_result)
+{
+    UniValue expected{UniValue::VOBJ};
+    UniValue array{UniValue::VARR};
+    for (int i = 0; i < 100; ++i) {
+        UniValue entry{UniValue::VOBJ};
+        entry.push_back(Pair("n", i));
+        entry.push_back(Pair("text", "\"quoted\"\n"));
+        array.push_back(entry);
+    }
+    expected.push_back(Pair("empty", UniValue{UniValue::VARR}));
+    expected.push_back(Pair("entries", array));
+    expected.push_back(Pair("last", NullUniValue));
+
+    auto writeResult = [&](JSONStreamWriter& writer) {
+        writer.BeginObject();
+        writer.Key("empty");
+        writer.BeginArray();
+        writer.EndArray();
+        writer.Key("entries");
+        writer.BeginArray();
+        for (size_t i = 0; i < array.size(); ++i)
+            writer.Value(array[i]);
+        writer.EndArray();
+        writer.KeyValue("last", NullUniValue);
+        writer.EndObject();
+    };
+
+    // written in small chunks, after the prefix
+    std::vector<std::string> vChunks;
+    JSONStreamWriter writer([&vChunks](const std::string& chunk) { vChunks.push_back(chunk); }, "{\"result\":", 100);
+    BOOST_CHECK(!writer.HasOutput());
+    JSONRPCRequest request;
+    request.stream = &writer;
+    BOOST_CHECK(StreamResult(request, writeResult).isNull());
+    BOOST_CHECK(writer.HasOutput());
+    writer.WriteRaw("}");
+    writer.Flush();
+    BOOST_CHECK(vChunks.size() > 10);
+    BOOST_CHECK_EQUAL(boost::algorithm::join(vChunks, ""), "{\"result\":" + expected.write() + "}");
+
+    // returned without a stream
+    request.stream = nullptr;
+    BOOST_CHECK_EQUAL(StreamResult(request, writeResult).write(), expected.write());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_chain_tip_snapshot)
+{
+    std::shared_ptr<const CChainTipSnapshot> snapshot = GetChainTipSnapshot();
+    BOOST_REQUIRE(snapshot != nullptr);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(snapshot->pindex == chainActive.Tip());
+        BOOST_CHECK(snapshot->pstakeNode == chainActive.Tip()->pstakeNode);
+        BOOST_CHECK_EQUAL(snapshot->nNextStakeDifficulty, CalculateNextRequiredStakeDifficulty(chainActive.Tip(), Params().GetConsensus()));
+    }
+
+    // read without cs_main
+    BOOST_CHECK_EQUAL(CallRPC("getblockcount").get_int(), snapshot->nHeight);
+    BOOST_CHECK_EQUAL(CallRPC("getbestblockhash").get_str(), snapshot->hashBlock.GetHex());
+    BOOST_CHECK_EQUAL(find_value(CallRPC("getstakedifficulty"), "next").write(), ValueFromAmount(snapshot->nNextStakeDifficulty).write());
+    BOOST_CHECK_EQUAL(CallRPC("existsliveticket " + uint256().GetHex()).get_bool(), false);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch_concurrent)
+{
+    if (RPCIsInWarmup(nullptr))
+        SetRPCWarmupFinished();
+
+    // concurrent entries, around an entry run alone and entries in error
+    std::string strBatch = "[";
+    for (int i = 0; i < 20; ++i)
+        strBatch += strprintf("{\"method\":\"%s\",\"params\":[],\"id\":%d},", i % 2 ? "getblockcount" : "getbestblockhash", i);
+    strBatch += "{\"method\":\"help\",\"id\":20},{\"method\":\"nosuchmethod\",\"id\":21},[],";
+    for (int i = 23; i < 31; ++i)
+        strBatch += strprintf("{\"method\":\"existsliveticket\",\"params\":[\"%s\"],\"id\":%d},", uint256().GetHex(), i);
+    strBatch.back() = ']';
+    UniValue vReq;
+    BOOST_REQUIRE(vReq.read(strBatch));
+
+    JSONRPCRequest jreq;
+    const std::string strSequential = JSONRPCExecBatch(jreq, vReq);
+
+    std::vector<std::thread> vThreads;
+    auto queueTask = [&vThreads](const std::function<void()>& task) {
+        vThreads.emplace_back(task);
+        return true;
+    };
+    const std::string strConcurrent = JSONRPCExecBatch(jreq, vReq, queueTask);
+    for (std::thread& thread : vThreads)
+        thread.join();
+
+    // in order, with the same replies
+    BOOST_CHECK_EQUAL(vThreads.size(), 2U * (DEFAULT_RPC_BATCH_CONCURRENCY - 1));
+    BOOST_CHECK_EQUAL(strConcurrent, strSequential);
+    UniValue vReplies;
+    BOOST_REQUIRE(vReplies.read(strConcurrent) && vReplies.size() == vReq.size());
+    for (size_t i = 0; i < vReplies.size(); ++i) {
+        const UniValue& reply = vReplies[i];
+        if (i == 22) {
+            // the entry that is not an object has no id
+            BOOST_CHECK(find_value(reply, "id").isNull());
+            continue;
+        }
+        BOOST_CHECK_EQUAL(find_value(reply, "id").get_int(), (int)i);
+        BOOST_CHECK_EQUAL(find_value(reply, "error").isNull(), i != 21);
+    }
+
+    // the tasks that cannot be queued are run by the batch
+    const std::string strNotQueued = JSONRPCExecBatch(jreq, vReq, [](const std::function<void()>&) { return false; });
+    BOOST_CHECK_EQUAL(strNotQueued, strSequential);
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
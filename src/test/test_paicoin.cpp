@@ -75,7 +75,8 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         mempool.setSanityCheck(1.0);
         pblocktree = new CBlockTreeDB(1 << 20, true);
         pcoinsdbview = new CCoinsViewDB(1 << 23, true);
-        pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+        pcoinswritebehind = new CCoinsViewWriteBehind(pcoinsdbview, DEFAULT_DB_ASYNC_FLUSH);
+        pcoinsTip = new CCoinsViewCache(pcoinswritebehind);
         if (!LoadGenesisBlock(chainparams)) {
             throw std::runtime_error("LoadGenesisBlock failed.");
         }
@@ -103,6 +104,8 @@ TestingSetup::~TestingSetup()
         peerLogic.reset();
         UnloadBlockIndex();
         delete pcoinsTip;
+        delete pcoinswritebehind;
+        pcoinswritebehind = nullptr;
         delete pcoinsdbview;
         delete pblocktree;
         fs::remove_all(pathTemp);
@@ -17,6 +17,7 @@
 #include "util.h"
 #include "ui_interface.h"
 #include "init.h"
+#include "memusage.h"
 
 #include <stdint.h>
 
@@ -27,7 +28,11 @@ static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
-static const char DB_ADDR_INDEX = 'a';
+static const char DB_ADDR_INDEX_TX = 'A';
+static const char DB_ADDR_INDEX_OUT = 'o';
+static const char DB_ADDR_INDEX_UNSPENT = 'u';
+static const char DB_ADDR_INDEX_LEGACY = 'a';
+static const char DB_INDEX_BEST_BLOCK = 'I';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -60,7 +65,11 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : CCoinsViewDB(GetDBProfileOptions(DBProfile::CHAINSTATE, nCacheSize), fMemory, fWipe)
+{
+}
+
+CCoinsViewDB::CCoinsViewDB(const CDBOptions& dbOptions, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", dbOptions, fMemory, fWipe, true)
 {
 }
 
@@ -88,6 +97,10 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    return WriteCoins(mapCoins, hashBlock, true);
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -123,7 +136,8 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
         }
         count++;
         CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (fErase)
+            mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -153,7 +167,158 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+CCoinsViewWriteBehind::CCoinsViewWriteBehind(CCoinsViewDB* dbIn, bool fAsyncIn) : db(dbIn), fAsync(fAsyncIn), nWritingUsage(0), fWriting(false), fFailed(false), fStop(false)
+{
+    if (fAsync)
+        thread = boost::thread(&TraceThread<std::function<void()>>, "coinsflush", [this] { Thread(); });
+}
+
+CCoinsViewWriteBehind::~CCoinsViewWriteBehind()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+        condWrite.notify_all();
+    }
+    if (thread.joinable())
+        thread.join();
+}
+
+void CCoinsViewWriteBehind::Thread()
+{
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fWriting && !fStop)
+                condWrite.wait(lock);
+            // a pending write is finished before stopping
+            if (!fWriting)
+                return;
+        }
+
+        int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = db->WriteCoins(mapWriting, hashWriting, false);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        if (!fOk) {
+            LogPrintf("Error writing to the coin database in the background\n");
+            uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+        }
+        LogPrint(BCLog::COINDB, "Background flush of %u coins took %.2fms\n", (unsigned int)mapWriting.size(), (GetTimeMicros() - nStart) * 0.001);
+
+        // free the written entries outside the lock
+        CCoinsMap mapWritten;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            mapWritten.swap(mapWriting);
+            nWritingUsage = 0;
+            fFailed |= !fOk;
+            fWriting = false;
+            condDone.notify_all();
+        }
+    }
+}
+
+bool CCoinsViewWriteBehind::Sync() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (fWriting)
+        condDone.wait(lock);
+    return !fFailed;
+}
+
+bool CCoinsViewWriteBehind::IsWriting() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return fWriting;
+}
+
+size_t CCoinsViewWriteBehind::DynamicMemoryUsage() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nWritingUsage;
+}
+
+bool CCoinsViewWriteBehind::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (fWriting) {
+            CCoinsMap::const_iterator it = mapWriting.find(outpoint);
+            if (it != mapWriting.end()) {
+                if (it->second.coin.IsSpent())
+                    return false;
+                coin = it->second.coin;
+                return true;
+            }
+        }
+    }
+    // entries not being written are up to date in the database
+    return db->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewWriteBehind::HaveCoin(const COutPoint &outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewWriteBehind::GetBestBlock() const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (fWriting)
+            return hashWriting;
+    }
+    return db->GetBestBlock();
+}
+
+std::vector<uint256> CCoinsViewWriteBehind::GetHeadBlocks() const
+{
+    Sync();
+    return db->GetHeadBlocks();
+}
+
+bool CCoinsViewWriteBehind::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    if (!Sync())
+        return false;
+    if (!fAsync)
+        return db->BatchWrite(mapCoins, hashBlock);
+
+    // as counted by CCoinsViewCache, whose memory this map takes over
+    size_t nUsage = memusage::DynamicUsage(mapCoins);
+    for (const auto& entry : mapCoins)
+        nUsage += entry.second.coin.DynamicMemoryUsage();
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    mapWriting.swap(mapCoins);
+    nWritingUsage = nUsage;
+    hashWriting = hashBlock;
+    fWriting = true;
+    condWrite.notify_all();
+    return true;
+}
+
+CCoinsViewCursor *CCoinsViewWriteBehind::Cursor() const
+{
+    Sync();
+    return db->Cursor();
+}
+
+size_t CCoinsViewWriteBehind::EstimateSize() const
+{
+    return db->EstimateSize();
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CBlockTreeDB(GetDBProfileOptions(DBProfile::BLOCK_INDEX, nCacheSize), fMemory, fWipe) {
+}
+
+CBlockTreeDB::CBlockTreeDB(const CDBOptions& dbOptions, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", dbOptions, fMemory, fWipe) {
     if (!Read(DB_SALT, salt)) {
         salt = GetRandHash();
         Write(DB_SALT, salt);
@@ -252,48 +417,146 @@ bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
 
 bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
     CDBBatch batch(*this);
+    WriteTxIndex(batch, vect);
+    return WriteBatch(batch);
+}
+
+void CBlockTreeDB::WriteTxIndex(CDBBatch &batch, const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
     for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(std::make_pair(DB_TXINDEX, it->first), it->second);
-    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddrIndex(uint160 addrid, std::vector<CExtDiskTxPos> &list) {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+bool CBlockTreeDB::ReadAddrIndex(const uint160 &addrid, std::vector<CExtDiskTxPos> &list, size_t nSkip, size_t nCount, bool fReverse) {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    uint64_t lookupid;
-    {
-        CHashWriter ss(SER_GETHASH, 0);
-        ss << salt;
-        ss << addrid;
-        lookupid = UintToArith256(ss.GetHash()).GetLow64();
+    if (!fReverse) {
+        pcursor->Seek(std::make_pair(DB_ADDR_INDEX_TX, CAddrIndexTxKey(addrid, 0, 0)));
+    } else {
+        // seek past the last transaction of the address, then step back
+        pcursor->Seek(std::make_pair(DB_ADDR_INDEX_TX, CAddrIndexTxKey(addrid, -1, std::numeric_limits<uint32_t>::max())));
+        if (pcursor->Valid())
+            pcursor->Prev();
+        else
+            pcursor->SeekToLast();
     }
 
-    pcursor->Seek(std::make_pair(DB_ADDR_INDEX, lookupid));
-
-    while (pcursor->Valid()) {
-        std::pair<std::pair<char, uint64_t>, CExtDiskTxPos> key;
-        if (pcursor->GetKey(key) && key.first.first == DB_ADDR_INDEX && key.first.second == lookupid) {
-            list.push_back(key.second);
-        } else {
+    for (; pcursor->Valid() && list.size() < nCount; fReverse ? pcursor->Prev() : pcursor->Next()) {
+        std::pair<char, CAddrIndexTxKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDR_INDEX_TX || key.second.addrid != addrid)
             break;
+        if (nSkip > 0) {
+            --nSkip;
+            continue;
         }
-        pcursor->Next();
+        CDiskTxPos pos;
+        if (!pcursor->GetValue(pos))
+            return error("%s: failed to read address index entry", __func__);
+        list.push_back(CExtDiskTxPos(pos, key.second.nHeight));
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddrIndexPage(const uint160 &addrid, std::vector<CExtDiskTxPos> &list, int64_t nSkip, size_t nCount) {
+    if (nSkip >= 0)
+        return ReadAddrIndex(addrid, list, nSkip, nCount);
+
+    // the page is read backwards, from its last transaction
+    const uint64_t nFromEnd = static_cast<uint64_t>(-(nSkip + 1)) + 1;
+    const size_t nPage = std::min<uint64_t>(nCount, nFromEnd);
+    std::vector<CExtDiskTxPos> vpos;
+    if (!ReadAddrIndex(addrid, vpos, nFromEnd - nPage, nPage, true))
+        return false;
+    if (vpos.size() < nPage)
+        return ReadAddrIndex(addrid, list, 0, nCount);
+    list.insert(list.end(), vpos.rbegin(), vpos.rend());
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddrIndexOutputs(const uint160 &addrid, std::vector<std::pair<COutPoint, CAddrIndexOutValue> > &outputs, bool fUnspentOnly) {
+    const char chKey = fUnspentOnly ? DB_ADDR_INDEX_UNSPENT : DB_ADDR_INDEX_OUT;
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    for (pcursor->Seek(std::make_pair(chKey, CAddrIndexOutKey(addrid, COutPoint(uint256(), 0)))); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, CAddrIndexOutKey> key;
+        if (!pcursor->GetKey(key) || key.first != chKey || key.second.addrid != addrid)
+            break;
+        CAddrIndexOutValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to read address index entry", __func__);
+        outputs.emplace_back(key.second.outpoint, value);
     }
     return true;
 }
 
-bool CBlockTreeDB::AddAddrIndex(const std::vector<std::pair<uint160, CExtDiskTxPos> > &list) {
-    unsigned char foo[0];
+bool CBlockTreeDB::WriteAddrIndex(const CAddrIndexDelta &delta) {
     CDBBatch batch(*this);
-    for (const auto& it : list ) {
-        CHashWriter ss(SER_GETHASH, 0);
-        ss << salt;
-        ss << it.first;
-        batch.Write(std::make_pair(std::make_pair(DB_ADDR_INDEX, UintToArith256(ss.GetHash()).GetLow64()), it.second), FLATDATA(foo));
+    WriteAddrIndex(batch, delta);
+    return WriteBatch(batch, true);
+}
+
+void CBlockTreeDB::WriteAddrIndex(CDBBatch &batch, const CAddrIndexDelta &delta) {
+    for (const auto& entry : delta.vTxs)
+        batch.Write(std::make_pair(DB_ADDR_INDEX_TX, entry.first), entry.second);
+    // outputs created and spent in the same block end up spent
+    for (const auto& entry : delta.vCreated) {
+        batch.Write(std::make_pair(DB_ADDR_INDEX_OUT, entry.first), entry.second);
+        batch.Write(std::make_pair(DB_ADDR_INDEX_UNSPENT, entry.first), entry.second);
+    }
+    for (const auto& entry : delta.vSpent) {
+        batch.Write(std::make_pair(DB_ADDR_INDEX_OUT, entry.first), entry.second);
+        batch.Erase(std::make_pair(DB_ADDR_INDEX_UNSPENT, entry.first));
+    }
+}
+
+bool CBlockTreeDB::EraseAddrIndex(const CAddrIndexDelta &delta) {
+    CDBBatch batch(*this);
+    EraseAddrIndex(batch, delta);
+    return WriteBatch(batch, true);
+}
+
+void CBlockTreeDB::EraseAddrIndex(CDBBatch &batch, const CAddrIndexDelta &delta) {
+    for (const auto& entry : delta.vTxs)
+        batch.Erase(std::make_pair(DB_ADDR_INDEX_TX, entry.first));
+    // restore the spent outputs before erasing the created ones, which
+    // include those created and spent in the same block
+    for (const auto& entry : delta.vSpent) {
+        const CAddrIndexOutValue unspent(entry.second.nValue, entry.second.nHeight);
+        batch.Write(std::make_pair(DB_ADDR_INDEX_OUT, entry.first), unspent);
+        batch.Write(std::make_pair(DB_ADDR_INDEX_UNSPENT, entry.first), unspent);
+    }
+    for (const auto& entry : delta.vCreated) {
+        batch.Erase(std::make_pair(DB_ADDR_INDEX_OUT, entry.first));
+        batch.Erase(std::make_pair(DB_ADDR_INDEX_UNSPENT, entry.first));
+    }
+}
+
+bool CBlockTreeDB::EraseLegacyAddrIndex() {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    for (pcursor->Seek(DB_ADDR_INDEX_LEGACY); pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        std::pair<std::pair<char, uint64_t>, CExtDiskTxPos> key;
+        if (!pcursor->GetKey(key) || key.first.first != DB_ADDR_INDEX_LEGACY)
+            break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > 16 << 20) {
+            if (!WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
     }
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadIndexBestBlock(const std::string &name, CBlockLocator &locator) {
+    return Read(std::make_pair(DB_INDEX_BEST_BLOCK, name), locator);
+}
+
+void CBlockTreeDB::WriteIndexBestBlock(CDBBatch &batch, const std::string &name, const CBlockLocator &locator) {
+    batch.Write(std::make_pair(DB_INDEX_BEST_BLOCK, name), locator);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -306,6 +569,10 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+void CBlockTreeDB::EraseFlag(CDBBatch &batch, const std::string &name) {
+    batch.Erase(std::make_pair(DB_FLAG, name));
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -13,11 +13,16 @@
 #include "dbwrapper.h"
 #include "chain.h"
 
+#include <limits>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
 class CBlockIndex;
 class CCoinsViewDBCursor;
 class uint256;
@@ -29,6 +34,8 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -dbasyncflush default
+static const bool DEFAULT_DB_ASYNC_FLUSH = true;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -112,6 +119,89 @@ struct CExtDiskTxPos : public CDiskTxPos
     }
 };
 
+/**
+ * Key of a transaction in the address index. The height and the position of
+ * the transaction in its block are serialized big-endian, so that LevelDB keeps
+ * the transactions of an address in chain order and a page of them is read
+ * with a single seek.
+ */
+struct CAddrIndexTxKey
+{
+    uint160 addrid;
+    int nHeight;
+    uint32_t nTxIndex;
+
+    CAddrIndexTxKey() : nHeight(0), nTxIndex(0) {}
+    CAddrIndexTxKey(const uint160& addridIn, int nHeightIn, uint32_t nTxIndexIn) : addrid(addridIn), nHeight(nHeightIn), nTxIndex(nTxIndexIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s << addrid;
+        ser_writedata32be(s, nHeight);
+        ser_writedata32be(s, nTxIndex);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> addrid;
+        nHeight = ser_readdata32be(s);
+        nTxIndex = ser_readdata32be(s);
+    }
+};
+
+/** Key of an output paying to an address in the address index */
+struct CAddrIndexOutKey
+{
+    uint160 addrid;
+    COutPoint outpoint;
+
+    CAddrIndexOutKey() {}
+    CAddrIndexOutKey(const uint160& addridIn, const COutPoint& outpointIn) : addrid(addridIn), outpoint(outpointIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(addrid);
+        READWRITE(outpoint);
+    }
+};
+
+/** An output paying to an address, and the transaction spending it if any */
+struct CAddrIndexOutValue
+{
+    CAmount nValue;
+    int nHeight;
+    uint256 spendingTxid;
+    int nSpendingHeight;
+
+    CAddrIndexOutValue() : nValue(0), nHeight(0), nSpendingHeight(-1) {}
+    CAddrIndexOutValue(CAmount nValueIn, int nHeightIn) : nValue(nValueIn), nHeight(nHeightIn), nSpendingHeight(-1) {}
+
+    bool IsSpent() const { return nSpendingHeight >= 0; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nValue);
+        READWRITE(nHeight);
+        READWRITE(spendingTxid);
+        READWRITE(nSpendingHeight);
+    }
+};
+
+/** The changes connecting a block makes to the address index */
+struct CAddrIndexDelta
+{
+    //! the transactions involving each address
+    std::vector<std::pair<CAddrIndexTxKey, CDiskTxPos>> vTxs;
+    //! the outputs created
+    std::vector<std::pair<CAddrIndexOutKey, CAddrIndexOutValue>> vCreated;
+    //! the outputs spent, along with the spending transaction
+    std::vector<std::pair<CAddrIndexOutKey, CAddrIndexOutValue>> vSpent;
+};
+
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB final : public CCoinsView
 {
@@ -119,6 +209,7 @@ protected:
     CDBWrapper db;
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    explicit CCoinsViewDB(const CDBOptions& dbOptions, bool fMemory = false, bool fWipe = false);
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -127,9 +218,67 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Write the dirty entries of mapCoins, erasing the written entries from the map if fErase
+    bool WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    const CDBWrapper& GetDB() const { return db; }
+};
+
+/**
+ * CCoinsView layered over the coin database that commits flushed coins in the
+ * background.
+ *
+ * BatchWrite() takes over the flushed entries and returns at once, leaving a
+ * thread to write them to the database while the caller carries on: reads are
+ * served from those entries first until they are committed, so the layer always
+ * looks like the database after the write. Only one write is in flight; another
+ * flush waits for it. The entries being written count against the coins cache
+ * budget until they are committed, see DynamicMemoryUsage(). A crash during the write is recovered like one during a
+ * synchronous flush, through the head blocks marker CCoinsViewDB writes first.
+ *
+ * With fAsync false, BatchWrite() writes to the database before returning.
+ */
+class CCoinsViewWriteBehind final : public CCoinsView
+{
+public:
+    CCoinsViewWriteBehind(CCoinsViewDB* dbIn, bool fAsyncIn);
+    ~CCoinsViewWriteBehind();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    std::vector<uint256> GetHeadBlocks() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    CCoinsViewCursor *Cursor() const override;
+    size_t EstimateSize() const override;
+
+    //! Wait for the write in progress. Returns false if a background write failed.
+    bool Sync() const;
+    //! Whether a write is in progress
+    bool IsWriting() const;
+    //! Memory used by the entries being written, 0 when none
+    size_t DynamicMemoryUsage() const;
+
+private:
+    void Thread();
+
+    CCoinsViewDB* db;
+    const bool fAsync;
+
+    mutable boost::mutex mutex;
+    mutable boost::condition_variable condDone;
+    boost::condition_variable condWrite;
+    CCoinsMap mapWriting; // read-only while fWriting
+    size_t nWritingUsage;
+    uint256 hashWriting;
+    bool fWriting;
+    bool fFailed;
+    bool fStop;
+    boost::thread thread;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -159,6 +308,7 @@ class CBlockTreeDB : public CDBWrapper
 {
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    explicit CBlockTreeDB(const CDBOptions& dbOptions, bool fMemory = false, bool fWipe = false);
 
     CBlockTreeDB(const CBlockTreeDB&) = delete;
     CBlockTreeDB& operator=(const CBlockTreeDB&) = delete;
@@ -170,10 +320,28 @@ public:
     bool ReadReindexing(bool &fReindexing);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
-    bool ReadAddrIndex(uint160 addrid, std::vector<CExtDiskTxPos> &list);
-    bool AddAddrIndex(const std::vector<std::pair<uint160, CExtDiskTxPos> > &list);
+    void WriteTxIndex(CDBBatch &batch, const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
+    //! Read the transactions involving an address in chain order, or in reverse with fReverse, leaving out the first nSkip
+    bool ReadAddrIndex(const uint160 &addrid, std::vector<CExtDiskTxPos> &list, size_t nSkip = 0, size_t nCount = std::numeric_limits<size_t>::max(), bool fReverse = false);
+    //! Read up to nCount transactions involving an address in chain order, leaving out the first nSkip,
+    //! or starting -nSkip transactions before the end when negative, from the first one if there are fewer
+    bool ReadAddrIndexPage(const uint160 &addrid, std::vector<CExtDiskTxPos> &list, int64_t nSkip, size_t nCount);
+    //! Read the outputs paying to an address, all or only the unspent ones
+    bool ReadAddrIndexOutputs(const uint160 &addrid, std::vector<std::pair<COutPoint, CAddrIndexOutValue> > &outputs, bool fUnspentOnly);
+    //! Apply the changes of a connected block to the address index
+    bool WriteAddrIndex(const CAddrIndexDelta &delta);
+    void WriteAddrIndex(CDBBatch &batch, const CAddrIndexDelta &delta);
+    //! Revert the changes of a disconnected block from the address index
+    bool EraseAddrIndex(const CAddrIndexDelta &delta);
+    void EraseAddrIndex(CDBBatch &batch, const CAddrIndexDelta &delta);
+    //! Remove the entries of the address index keyed by truncated address hashes
+    bool EraseLegacyAddrIndex();
+    //! The last block included in the index with the given name, written along with its entries
+    bool ReadIndexBestBlock(const std::string &name, CBlockLocator &locator);
+    void WriteIndexBestBlock(CDBBatch &batch, const std::string &name, const CBlockLocator &locator);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    void EraseFlag(CDBBatch &batch, const std::string &name);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 
 private:
@@ -11,11 +11,13 @@
 
 #include "arith_uint256.h"
 #include "base58.h"
+#include "blockcache.h"
 #include <key_io.h>
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "coinsprefetch.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
@@ -23,6 +25,7 @@
 #include "cuckoocache.h"
 #include "fs.h"
 #include "hash.h"
+#include "indexer.h"
 #include "init.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
@@ -73,7 +76,7 @@ using namespace boost::placeholders;
  * Global state
  */
 
-CCriticalSection cs_main;
+CCriticalSection cs_main(GetLockProfile("cs_main"));
 
 BlockMap mapBlockIndex;
 CChain chainActive;
@@ -219,6 +222,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewDB *pcoinsdbview = nullptr;
+CCoinsViewWriteBehind *pcoinswritebehind = nullptr;
 CCoinsViewCache *pcoinsTip = nullptr;
 CBlockTreeDB *pblocktree = nullptr;
 
@@ -1029,27 +1033,37 @@ bool ReadTransaction(CTransactionRef& tx, const CDiskTxPos &pos, uint256 &hashBl
     return true;
 }
 
-bool FindTransactionsByDestination(const CTxDestination &dest, std::set<CExtDiskTxPos> &setpos) {
+static bool GetAddrIndexId(const CTxDestination &dest, uint160 &addrid)
+{
+    if (const CKeyID *pkeyid = boost::get<CKeyID>(&dest))
+        addrid = static_cast<uint160>(*pkeyid);
+    else if (const CScriptID *pscriptid = boost::get<CScriptID>(&dest))
+        addrid = static_cast<uint160>(*pscriptid);
+    else
+        return false;
+    return !addrid.IsNull();
+}
+
+bool FindTransactionsByDestination(const CTxDestination &dest, std::vector<CExtDiskTxPos> &vpos, int64_t nSkip, size_t nCount) {
     uint160 addrid;
-    const CKeyID *pkeyid = boost::get<CKeyID>(&dest);
-    if (pkeyid)
-            addrid = static_cast<uint160>(*pkeyid);
-    if (addrid.IsNull()) {
-        const CScriptID *pscriptid = boost::get<CScriptID>(&dest);
-        if (pscriptid)
-            addrid = static_cast<uint160>(*pscriptid);
-        }
-    if (addrid.IsNull())
+    if (!GetAddrIndexId(dest, addrid))
         return false;
 
     LOCK(cs_main);
     if (!fAddrIndex)
         return false;
-    std::vector<CExtDiskTxPos> vPos;
-    if (!pblocktree->ReadAddrIndex(addrid, vPos))
+    return pblocktree->ReadAddrIndexPage(addrid, vpos, nSkip, nCount);
+}
+
+bool FindOutputsByDestination(const CTxDestination &dest, std::vector<std::pair<COutPoint, CAddrIndexOutValue> > &outputs, bool fUnspentOnly) {
+    uint160 addrid;
+    if (!GetAddrIndexId(dest, addrid))
         return false;
-    setpos.insert(vPos.begin(), vPos.end());
-    return true;
+
+    LOCK(cs_main);
+    if (!fAddrIndex)
+        return false;
+    return pblocktree->ReadAddrIndexOutputs(addrid, outputs, fUnspentOnly);
 }
 
 /** Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock */
@@ -1088,8 +1102,10 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
             return true;
         }
 
-        // transaction not found in index, nothing more can be done
-        return false;
+        // transaction not found in index, nothing more can be done unless
+        // the index is still catching up with the chain
+        if (g_txindex && g_txindex->IsSynced())
+            return false;
     }
 
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
@@ -1098,9 +1114,9 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
     }
 
     if (pindexSlow) {
-        CBlock block;
-        if (ReadBlockFromDisk(block, pindexSlow, consensusParams)) {
-            for (const auto& tx : block.vtx) {
+        std::shared_ptr<const CBlock> pblock;
+        if (ReadBlockFromDiskCached(pblock, pindexSlow, consensusParams)) {
+            for (const auto& tx : pblock->vtx) {
                 if (tx->GetHash() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
@@ -1188,6 +1204,64 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadBlockFromDiskCached(std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    pblock = blockCache.Get(pindex->GetBlockHash());
+    if (pblock)
+        return true;
+
+    std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
+        return false;
+    blockCache.Insert(pblockRead);
+    pblock = pblockRead;
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    block.clear();
+
+    CDiskBlockPos pos = pindex->GetBlockPos();
+    // The index header written by WriteBlockToDisk precedes the block
+    if (pos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("%s: invalid block position %s", __func__, pos.ToString());
+    pos.nPos -= CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars fileMessageStart;
+        unsigned int nSize;
+        filein >> FLATDATA(fileMessageStart) >> nSize;
+
+        if (memcmp(fileMessageStart, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0)
+            return error("%s: block magic mismatch for %s", __func__, pos.ToString());
+        if (nSize > MAX_BLOCK_SERIALIZED_SIZE)
+            return error("%s: block size %u is invalid for %s", __func__, nSize, pos.ToString());
+
+        block.resize(nSize);
+        filein.read((char*)block.data(), nSize);
+    } catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+
+    // Check the header against the index, the same way ReadBlockFromDisk does for the full block
+    try {
+        CBlockHeader header;
+        CDataStream(block, SER_DISK, CLIENT_VERSION) >> header;
+        if (header.GetHash() != pindex->GetBlockHash())
+            return error("%s: GetHash() doesn't match index for %s at %s", __func__,
+                    pindex->ToString(), pindex->GetBlockPos().ToString());
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+    }
+
+    return true;
+}
+
 CAmount GetMinerSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     // Miner subsidy is a portion of total block subsidy
@@ -1716,31 +1790,6 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
-{
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenUndoFile failed", __func__);
-
-    // Read block
-    uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
-    try {
-        verifier << hashBlock;
-        verifier >> blockundo;
-        filein >> hashChecksum;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-    }
-
-    // Verify checksum
-    if (hashChecksum != verifier.GetHash())
-        return error("%s: Checksum mismatch", __func__);
-
-    return true;
-}
 
 // bool StakeReadFromDisk(StakeNode& stakeNode, const CDiskBlockPos& pos, const uint256& hashBlock)
 // {
@@ -1788,6 +1837,32 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // namespace
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
+{
+    // Open history file to read
+    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenUndoFile failed", __func__);
+
+    // Read block
+    uint256 hashChecksum;
+    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    try {
+        verifier << hashBlock;
+        verifier >> blockundo;
+        filein >> hashChecksum;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    // Verify checksum
+    if (hashChecksum != verifier.GetHash())
+        return error("%s: Checksum mismatch", __func__);
+
+    return true;
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -2069,6 +2144,70 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consens
 
 
 
+static CLatencyHistogram validationStageHistograms[static_cast<int>(ValidationStage::COUNT)];
+static std::atomic<int64_t> nValidationStatsResetTime(GetTime());
+
+static void RecordValidationStage(ValidationStage stage, int64_t nMicros)
+{
+    validationStageHistograms[static_cast<int>(stage)].Record(nMicros);
+}
+
+/** Records the time from its creation to its destruction as a latency of the stage */
+class CValidationStageTimer
+{
+public:
+    explicit CValidationStageTimer(ValidationStage stageIn) : stage(stageIn), nStart(GetTimeMicros()) {}
+    ~CValidationStageTimer() { RecordValidationStage(stage, GetTimeMicros() - nStart); }
+
+private:
+    const ValidationStage stage;
+    const int64_t nStart;
+};
+
+const char* GetValidationStageName(ValidationStage stage)
+{
+    switch (stage) {
+    case ValidationStage::LOAD_BLOCK: return "loadblock";
+    case ValidationStage::APPLY_PREFETCH: return "applyprefetch";
+    case ValidationStage::CONNECT_BLOCK: return "connectblock";
+    case ValidationStage::FLUSH_VIEW: return "flushview";
+    case ValidationStage::WRITE_CHAINSTATE: return "writechainstate";
+    case ValidationStage::POST_CONNECT: return "postconnect";
+    case ValidationStage::CONNECT_TIP: return "connecttip";
+    case ValidationStage::SANITY_CHECKS: return "sanitychecks";
+    case ValidationStage::FORK_CHECKS: return "forkchecks";
+    case ValidationStage::CONNECT_TXS: return "connecttxs";
+    case ValidationStage::VERIFY_SCRIPTS: return "verifyscripts";
+    case ValidationStage::INDEX_WRITING: return "indexwriting";
+    case ValidationStage::FETCH_STAKE_NODE: return "fetchstakenode";
+    case ValidationStage::FETCH_TICKET_INFO: return "fetchticketinfo";
+    case ValidationStage::LOTTERY_STATE_CHECK: return "lotterystatecheck";
+    case ValidationStage::MEMPOOL_REMOVE_FOR_BLOCK: return "mempoolremoveforblock";
+    case ValidationStage::MEMPOOL_EXPIRED_TICKETS: return "mempoolexpiredtickets";
+    case ValidationStage::MEMPOOL_EXPIRED_VOTES: return "mempoolexpiredvotes";
+    case ValidationStage::COUNT: break;
+    }
+    assert(!"unknown validation stage");
+    return "";
+}
+
+const CLatencyHistogram& GetValidationStageHistogram(ValidationStage stage)
+{
+    return validationStageHistograms[static_cast<int>(stage)];
+}
+
+void ResetValidationStats()
+{
+    for (CLatencyHistogram& histogram : validationStageHistograms)
+        histogram.Reset();
+    nValidationStatsResetTime = GetTime();
+}
+
+int64_t GetValidationStatsResetTime()
+{
+    return nValidationStatsResetTime;
+}
+
 static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
@@ -2078,47 +2217,20 @@ static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 static int64_t nBlocksTotal = 0;
 
-// Index either: a) every data push >=8 bytes,  b) if no such pushes, the entire script
-void static BuildAddrIndex(const CScript &script, const CExtDiskTxPos &pos, std::vector<std::pair<uint160, CExtDiskTxPos> > &out)
-{
-    CScript::const_iterator pc = script.begin();
-    CScript::const_iterator pend = script.end();
-    std::vector<unsigned char> data;
-    opcodetype opcode;
-    bool fHaveData = false;
-    while (pc < pend) {
-        script.GetOp(pc, opcode, data);
-        if (0 <= opcode && opcode <= OP_PUSHDATA4 && data.size() >= 8) { // data element
-            uint160 addrid;
-            if (data.size() <= 20) {
-                memcpy(&addrid, &data[0], data.size());
-            } else {
-                addrid = Hash160(data);
-            }
-            out.push_back(std::make_pair(addrid, pos));
-            fHaveData = true;
-        }
-    }
-    if (!fHaveData) {
-        uint160 addrid = Hash160(script);
-        out.push_back(std::make_pair(addrid, pos));
-    }
-}
-
 bool AddressExistsInIndex(const std::string& address)
 {
     CTxDestination addrAsDest = DecodeDestination(address);
 
-    std::set<CExtDiskTxPos> addressPositions;
-    auto addressFound = FindTransactionsByDestination(addrAsDest, addressPositions);
+    std::vector<CExtDiskTxPos> addressPositions;
+    auto addressFound = FindTransactionsByDestination(addrAsDest, addressPositions, 0, 1);
     return (addressFound && !addressPositions.empty());
 }
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
-static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false)
+bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2174,6 +2286,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    RecordValidationStage(ValidationStage::SANITY_CHECKS, nTime1 - nTimeStart);
     LogPrint(BCLog::BENCH, "    - Sanity checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime1 - nTimeStart), nTimeCheck * MICRO, nTimeCheck * MILLI / nBlocksTotal);
 
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
@@ -2236,6 +2349,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     unsigned int flags = GetBlockScriptFlags(pindex, chainparams.GetConsensus());
 
     int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
+    RecordValidationStage(ValidationStage::FORK_CHECKS, nTime2 - nTime1);
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
 
     CBlockUndo blockundo;
@@ -2247,14 +2361,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     int nInputs = 0;
     int64_t nSigOpsCost = 0;
 
-    CExtDiskTxPos pos(CDiskTxPos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size())), pindex->nHeight);
-    std::vector<std::pair<uint256, CDiskTxPos> > vPosTxid;
-    std::vector<std::pair<uint160, CExtDiskTxPos> > vPosAddrid;
-    if (fTxIndex)
-        vPosTxid.reserve(block.vtx.size());
-    if (fAddrIndex)
-        vPosAddrid.reserve(4*block.vtx.size());
-
     blockundo.vtxundo.resize(block.vtx.size() - 1);
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
@@ -2331,29 +2437,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             }
             UpdateCoins(tx, view, reorderedIndexes[i] == 0 ? undoDummy : blockundo.vtxundo[reorderedIndexes[i]-1], pindex->nHeight);
         }
-        {
-            // while we may check inputs in a different order we need to keep the same order for saving txIndex and addrIndex
-            const CTransaction &tx = *(block.vtx[i]);
-
-            if (fTxIndex)
-                vPosTxid.push_back(std::make_pair(tx.GetHash(), pos));
-            if (fAddrIndex) {
-                if (!tx.IsCoinBase()) {
-                    for (const CTxIn &txin : tx.vin) {
-                        Coin coin;
-                        view.GetCoin(txin.prevout, coin);
-                        BuildAddrIndex(coin.out.scriptPubKey, pos, vPosAddrid);
-                    }
-                }
-                for (const CTxOut &txout : tx.vout)
-                BuildAddrIndex(txout.scriptPubKey, pos, vPosAddrid);
-            }
-
-            pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
-        }
     }
 
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    RecordValidationStage(ValidationStage::CONNECT_TXS, nTime3 - nTime2);
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
     if (block.GetHash() != chainparams.GetConsensus().hashGenesisBlock) {
@@ -2367,6 +2454,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     if (!control.Wait())
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
+    RecordValidationStage(ValidationStage::VERIFY_SCRIPTS, nTime4 - nTime2);
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
     if (fJustCheck)
@@ -2421,19 +2509,12 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     //     pindex->nStatus |= BLOCK_HAVE_STAKE;
     // }
 
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPosTxid))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (fAddrIndex)
-        if (!pblocktree->AddAddrIndex(vPosAddrid))
-            return AbortNode(state, "Failed to write address index");
-
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
+    RecordValidationStage(ValidationStage::INDEX_WRITING, nTime5 - nTime4);
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
 
     int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
@@ -2488,7 +2569,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             nLastSetChain = nNow;
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // The coins still being written in the background are in memory as
+        // well, and flushing again waits for them to be committed.
+        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() + pcoinswritebehind->DynamicMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
@@ -2540,8 +2623,12 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
+            // It is committed in the background, unless the caller needs
+            // the database up to date.
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            if (mode == FLUSH_STATE_ALWAYS && !pcoinswritebehind->Sync())
+                return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
     }
@@ -2579,9 +2666,39 @@ static void DoWarning(const std::string& strWarning)
     }
 }
 
+static std::shared_ptr<const CChainTipSnapshot> g_chainTipSnapshot;
+
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshot()
+{
+    return std::atomic_load(&g_chainTipSnapshot);
+}
+
+/** Publish the snapshot of the tip of chainActive */
+static void UpdateChainTipSnapshot(const Consensus::Params& consensusParams)
+{
+    AssertLockHeld(cs_main);
+
+    const CBlockIndex* pindex = chainActive.Tip();
+    if (pindex == nullptr) {
+        std::atomic_store(&g_chainTipSnapshot, std::shared_ptr<const CChainTipSnapshot>());
+        return;
+    }
+
+    std::shared_ptr<CChainTipSnapshot> snapshot = std::make_shared<CChainTipSnapshot>();
+    snapshot->pindex = pindex;
+    snapshot->nHeight = pindex->nHeight;
+    snapshot->hashBlock = pindex->GetBlockHash();
+    snapshot->pstakeNode = pindex->pstakeNode;
+    snapshot->nStakeDifficulty = pindex->nStakeDifficulty;
+    snapshot->nNextStakeDifficulty = CalculateNextRequiredStakeDifficulty(pindex, consensusParams);
+    snapshot->nTicketPoolSize = pindex->nTicketPoolSize;
+    std::atomic_store(&g_chainTipSnapshot, std::shared_ptr<const CChainTipSnapshot>(std::move(snapshot)));
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     chainActive.SetTip(pindexNew);
+    UpdateChainTipSnapshot(chainParams.GetConsensus());
 
     // New best block
     mempool.AddTransactionsUpdated(1);
@@ -2648,10 +2765,10 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     CBlockIndex *pindexDelete = chainActive.Tip();
     assert(pindexDelete);
     // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete, chainparams.GetConsensus()))
+    std::shared_ptr<const CBlock> pblock;
+    if (!ReadBlockFromDiskCached(pblock, pindexDelete, chainparams.GetConsensus()))
         return AbortNode(state, "Failed to read block");
+    const CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
     {
@@ -2700,6 +2817,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2783,18 +2901,26 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+        // The prefetch threads may have read the block already
+        pthisBlock = coinsPrefetcher.GetBlock(pindexNew->GetBlockHash());
+        if (!pthisBlock && !ReadBlockFromDiskCached(pthisBlock, pindexNew, chainparams.GetConsensus()))
             return AbortNode(state, "Failed to read block");
-        pthisBlock = pblockNew;
     } else {
         pthisBlock = pblock;
+        blockCache.Insert(pblock);
     }
     const CBlock& blockConnecting = *pthisBlock;
+    int64_t nTime2a = GetTimeMicros(); nTimeReadFromDisk += nTime2a - nTime1;
+    RecordValidationStage(ValidationStage::LOAD_BLOCK, nTime2a - nTime1);
+    LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2a - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    // Warm the coins cache with the inputs the prefetch threads have read meanwhile
+    coinsPrefetcher.Apply(pindexNew->GetBlockHash(), pcoinswritebehind, *pcoinsTip);
     // Apply the block atomically to the chain state.
-    int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
+    int64_t nTime2 = GetTimeMicros(); nTimePrefetch += nTime2 - nTime2a;
+    RecordValidationStage(ValidationStage::APPLY_PREFETCH, nTime2 - nTime2a);
     int64_t nTime3;
-    LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    LogPrint(BCLog::BENCH, "  - Apply prefetched coins: %.2fms [%.2fs]\n", (nTime2 - nTime2a) * MILLI, nTimePrefetch * MICRO);
+    LogPrint(BCLog::BENCH, "    - Prefetch threads: read blocks [%.2fs], fetch coins [%.2fs], waited for [%.2fs]\n", coinsPrefetcher.GetTimeRead() * MICRO, coinsPrefetcher.GetTimeFetch() * MICRO, coinsPrefetcher.GetTimeWait() * MICRO);
     {
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
@@ -2805,24 +2931,32 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
             return error("ConnectTip(): ConnectBlock %s failed", pindexNew->GetBlockHash().ToString());
         }
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
+        RecordValidationStage(ValidationStage::CONNECT_BLOCK, nTime3 - nTime2);
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
         assert(flushed);
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    RecordValidationStage(ValidationStage::FLUSH_VIEW, nTime4 - nTime3);
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_IF_NEEDED))
         return false;
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    RecordValidationStage(ValidationStage::WRITE_CHAINSTATE, nTime5 - nTime4);
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
     // Remove conflicting transactions from the mempool.;
-    mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
+    {
+        CValidationStageTimer timer(ValidationStage::MEMPOOL_REMOVE_FOR_BLOCK);
+        mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
+    }
     disconnectpool.removeForBlock(blockConnecting.vtx);
     // Update chainActive & related variables.
     UpdateTip(pindexNew, chainparams);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    RecordValidationStage(ValidationStage::POST_CONNECT, nTime6 - nTime5);
+    RecordValidationStage(ValidationStage::CONNECT_TIP, nTime6 - nTime1);
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
@@ -2941,7 +3075,13 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
         nHeight = nTargetHeight;
 
         // Connect new blocks.
-        for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
+        for (auto it = vpindexToConnect.rbegin(); it != vpindexToConnect.rend(); ++it) {
+            CBlockIndex *pindexConnect = *it;
+
+            // Have the next blocks read and their coins prefetched while this one connects
+            for (auto itNext = std::next(it); itNext != vpindexToConnect.rend() && itNext - it <= coinsPrefetcher.GetDepth(); ++itNext)
+                coinsPrefetcher.Prefetch(pcoinswritebehind, *itNext);
+
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
@@ -3089,11 +3229,16 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
     }
 
     // remove expired ticket transactions
-    mempool.removeExpiredTickets(height, stakeDifficulty, consensus);
+    {
+        CValidationStageTimer timer(ValidationStage::MEMPOOL_EXPIRED_TICKETS);
+        mempool.removeExpiredTickets(height, stakeDifficulty, consensus);
+    }
 
     // remove expired mempool votes
-    if (fDiscardExpiredMempoolVotes)
+    if (fDiscardExpiredMempoolVotes) {
+        CValidationStageTimer timer(ValidationStage::MEMPOOL_EXPIRED_VOTES);
         mempool.removeExpiredVotes(height, consensus);
+    }
 
     // notify wallet and other interested listeners.
     // This should go after the mempool cleanup above, since the wallet
@@ -3768,6 +3913,8 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationSta
     }
 
     if (pindexPrev->pstakeNode != nullptr) {
+        CValidationStageTimer timer(ValidationStage::LOTTERY_STATE_CHECK);
+
         // Ensure the header commits to the correct pool size based on its position within the chain.
         auto expectedTicketPoolSize = pindexPrev->pstakeNode->PoolSize();
         if (block.nTicketPoolSize != (uint32_t)expectedTicketPoolSize) {
@@ -3820,7 +3967,7 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationSta
 
 // checkAllowedVotes performs validation of all votes in the block to ensure
 // they spend tickets that are actually allowed to vote per the lottery.
-static bool checkAllowedVotes(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
+bool checkAllowedVotes(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
     auto winningHashes = pindexPrev->pstakeNode->Winners();
 
@@ -4225,6 +4372,9 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         LOCK(cs_main);
 
         if (ret) {
+            // Start reading the coins it spends while it is stored and the chain is activated
+            coinsPrefetcher.Prefetch(pcoinswritebehind, pblock);
+
             // Store to disk
             ret = AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock);
         }
@@ -4596,10 +4746,6 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadReindexing(fReindexing);
     if(fReindexing) fReindex = true;
 
-    // Check whether we have a transaction index
-    pblocktree->ReadFlag("txindex", fTxIndex);
-    LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
-
     return true;
 }
 
@@ -4617,14 +4763,12 @@ bool LoadChainTip(const CChainParams& chainparams)
         }
     }
 
-    pblocktree->ReadFlag("addrindex", fAddrIndex);
-    LogPrintf("LoadBlockIndexDB(): address index %s\n", fAddrIndex ? "enabled" : "disabled");
-
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
         return false;
     chainActive.SetTip(it->second);
+    UpdateChainTipSnapshot(chainparams.GetConsensus());
 
     PruneBlockIndexCandidates();
 
@@ -4933,9 +5077,12 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(nullptr);
+    std::atomic_store(&g_chainTipSnapshot, std::shared_ptr<const CChainTipSnapshot>());
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
     mempool.clear();
+    blockCache.Clear();
+    coinsPrefetcher.Clear();
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
@@ -4973,11 +5120,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // needs_init.
 
         LogPrintf("Initializing databases...\n");
-        // Use the provided setting for -txindex in the new database
-        fTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
-        pblocktree->WriteFlag("txindex", fTxIndex);
-        fAddrIndex = gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
-        pblocktree->WriteFlag("addrindex", fAddrIndex);
     }
     return true;
 }
@@ -5520,16 +5662,18 @@ public:
 // This function MUST be called with the chain state lock held (for writes).
 void MaybeFetchTicketInfo(CBlockIndex* pindex, const Consensus::Params& params)
 {
+    CValidationStageTimer timer(ValidationStage::FETCH_TICKET_INFO);
+
     // Load and populate the tickets maturing in this block when they are not
     // already loaded.
     MaybeFetchNewTickets(pindex, params);
 
     // Load and populate the vote and revocation information as needed.
     if (pindex->ticketsVoted.empty() || pindex->ticketsRevoked.empty() || pindex->votes.empty()) {
-        CBlock blockAtIndex;
-        if(ReadBlockFromDisk(blockAtIndex, pindex, params)) {
+        std::shared_ptr<const CBlock> pblockAtIndex;
+        if(ReadBlockFromDiskCached(pblockAtIndex, pindex, params)) {
             pindex->PopulateTicketInfo(
-                FindSpentTicketsInBlock(blockAtIndex)
+                FindSpentTicketsInBlock(*pblockAtIndex)
                 );
         }
     }
@@ -5565,11 +5709,11 @@ void MaybeFetchNewTickets(CBlockIndex* pindex, const Consensus::Params& params)
         //     "(height %d)", b.chainParams.TicketMaturity, node.hash, node.height)
     }
 
-    CBlock matureBlock;
-    if(ReadBlockFromDisk(matureBlock, matureBlockIndex, params)) {
+    std::shared_ptr<const CBlock> pmatureBlock;
+    if(ReadBlockFromDiskCached(pmatureBlock, matureBlockIndex, params)) {
         // Extract any ticket purchases from the block and cache them.
         pindex->newTickets = std::make_shared<HashVector>();
-        for (const auto& tx : StakeSlice(matureBlock.vtx, TX_BuyTicket)){
+        for (const auto& tx : StakeSlice(pmatureBlock->vtx, TX_BuyTicket)){
             pindex->newTickets->push_back(tx->GetHash());
         }
     }
@@ -5584,6 +5728,8 @@ std::shared_ptr<StakeNode> FetchStakeNode(CBlockIndex* pindex, const Consensus::
     if (pindex->pstakeNode != nullptr)
         return pindex->pstakeNode;
 
+    CValidationStageTimer timer(ValidationStage::FETCH_STAKE_NODE);
+
     // Create the requested stake node from the parent stake node if it is
     // already loaded as an optimization.
 
@@ -5671,6 +5817,41 @@ std::shared_ptr<StakeNode> FetchStakeNode(CBlockIndex* pindex, const Consensus::
     return pindex->pstakeNode;
 }
 
+bool GetTicketPoolValue(const CBlockIndex*& pindexTip, CAmount& nPoolValue)
+{
+    // the stake outputs are looked up in batches under the lock, which is
+    // released between them, and the pool of the tip is summed again when the
+    // coins have moved on to another block meanwhile
+    static const size_t TICKETS_PER_LOCK = 1000;
+    for (;;) {
+        std::shared_ptr<StakeNode> pstakeNode;
+        {
+            LOCK(cs_main);
+            pindexTip = chainActive.Tip();
+            pstakeNode = pindexTip->pstakeNode;
+        }
+        const HashVector liveTickets = pstakeNode->LiveTickets();
+
+        nPoolValue = 0;
+        bool fTipMoved = false;
+        for (size_t i = 0; i < liveTickets.size() && !fTipMoved; i += TICKETS_PER_LOCK) {
+            LOCK(cs_main);
+            if (pcoinsTip->GetBestBlock() != pindexTip->GetBlockHash()) {
+                fTipMoved = true;
+                break;
+            }
+            for (size_t j = i; j < std::min(i + TICKETS_PER_LOCK, liveTickets.size()); ++j) {
+                Coin coin;
+                if (!pcoinsTip->GetCoin(COutPoint(liveTickets[j], ticketStakeOutputIndex), coin))
+                    return error("%s: stake output of live ticket %s not found", __func__, liveTickets[j].GetHex());
+                nPoolValue += coin.out.nValue;
+            }
+        }
+        if (!fTipMoved)
+            return true;
+    }
+}
+
 std::set<CBlockIndex*, CompareBlocksByHeight> GetChainTips()
 {
     /*
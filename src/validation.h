@@ -16,6 +16,7 @@
 #include "amount.h"
 #include "coins.h"
 #include "fs.h"
+#include "latencyhistogram.h"
 #include "protocol.h" // For CMessageHeader::MessageStartChars
 #include "policy/feerate.h"
 #include "script/script_error.h"
@@ -34,17 +35,21 @@
 #include <vector>
 
 #include <atomic>
+#include <memory>
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
 class CCoinsViewDB;
+class CCoinsViewWriteBehind;
 class CInv;
 class CConnman;
 class CScriptCheck;
 class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
+class StakeNode;
 struct ChainTxData;
 
 struct PrecomputedTransactionData;
@@ -431,14 +436,36 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Get the block from the process-wide block cache, reading it from disk and caching it on a miss. */
+bool ReadBlockFromDiskCached(std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the block as stored on disk, i.e. already serialized in network format (including witness data),
+ *  without deserializing it. Only the header is decoded, to check it against the index. */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadTransaction(CTransactionRef& tx, const CDiskTxPos &pos, uint256 &hashBlock);
-bool FindTransactionsByDestination(const CTxDestination &dest, std::set<CExtDiskTxPos> &setpos);
+/** Read the undo data of a block; hashBlock is the hash of its parent */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
+/** Find up to nCount transactions involving an address in the address index, in chain order, see CBlockTreeDB::ReadAddrIndexPage */
+bool FindTransactionsByDestination(const CTxDestination &dest, std::vector<CExtDiskTxPos> &vpos, int64_t nSkip = 0, size_t nCount = std::numeric_limits<size_t>::max());
+/** Find the outputs paying to an address in the address index, all or only the unspent ones */
+bool FindOutputsByDestination(const CTxDestination &dest, std::vector<std::pair<COutPoint, CAddrIndexOutValue> > &outputs, bool fUnspentOnly);
 
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckCoinbase = true, int blockHeight = -1);
 
+/** Check that the ticket purchases of a block pay at least its stake difficulty and the PoS limit */
+bool CheckProofOfStake(const CBlock& block, int64_t posLimit);
+
+/** Check that the votes of a block spend winning tickets, and its revocations missed tickets, of the stake node of pindexPrev */
+bool checkAllowedVotes(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
+bool checkAllowedRevocations(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
+
+/** Apply the effects of this block (with given index) on the UTXO set represented by coins.
+ *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
+ *  can fail if those validity checks fail (among other reasons). cs_main must be held. */
+bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false);
+
 /** Check a block is completely valid from start to finish (only works on top of our current best block, with cs_main held) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckCoinbase = true);
 
@@ -486,9 +513,33 @@ bool ResetBlockFailureFlags(CBlockIndex *pindex);
 /** The currently-connected chain of blocks (protected by cs_main). */
 extern CChain chainActive;
 
+/**
+ * An immutable view of the tip of the active chain, replaced as a whole each
+ * time the tip changes, for the readers that must not wait for cs_main. The
+ * block indexes are never freed, and their ancestors do not change, so the
+ * chain up to the tip can be walked with GetAncestor without the lock.
+ */
+struct CChainTipSnapshot
+{
+    const CBlockIndex* pindex;
+    int nHeight;
+    uint256 hashBlock;
+    std::shared_ptr<StakeNode> pstakeNode;
+    // the stake difficulty of the tip, and the one required of the next block
+    int64_t nStakeDifficulty;
+    int64_t nNextStakeDifficulty;
+    uint32_t nTicketPoolSize;
+};
+
+/** The snapshot of the tip of the active chain, or null before the chain is loaded */
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshot();
+
 /** Global variable that points to the coins database (protected by cs_main) */
 extern CCoinsViewDB *pcoinsdbview;
 
+/** Global variable that points to the view committing flushes to pcoinsdbview in the background (protected by cs_main) */
+extern CCoinsViewWriteBehind *pcoinswritebehind;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
@@ -532,6 +583,11 @@ void MaybeFetchTicketInfo(CBlockIndex* pindex, const Consensus::Params& params);
 void MaybeFetchNewTickets(CBlockIndex* pindex, const Consensus::Params& params);
 std::shared_ptr<StakeNode> FetchStakeNode(CBlockIndex* pindex, const Consensus::Params& params);
 
+/** Sum the stake outputs of the live tickets of the tip into nPoolValue, with
+ *  cs_main released between batches of them, and set pindexTip to the tip the
+ *  sum was taken at; false if the stake output of a live ticket is missing. */
+bool GetTicketPoolValue(const CBlockIndex*& pindexTip, CAmount& nPoolValue);
+
 /** Check existence of address in the address index */
 bool AddressExistsInIndex(const std::string& address);
 
@@ -553,4 +609,36 @@ struct CompareBlocksByHeight
 /** Get the set of chain tips */
 std::set<CBlockIndex*, CompareBlocksByHeight> GetChainTips();
 
+/** The stages of the block connection whose latencies are recorded */
+enum class ValidationStage {
+    LOAD_BLOCK,                 //!< ConnectTip: read the block
+    APPLY_PREFETCH,             //!< ConnectTip: apply the prefetched coins
+    CONNECT_BLOCK,              //!< ConnectTip: ConnectBlock as a whole
+    FLUSH_VIEW,                 //!< ConnectTip: flush the block view to pcoinsTip
+    WRITE_CHAINSTATE,           //!< ConnectTip: FlushStateToDisk
+    POST_CONNECT,               //!< ConnectTip: mempool removals and UpdateTip
+    CONNECT_TIP,                //!< ConnectTip as a whole
+    SANITY_CHECKS,              //!< ConnectBlock: CheckBlock and the assumed valid block
+    FORK_CHECKS,                //!< ConnectBlock: soft fork states and disapproved tip
+    CONNECT_TXS,                //!< ConnectBlock: transaction inputs, stake included
+    VERIFY_SCRIPTS,             //!< ConnectBlock: connection and script verification
+    INDEX_WRITING,              //!< ConnectBlock: undo data and stake node
+    FETCH_STAKE_NODE,           //!< FetchStakeNode, when the node is not loaded
+    FETCH_TICKET_INFO,          //!< MaybeFetchTicketInfo
+    LOTTERY_STATE_CHECK,        //!< ContextualCheckBlockHeader: ticket pool size and lottery state
+    MEMPOOL_REMOVE_FOR_BLOCK,   //!< removal of the mined and conflicting mempool transactions
+    MEMPOOL_EXPIRED_TICKETS,    //!< removal of the expired mempool tickets
+    MEMPOOL_EXPIRED_VOTES,      //!< removal of the expired mempool votes
+    COUNT
+};
+
+/** The name of a stage, as reported by getvalidationstats */
+const char* GetValidationStageName(ValidationStage stage);
+/** The latencies recorded for a stage since the last reset */
+const CLatencyHistogram& GetValidationStageHistogram(ValidationStage stage);
+/** Clear the latencies of all the stages */
+void ResetValidationStats();
+/** The time of the last reset, or of the start of the node */
+int64_t GetValidationStatsResetTime();
+
 #endif // PAICOIN_VALIDATION_H
@@ -48,6 +48,10 @@ void CAutoRevoker::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     if (tip->nHeight < Params().GetConsensus().nStakeValidationHeight - 1)
         return;
 
+    // nothing to revoke, the wallet keeps track of its missed tickets
+    if (pwallet->GetTicketLedger().GetMissedTickets().empty())
+        return;
+
     // unlock wallet
     bool shouldRelock = pwallet->IsLocked();
     if (shouldRelock && ! pwallet->Unlock(config.passphrase)) {
@@ -6,8 +6,10 @@
 
 
 #include "autovoter.h"
-#include "wallet/wallet.h"
+#include "net.h"
+#include "utiltime.h"
 #include "validation.h"
+#include "wallet/wallet.h"
 #include <numeric>
 
 CAutoVoter::CAutoVoter(CWallet* wallet) :
@@ -27,9 +29,11 @@ void CAutoVoter::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_p
     if (IsInitialBlockDownload())
         return;
 
+    const int64_t nTimeReceived = GetTimeMicros();
+
     LogPrintf("CAutoVoter: received NewPoWValidBlock, height=%d, pstake=%p\n", pindex->nHeight, pindex->pstakeNode);
 
-    DoVote(pindex);
+    DoVote(pindex, nTimeReceived);
 }
 
 void CAutoVoter::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *, bool fInitialDownload)
@@ -38,10 +42,56 @@ void CAutoVoter::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex
     if (fInitialDownload)
         return;
 
-    DoVote(pindexNew);
+    DoVote(pindexNew, GetTimeMicros());
+
+    // get the votes of the next blocks ready, out of the block relay path
+    // of NewPoWValidBlock; the ticket ledger is read under cs_main
+    if (pwallet == nullptr || !configured.load() || !config.autoVote)
+        return;
+
+    LOCK2(cs_main, pwallet->cs_wallet);
+    UpdateVoteTemplates();
 }
 
-void CAutoVoter::DoVote(const CBlockIndex *pindexNew)
+const CVoteTemplate* CAutoVoter::GetVoteTemplate(const uint256& ticketHash)
+{
+    AssertLockHeld(pwallet->cs_wallet);
+
+    auto it = mapVoteTemplates.find(ticketHash);
+    if (it != mapVoteTemplates.end())
+        return it->second.get();
+
+    if (pwallet->GetTicketLedger().GetTicket(ticketHash) == nullptr || !pwallet->IsMyTicket(ticketHash))
+        return nullptr;
+
+    std::unique_ptr<CVoteTemplate> voteTemplate(new CVoteTemplate());
+    CWalletError we;
+    if (!pwallet->CreateVoteTemplate(ticketHash, *voteTemplate, we)) {
+        LogPrintf("CAutoVoter: Failed to prepare the vote of %s: (%d) %s\n", ticketHash.GetHex(), we.code, we.message.c_str());
+        return nullptr;
+    }
+
+    return mapVoteTemplates.emplace(ticketHash, std::move(voteTemplate)).first->second.get();
+}
+
+void CAutoVoter::UpdateVoteTemplates()
+{
+    AssertLockHeld(pwallet->cs_wallet);
+
+    // only the live tickets can be selected to vote in the next blocks
+    const std::set<uint256>& setLive = pwallet->GetTicketLedger().GetLiveTickets();
+    for (auto it = mapVoteTemplates.begin(); it != mapVoteTemplates.end(); ) {
+        if (setLive.count(it->first) == 0)
+            it = mapVoteTemplates.erase(it);
+        else
+            ++it;
+    }
+
+    for (const uint256& ticketHash : setLive)
+        GetVoteTemplate(ticketHash);
+}
+
+void CAutoVoter::DoVote(const CBlockIndex *pindexNew, int64_t nTimeReceived)
 {
     if (pwallet == nullptr)
         return;
@@ -64,8 +114,12 @@ void CAutoVoter::DoVote(const CBlockIndex *pindexNew)
     if (tipHeight < Params().GetConsensus().nStakeValidationHeight - 1)
         return;
 
-    std::vector<std::string> voteHashes;
-    std::string voteHash;
+    // the votes are built from the templates, not through Vote() and its checks
+    if (!config.extendedVoteBits.isValid()) {
+        LogPrintf("CAutoVoter: Failed to vote: Invalid extended vote bits\n");
+        return;
+    }
+
     CWalletError we;
 
     // unlock wallet
@@ -75,7 +129,10 @@ void CAutoVoter::DoVote(const CBlockIndex *pindexNew)
         return;
     }
 
-    // send all possible votes for the block if this is at least at the
+    std::vector<CTransactionToSign> vVotes;
+    std::set<std::pair<uint256, uint256>> setVoted;
+
+    // build all possible votes for the block if this is at least at the
     // same height with the chain tip.
     auto voteForBlock = [&] (const CBlockIndex* block) {
         if (block->nStatus & BLOCK_FAILED_MASK)
@@ -97,19 +154,25 @@ void CAutoVoter::DoVote(const CBlockIndex *pindexNew)
             return;
 
         // verify each winning ticket in the previous block and
-        // if it belongs to the wallet, cast a vote according to the
+        // if it belongs to the wallet, prepare a vote according to the
         // current settings
 
         for (const uint256& ticketHash : block->pstakeNode->Winners()) {
-            if (!pwallet->IsMyTicket(ticketHash))
+            const CVoteTemplate* voteTemplate = GetVoteTemplate(ticketHash);
+            if (voteTemplate == nullptr)
+                continue;
+
+            if (!setVoted.emplace(ticketHash, blockHash).second)
                 continue;
 
-            std::tie(voteHash, we) = pwallet->Vote(ticketHash, blockHash, blockHeight, config.voteBits, config.extendedVoteBits);
+            if (pwallet->IsTicketVotedInMempool(ticketHash) || pwallet->IsTicketRevokedInMempool(ticketHash))
+                continue;
 
-            if (we.code == CWalletError::SUCCESSFUL && !voteHash.empty())
-                voteHashes.push_back(voteHash);
+            CTransactionToSign vote;
+            if (pwallet->CreateVote(*voteTemplate, blockHash, blockHeight, config.voteBits, config.extendedVoteBits, vote, we))
+                vVotes.push_back(std::move(vote));
             else
-                LogPrintf("CAutoVoter: Failed to vote: (%d) %s - (%s)\n", we.code, we.message.c_str(), voteHash.c_str());
+                LogPrintf("CAutoVoter: Failed to vote: (%d) %s - (%s)\n", we.code, we.message.c_str(), ticketHash.GetHex());
         }
     };
 
@@ -121,16 +184,44 @@ void CAutoVoter::DoVote(const CBlockIndex *pindexNew)
     else
         voteForBlock(pindexNew);
 
+    const int64_t nTimeBuilt = GetTimeMicros();
+
+    // the votes are signed at once, then sent together
+    pwallet->SignTransactions(vVotes);
+
     if (shouldRelock) pwallet->Lock();
 
-    if (voteHashes.size() > 0) {
+    const int64_t nTimeSigned = GetTimeMicros();
+
+    std::vector<CWalletTx> vwtx;
+    for (CTransactionToSign& vote : vVotes) {
+        if (!vote.fSigned) {
+            LogPrintf("CAutoVoter: Failed to vote: (%d) %s - (%s)\n", CWalletError::TRANSACTION_ERROR, "Could not sign the vote transaction", vote.mtx.vin[voteStakeInputIndex].prevout.hash.GetHex());
+            continue;
+        }
+
+        vwtx.emplace_back();
+        CWalletTx& wtx = vwtx.back();
+        wtx.fTimeReceivedIsTxTime = true;
+        wtx.BindWallet(pwallet);
+        wtx.SetTx(MakeTransactionRef(std::move(vote.mtx)));
+    }
+
+    if (vwtx.size() > 0) {
+        pwallet->CommitTransactions(vwtx, g_connman.get());
+
+        const int64_t nTimeSent = GetTimeMicros();
+
         std::string hashes;
-        for (const auto& h : voteHashes) {
+        for (const auto& wtx : vwtx) {
             if (hashes.length() > 0)
                 hashes += ", ";
-            hashes += h;
+            hashes += wtx.GetHash().GetHex();
         }
         LogPrintf("CAutoVoter: Voted: %s\n", hashes.c_str());
+        LogPrintf("CAutoVoter: %u votes sent %.2fms after the block was received (build %.2fms, sign %.2fms, send %.2fms)\n",
+                  vwtx.size(), (nTimeSent - nTimeReceived) * 0.001, (nTimeBuilt - nTimeReceived) * 0.001,
+                  (nTimeSigned - nTimeBuilt) * 0.001, (nTimeSent - nTimeSigned) * 0.001);
     }
 }
 
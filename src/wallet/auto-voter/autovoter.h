@@ -8,16 +8,24 @@
 #define PAICOIN_WALLET_AUTOVOTER_AUTOVOTER_H
 
 #include "autovoterconfig.h"
+#include "uint256.h"
 #include "validationinterface.h"
 
 #include <atomic>
+#include <map>
+#include <memory>
 
 class CWallet;
+struct CVoteTemplate;
 
 // The Automatic Voter (AV)
 // This is responsible with monitoring the blockchain advance
 // and automatically generate and publish a vote transaction
 // for a ticket that has been selected as winner.
+// The part of the votes that does not depend on the voted block is built
+// ahead of time for the live tickets of the wallet, so a winning ticket only
+// needs the block dependent outputs and its signature before the vote is sent.
+// The templates are updated when the tip changes, after the block is relayed.
 
 class CAutoVoter : public CValidationInterface {
 public:
@@ -40,7 +48,14 @@ private:
     CWallet* pwallet;
 
     std::atomic<bool> configured;
-    void DoVote(const CBlockIndex *pindexNew);
+
+    // the vote templates of the live tickets of the wallet, protected by cs_wallet
+    std::map<uint256, std::unique_ptr<CVoteTemplate>> mapVoteTemplates;
+
+    const CVoteTemplate* GetVoteTemplate(const uint256& ticketHash);
+    void UpdateVoteTemplates();
+
+    void DoVote(const CBlockIndex *pindexNew, int64_t nTimeReceived);
 };
 
 #endif // PAICOIN_WALLET_AUTOVOTER_AUTOVOTER_H
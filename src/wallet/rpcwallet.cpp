@@ -864,15 +864,15 @@ UniValue gettickets(const JSONRPCRequest& request)
     LOCK2(cs_main, pwallet->cs_wallet);
 
     const auto& txOrdered = pwallet->wtxOrdered;
+    const auto& ledger = pwallet->GetTicketLedger();
 
     auto tx_arr = UniValue{UniValue::VARR};
     for (const auto& it : txOrdered) {
         const auto* const pwtx = it.second.first;
 
         if (pwtx != nullptr) {
-            std::string reason;
-            const CTransaction& current_tx = *(pwtx->tx);
-            if (ParseTxClass(current_tx) != TX_BuyTicket)
+            const auto* const ticket = ledger.GetTicket(pwtx->GetHash());
+            if (ticket == nullptr)
                 continue;
 
             const auto& confirmations = pwtx->GetDepthInMainChain();
@@ -882,31 +882,20 @@ UniValue gettickets(const JSONRPCRequest& request)
             if (pwtx->isAbandoned())
                 continue;
 
-            const auto& bImmature = confirmations <= Params().GetConsensus().nTicketMaturity;
+            const auto& bImmature = ticket->status == TicketStatus::IMMATURE;
             if (!bIncludeImmature && bImmature)
                 continue;
 
             if (fVerbose) {
-                CBlockIndex* pblockindex = chainActive.Tip();
                 auto info = UniValue{UniValue::VOBJ};
                 info.pushKV("txid", pwtx->GetHash().GetHex());
                 info.pushKV("confirmations", confirmations);
                 StakingToUniv(*pwtx->tx, info, false);
 
-                if (bImmature) {
-                    info.pushKV("status", "immature");
-                } else if (pblockindex->pstakeNode->ExistsRevokedTicket(pwtx->GetHash())) {
-                    info.pushKV("status", "revoked");
-                } else if (pblockindex->pstakeNode->ExistsMissedTicket(pwtx->GetHash())) {
-                    if (pblockindex->pstakeNode->ExistsExpiredTicket(pwtx->GetHash())) {
-                        info.pushKV("status", "expired");
-                    } else {
-                        info.pushKV("status", "missed_vote");
-                    }
-                } else if (pblockindex->pstakeNode->ExistsLiveTicket(pwtx->GetHash())) {
-                    info.pushKV("status", "live");
+                if (ticket->status == TicketStatus::MISSED) {
+                    info.pushKV("status", "missed_vote");
                 } else {
-                    info.pushKV("status", "voted");
+                    info.pushKV("status", TicketStatusName(ticket->status));
                 }
 
                 auto spendingWtx = CWalletTx{};
@@ -2898,15 +2887,6 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
     return obj;
 }
 
-static bool ticketMatured(const Consensus::Params& params, int txHeight, int currentHeight) {
-    return txHeight >= 0 && currentHeight-txHeight > params.nTicketMaturity;
-}
-
-static bool ticketExpired(const Consensus::Params& params, int txHeight, int currentHeight) {
-    return txHeight >= 0 && currentHeight-txHeight > static_cast<int>(params.nTicketMaturity + params.nTicketExpiry);
-}
-
-
 UniValue getstakeinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || !request.params.empty())
@@ -2962,103 +2942,30 @@ UniValue getstakeinfo(const JSONRPCRequest& request)
         allmempooltix = unminedTicketCount;
     }
 
-    auto immature = uint64_t{0};
-    auto unspent = uint64_t{0};
-    auto unspentExpired = uint64_t{0};
-    auto voted = uint64_t{0};
-    auto revoked = uint64_t{0};
-    auto totalSubsidy = CAmount{};
-
-    std::vector<uint256> liveOrExpireOrMissed;
-    const auto& txOrdered = pwallet->wtxOrdered;
-    for (const auto& it : txOrdered) {
-        const auto* const pwtx = it.second.first;
-
-        if (pwtx == nullptr)
-            continue;
-
-        const auto& tx = *pwtx->tx;
-
-        if (pwtx->IsCoinBase() || !CheckFinalTx(tx))
-            continue;
-        
-        if (ETxClass::TX_BuyTicket == ParseTxClass(tx)) {
-            const auto& depth = pwtx->GetDepthInMainChain();
-            if (depth == 0) {
-                // in mempool
-                continue;
-            }
-            else if (depth >= 1) {
-                // in main chain
-                const auto& txHeight = chainActive.Height() - depth; 
-                if (!ticketMatured(Params().GetConsensus(), txHeight, chainActive.Height())) {
-                    ++immature;
-                }
-
-                auto spendingWtx = CWalletTx{};
-                if (pwallet->IsSpent(tx.GetHash(), ticketStakeOutputIndex, &spendingWtx)) {
+    // As the wallet is unaware of when a ticket was selected or missed, the
+    // status of the tickets follows the ticket pools of the consensus server
+    const auto& ledger = pwallet->GetTicketLedger();
 
-                    const auto& spendingTx = *spendingWtx.tx;
-                    const auto& txClass = ParseTxClass(spendingTx);
-                    switch(txClass){
-                        case ETxClass::TX_Vote:
-                            {
-                                ++voted;
-                                // Add the subsidy.
-                                //
-                                // This is not the actual subsidy that was earned by this
-                                // wallet, but rather the stakebase sum.  If a user uses a
-                                // stakepool for voting, this value will include the total
-                                // subsidy earned by both the user and the pool together.
-                                // Similarly, for stakepool wallets, this includes the
-                                // customer's subsidy rather than being just the subsidy
-                                // earned by fees.
-                                totalSubsidy += tx.vout[ticketStakeOutputIndex].nValue;
-                            }
-                            break;
-                        case ETxClass::TX_RevokeTicket:
-                            {
-                                ++revoked;
-                                // The ticket was revoked because it was either expired or
-                                // missed.  Append it to the liveOrExpiredOrMissed slice to
-                                // check this later.
-                                liveOrExpireOrMissed.push_back(tx.GetHash());
-                            }
-                            break;
-                        default:
-                            assert(!"Ticket spent by transaction that is neither vote nor revocation!");
-                    }
-                    continue;
-                }
+    const uint64_t immature = ledger.GetTotals(TicketStatus::IMMATURE).nCount;
+    const uint64_t live = ledger.GetTotals(TicketStatus::LIVE).nCount;
+    const uint64_t voted = ledger.GetTotals(TicketStatus::VOTED).nCount;
+    const uint64_t revoked = ledger.GetTotals(TicketStatus::REVOKED).nCount;
 
-                // Ticket is matured but unspent.  Possible states are that the
-                // ticket is live, expired, or missed.
-                ++unspent;
-                if (ticketExpired(Params().GetConsensus(), txHeight, chainActive.Height())) {
-                    ++unspentExpired;
-                }
-                liveOrExpireOrMissed.push_back(tx.GetHash());
-            }
-        }
-    }
+    // Missed and expired tickets are in the missed ticket pool until they are
+    // revoked, and expired tickets are still counted once revoked.
+    const uint64_t unspentExpired = ledger.GetTotals(TicketStatus::EXPIRED).nCount;
+    const uint64_t missed = ledger.GetTotals(TicketStatus::MISSED).nCount + unspentExpired;
+    const uint64_t expired = ledger.GetTotals(TicketStatus::REVOKED, true).nCount;
+    const uint64_t unspent = immature + live + missed;
 
-    auto live = uint64_t{0};
-    auto expired = uint64_t{0};
-    auto missed = uint64_t{0};
+    // This is not the actual subsidy that was earned by this wallet, but
+    // rather the stakebase sum.  If a user uses a stakepool for voting, this
+    // value will include the total subsidy earned by both the user and the
+    // pool together.  Similarly, for stakepool wallets, this includes the
+    // customer's subsidy rather than being just the subsidy earned by fees.
+    const auto& totalSubsidy = ledger.GetTotals(TicketStatus::VOTED).nStakeValue;
 
-    // As the wallet is unaware of when a ticket was selected or missed, this
-    // info must be queried from the consensus server.  If the ticket is neither
-    // live nor expired, it is assumed missed.
     CBlockIndex* pblockindex = chainActive.Tip();
-    for ( const auto& ticket : liveOrExpireOrMissed) {
-        if (pblockindex->pstakeNode->ExistsLiveTicket(ticket))
-            ++live;
-        else if (pblockindex->pstakeNode->ExistsMissedTicket(ticket))
-            ++missed;
-        else if (pblockindex->pstakeNode->ExistsExpiredTicket(ticket))
-            ++expired;
-    }
-
     const auto& poolSize = pblockindex->pstakeNode->PoolSize();
     const auto& proportionLive = (poolSize > 0) ? (double)live / (double)poolSize
                                                 : 0.0;
@@ -1139,6 +1139,10 @@ BOOST_FIXTURE_TEST_CASE(revoke_all, WalletStakeTestingSetup)
     while (chainActive.Tip()->pstakeNode->MissedTickets().size() < 5)
         ExtendChain(1, true, false, false, true);
 
+    // the wallet keeps track of its missed tickets
+    const HashVector missedTickets = chainActive.Tip()->pstakeNode->MissedTickets();
+    BOOST_CHECK(wallet->GetTicketLedger().GetMissedTickets() == std::set<uint256>(missedTickets.begin(), missedTickets.end()));
+
     std::tie(revocationHashes, we) = wallet->RevokeAll();
     BOOST_CHECK(we.code == CWalletError::SUCCESSFUL);
     BOOST_CHECK(revocationHashes.size() != 0);
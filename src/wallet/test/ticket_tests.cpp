@@ -1717,4 +1717,88 @@ BOOST_FIXTURE_TEST_CASE(ticket_buyer_rpc, WalletStakeTestingSetup)
     vpwallets.erase(std::remove(vpwallets.begin(), vpwallets.end(), wallet.get()), vpwallets.end());
 }
 
+// builds the ledger of the tickets of the wallet from the ticket pools at a block
+static void BuildTicketLedger(const CWallet& wallet, const CBlockIndex* pindex, CTicketLedger& ledger)
+{
+    ledger.Clear();
+    for (const auto& item : wallet.mapWallet) {
+        const CTransaction& tx = *item.second.tx;
+        if (ParseTxClass(tx) != TX_BuyTicket)
+            continue;
+
+        ledger.AddTicket(item.first, tx.vout[ticketStakeOutputIndex].nValue, 0);
+        const auto it = mapBlockIndex.find(item.second.hashBlock);
+        if (it != mapBlockIndex.end() && pindex->GetAncestor(it->second->nHeight) == it->second) {
+            ledger.SetMined(item.first, it->second->nHeight);
+            ledger.SetStatusFromNode(item.first, *pindex->pstakeNode);
+        }
+    }
+}
+
+static void CheckSameTicketLedger(const CTicketLedger& ledger, const CTicketLedger& expected)
+{
+    BOOST_CHECK_EQUAL(ledger.GetTickets().size(), expected.GetTickets().size());
+    BOOST_CHECK(ledger.GetUnminedTickets() == expected.GetUnminedTickets());
+    for (const auto& item : expected.GetTickets()) {
+        const CTicketLedgerEntry* entry = ledger.GetTicket(item.first);
+        BOOST_REQUIRE(entry != nullptr);
+        BOOST_CHECK(entry->status == item.second.status);
+        BOOST_CHECK_EQUAL(entry->fExpired, item.second.fExpired);
+        BOOST_CHECK_EQUAL(entry->nHeight, item.second.nHeight);
+    }
+    for (int status = 0; status < TICKET_STATUS_COUNT; ++status)
+        for (bool fExpired : {false, true}) {
+            BOOST_CHECK_EQUAL(ledger.GetTotals(static_cast<TicketStatus>(status), fExpired).nCount, expected.GetTotals(static_cast<TicketStatus>(status), fExpired).nCount);
+            BOOST_CHECK_EQUAL(ledger.GetTotals(static_cast<TicketStatus>(status), fExpired).nStakeValue, expected.GetTotals(static_cast<TicketStatus>(status), fExpired).nStakeValue);
+        }
+}
+
+// test that the ticket ledger follows the chain with the undo data of the stake nodes
+BOOST_AUTO_TEST_CASE(ticket_ledger)
+{
+    LOCK2(cs_main, wallet->cs_wallet);
+
+    // only the majority of the winners vote, so some tickets are missed
+    const int nForkHeight = consensus.nStakeValidationHeight - 4;
+    ExtendChain(consensus.nStakeValidationHeight + 8 - chainActive.Tip()->nHeight, true, false, false, true);
+    const CBlockIndex* pindexFork = chainActive[nForkHeight];
+
+    CTicketLedger ledger;
+    BuildTicketLedger(*wallet, pindexFork, ledger);
+    const CTicketLedger ledgerFork = ledger;
+
+    CTicketLedger expected;
+    for (const CBlockIndex* pindex = chainActive.Next(pindexFork); pindex != nullptr; pindex = chainActive.Next(pindex)) {
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, consensus));
+        for (const CTransactionRef& tx : block.vtx)
+            if (ParseTxClass(*tx) == TX_BuyTicket)
+                ledger.SetMined(tx->GetHash(), pindex->nHeight);
+        ledger.ConnectNode(*pindex->pstakeNode);
+
+        BuildTicketLedger(*wallet, pindex, expected);
+        CheckSameTicketLedger(ledger, expected);
+    }
+
+    BOOST_CHECK(ledger.GetTotals(TicketStatus::LIVE).nCount > 0);
+    BOOST_CHECK(ledger.GetTotals(TicketStatus::VOTED).nCount > 0);
+    BOOST_CHECK(ledger.GetTotals(TicketStatus::MISSED).nCount > 0);
+
+    // the ledger of the wallet is built from the tip
+    CheckSameTicketLedger(wallet->GetTicketLedger(), expected);
+
+    for (const CBlockIndex* pindex = chainActive.Tip(); pindex != pindexFork; pindex = pindex->pprev) {
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, consensus));
+        for (const CTransactionRef& tx : block.vtx)
+            if (ParseTxClass(*tx) == TX_BuyTicket)
+                ledger.SetUnmined(tx->GetHash());
+        ledger.DisconnectNode(*pindex->pstakeNode);
+
+        BuildTicketLedger(*wallet, pindex->pprev, expected);
+        CheckSameTicketLedger(ledger, expected);
+    }
+    CheckSameTicketLedger(ledger, ledgerFork);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -665,6 +665,52 @@ BOOST_FIXTURE_TEST_CASE(vote_transaction, WalletStakeTestingSetup)
             BOOST_CHECK(std::find_if(votesInLastBlock.begin(), votesInLastBlock.end(), [&voteHash](const CTransactionRef tx) { return tx->GetHash() == voteHash; }) != votesInLastBlock.end());
     }
 
+    // Votes from templates, signed and sent together
+
+    {
+        BOOST_CHECK(chainActive.Tip()->pstakeNode->Winners().size() > 0);
+
+        std::vector<CTransactionToSign> vVotes;
+
+        for (const uint256& ticketHash : chainActive.Tip()->pstakeNode->Winners()) {
+            // the winners are still live until they vote
+            BOOST_CHECK(wallet->GetTicketLedger().GetLiveTickets().count(ticketHash) > 0);
+
+            CVoteTemplate voteTemplate;
+            BOOST_CHECK(wallet->CreateVoteTemplate(ticketHash, voteTemplate, we));
+            BOOST_CHECK(voteTemplate.ticketHash == ticketHash);
+
+            CTransactionToSign vote;
+            BOOST_CHECK(!wallet->CreateVote(voteTemplate, chainActive.Tip()->GetBlockHash(), chainActive.Tip()->nHeight - 1, VoteBits::rttAccepted, extendedVoteBitsData.empty, vote, we));
+            BOOST_CHECK_EQUAL(we.code, CWalletError::INVALID_PARAMETER);
+
+            BOOST_CHECK(wallet->CreateVote(voteTemplate, chainActive.Tip()->GetBlockHash(), chainActive.Tip()->nHeight, VoteBits::rttAccepted, extendedVoteBitsData.empty, vote, we));
+            vVotes.push_back(std::move(vote));
+        }
+
+        wallet->SignTransactions(vVotes);
+
+        std::vector<CWalletTx> vwtx;
+        for (CTransactionToSign& vote : vVotes) {
+            BOOST_CHECK(vote.fSigned);
+            vwtx.emplace_back();
+            vwtx.back().BindWallet(wallet.get());
+            vwtx.back().SetTx(MakeTransactionRef(std::move(vote.mtx)));
+        }
+        BOOST_CHECK(wallet->CommitTransactions(vwtx, nullptr));
+
+        for (const CWalletTx& wtx : vwtx) {
+            const CWalletTx* ticket = wallet->GetWalletTx(wtx.tx->vin[voteStakeInputIndex].prevout.hash);
+            BOOST_CHECK(ticket != nullptr);
+            CheckVote(*wtx.tx, *ticket->tx);
+        }
+
+        ExtendChain(1);
+
+        for (const CWalletTx& wtx : vwtx)
+            BOOST_CHECK(std::find_if(votesInLastBlock.begin(), votesInLastBlock.end(), [&wtx](const CTransactionRef tx) { return tx->GetHash() == wtx.GetHash(); }) != votesInLastBlock.end());
+    }
+
     // Encrypted wallet
 
     {
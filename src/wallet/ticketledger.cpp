@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2017-2020 Project PAI Foundation
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+
+
+#include "wallet/ticketledger.h"
+#include "chainparams.h"
+#include "stake/stakenode.h"
+
+#include <assert.h>
+
+std::string TicketStatusName(TicketStatus status)
+{
+    switch (status) {
+    case TicketStatus::IMMATURE: return "immature";
+    case TicketStatus::LIVE: return "live";
+    case TicketStatus::VOTED: return "voted";
+    case TicketStatus::MISSED: return "missed";
+    case TicketStatus::EXPIRED: return "expired";
+    case TicketStatus::REVOKED: return "revoked";
+    }
+    assert(false);
+    return "";
+}
+
+void CTicketLedger::Clear()
+{
+    mapTickets.clear();
+    setUnmined.clear();
+    setLive.clear();
+    setMissed.clear();
+    for (auto& statusTotals : totals)
+        statusTotals[0] = statusTotals[1] = Totals();
+    fStale = false;
+}
+
+void CTicketLedger::AddTicket(const uint256& ticketHash, CAmount nStakeValue, CAmount nStakeCredit)
+{
+    auto ret = mapTickets.emplace(ticketHash, CTicketLedgerEntry());
+    if (!ret.second)
+        return;
+
+    CTicketLedgerEntry& entry = ret.first->second;
+    entry.nStakeValue = nStakeValue;
+    entry.nStakeCredit = nStakeCredit;
+    setUnmined.insert(ticketHash);
+}
+
+void CTicketLedger::SetMined(const uint256& ticketHash, int nHeight)
+{
+    auto it = mapTickets.find(ticketHash);
+    if (it == mapTickets.end())
+        return;
+
+    CTicketLedgerEntry& entry = it->second;
+    if (entry.IsMined())
+        AddToTotals(entry, -1);
+    setLive.erase(ticketHash);
+    setMissed.erase(ticketHash);
+    entry.nHeight = nHeight;
+    entry.status = TicketStatus::IMMATURE;
+    entry.fExpired = false;
+    AddToTotals(entry, 1);
+    setUnmined.erase(ticketHash);
+}
+
+void CTicketLedger::SetUnmined(const uint256& ticketHash)
+{
+    auto it = mapTickets.find(ticketHash);
+    if (it == mapTickets.end() || !it->second.IsMined())
+        return;
+
+    CTicketLedgerEntry& entry = it->second;
+    AddToTotals(entry, -1);
+    setLive.erase(ticketHash);
+    setMissed.erase(ticketHash);
+    entry.nHeight = -1;
+    entry.status = TicketStatus::IMMATURE;
+    entry.fExpired = false;
+    setUnmined.insert(ticketHash);
+}
+
+void CTicketLedger::SetStatusFromNode(const uint256& ticketHash, const StakeNode& tipNode)
+{
+    auto it = mapTickets.find(ticketHash);
+    if (it == mapTickets.end() || !it->second.IsMined())
+        return;
+
+    // the tickets of a block enter the live ticket pool nTicketMaturity blocks later
+    CTicketLedgerEntry& entry = it->second;
+    const bool fExpired = tipNode.ExistsExpiredTicket(ticketHash);
+    if (static_cast<int>(tipNode.Height()) - entry.nHeight < Params().GetConsensus().nTicketMaturity)
+        SetStatus(it->first, entry, TicketStatus::IMMATURE, false);
+    else if (tipNode.ExistsLiveTicket(ticketHash))
+        SetStatus(it->first, entry, TicketStatus::LIVE, false);
+    else if (tipNode.ExistsRevokedTicket(ticketHash))
+        SetStatus(it->first, entry, TicketStatus::REVOKED, fExpired);
+    else if (tipNode.ExistsMissedTicket(ticketHash))
+        SetStatus(it->first, entry, fExpired ? TicketStatus::EXPIRED : TicketStatus::MISSED, fExpired);
+    else
+        SetStatus(it->first, entry, TicketStatus::VOTED, false);
+}
+
+void CTicketLedger::ConnectNode(const StakeNode& node)
+{
+    for (const UndoTicketData& undo : node.UndoData()) {
+        auto it = mapTickets.find(undo.ticketHash);
+        if (it == mapTickets.end() || !it->second.IsMined())
+            continue;
+
+        CTicketLedgerEntry& entry = it->second;
+        if (undo.spent)
+            SetStatus(it->first, entry, TicketStatus::VOTED, false);
+        else if (undo.missed && undo.revoked)
+            SetStatus(it->first, entry, TicketStatus::REVOKED, entry.fExpired || undo.expired);
+        else if (undo.missed)
+            SetStatus(it->first, entry, undo.expired ? TicketStatus::EXPIRED : TicketStatus::MISSED, undo.expired);
+        else
+            SetStatus(it->first, entry, TicketStatus::LIVE, false);
+    }
+}
+
+void CTicketLedger::DisconnectNode(const StakeNode& node)
+{
+    // in the reverse order, should a ticket change state twice in the block
+    const UndoTicketDataVector vUndo = node.UndoData();
+    for (auto itUndo = vUndo.rbegin(); itUndo != vUndo.rend(); ++itUndo) {
+        const UndoTicketData& undo = *itUndo;
+        auto it = mapTickets.find(undo.ticketHash);
+        if (it == mapTickets.end() || !it->second.IsMined())
+            continue;
+
+        // the state of the ticket before the block
+        CTicketLedgerEntry& entry = it->second;
+        if (undo.missed && undo.revoked)
+            SetStatus(it->first, entry, entry.fExpired ? TicketStatus::EXPIRED : TicketStatus::MISSED, entry.fExpired);
+        else if (undo.spent || undo.missed)
+            SetStatus(it->first, entry, TicketStatus::LIVE, false);
+        else
+            SetStatus(it->first, entry, TicketStatus::IMMATURE, false);
+    }
+}
+
+const CTicketLedgerEntry* CTicketLedger::GetTicket(const uint256& ticketHash) const
+{
+    auto it = mapTickets.find(ticketHash);
+    if (it == mapTickets.end())
+        return nullptr;
+    return &it->second;
+}
+
+const CTicketLedger::Totals& CTicketLedger::GetTotals(TicketStatus status, bool fExpired) const
+{
+    return totals[static_cast<int>(status)][fExpired ? 1 : 0];
+}
+
+CTicketLedger::Totals CTicketLedger::GetTotals(TicketStatus status) const
+{
+    const Totals& notExpired = GetTotals(status, false);
+    const Totals& expired = GetTotals(status, true);
+
+    Totals sum;
+    sum.nCount = notExpired.nCount + expired.nCount;
+    sum.nStakeValue = notExpired.nStakeValue + expired.nStakeValue;
+    sum.nStakeCredit = notExpired.nStakeCredit + expired.nStakeCredit;
+    return sum;
+}
+
+void CTicketLedger::AddToTotals(const CTicketLedgerEntry& entry, int nSign)
+{
+    Totals& statusTotals = totals[static_cast<int>(entry.status)][entry.fExpired ? 1 : 0];
+    statusTotals.nCount += nSign;
+    statusTotals.nStakeValue += nSign * entry.nStakeValue;
+    statusTotals.nStakeCredit += nSign * entry.nStakeCredit;
+}
+
+void CTicketLedger::SetStatus(const uint256& ticketHash, CTicketLedgerEntry& entry, TicketStatus status, bool fExpired)
+{
+    AddToTotals(entry, -1);
+    entry.status = status;
+    entry.fExpired = fExpired;
+    AddToTotals(entry, 1);
+
+    if (status == TicketStatus::LIVE)
+        setLive.insert(ticketHash);
+    else
+        setLive.erase(ticketHash);
+
+    if (status == TicketStatus::MISSED || status == TicketStatus::EXPIRED)
+        setMissed.insert(ticketHash);
+    else
+        setMissed.erase(ticketHash);
+}
@@ -0,0 +1,129 @@
+/* * Copyright (c) 2017-2020 Project PAI Foundation
+ * Distributed under the MIT software license, see the accompanying
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.
+ */
+
+
+#ifndef PAICOIN_WALLET_TICKETLEDGER_H
+#define PAICOIN_WALLET_TICKETLEDGER_H
+
+#include "amount.h"
+#include "uint256.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+class StakeNode;
+
+// The state of a ticket of the wallet, as seen from the tip of the chain.
+// A ticket is immature from its purchase until it enters the live ticket
+// pool, then it is either voted, or missed (selected but not voted) or
+// expired (never selected), and a missed or expired ticket is finally revoked.
+enum class TicketStatus {
+    IMMATURE,
+    LIVE,
+    VOTED,
+    MISSED,
+    EXPIRED,
+    REVOKED,
+};
+
+static const int TICKET_STATUS_COUNT = static_cast<int>(TicketStatus::REVOKED) + 1;
+
+std::string TicketStatusName(TicketStatus status);
+
+class CTicketLedgerEntry
+{
+public:
+    TicketStatus status;
+    // whether the ticket expired, which is kept once it is revoked
+    bool fExpired;
+    // the height of the block of the ticket, -1 while it is not in the main chain
+    int nHeight;
+    // the value of the stake output, and the part of it the wallet can spend
+    CAmount nStakeValue;
+    CAmount nStakeCredit;
+
+    CTicketLedgerEntry()
+        : status(TicketStatus::IMMATURE), fExpired(false), nHeight(-1), nStakeValue(0), nStakeCredit(0)
+    {}
+
+    bool IsMined() const { return nHeight >= 0; }
+};
+
+// The ticket ledger keeps the status of every ticket of the wallet, so the
+// staked balances and the stake statistics do not need a scan of the whole
+// wallet and a lookup of each ticket in the ticket pools of the tip.
+// Once built from the tip, it follows the chain with the undo data of the
+// stake node of each connected or disconnected block, which lists the tickets
+// that changed state in that block. The mined tickets are also summed up per
+// status, so the totals are available at once.
+// The ledger is protected by the cs_wallet lock of its wallet.
+class CTicketLedger
+{
+public:
+    struct Totals {
+        unsigned int nCount;
+        CAmount nStakeValue;
+        CAmount nStakeCredit;
+
+        Totals() : nCount(0), nStakeValue(0), nStakeCredit(0) {}
+    };
+
+    CTicketLedger() : fStale(true) {}
+
+    // Whether the ledger must be rebuilt from the tip before its next use,
+    // for instance after the wallet was loaded or rescanned
+    bool IsStale() const { return fStale; }
+    void SetStale() { fStale = true; }
+
+    // Forget all the tickets, and clear the stale flag for a rebuild
+    void Clear();
+
+    // Add a ticket of the wallet, not yet in the main chain, if it is not there yet
+    void AddTicket(const uint256& ticketHash, CAmount nStakeValue, CAmount nStakeCredit);
+
+    // Record that a ticket was included in a block of the main chain at the
+    // given height, where it is immature, or that it left the main chain
+    void SetMined(const uint256& ticketHash, int nHeight);
+    void SetUnmined(const uint256& ticketHash);
+
+    // Set the status of a mined ticket from the ticket pools of the tip
+    void SetStatusFromNode(const uint256& ticketHash, const StakeNode& tipNode);
+
+    // Apply the changes of state in the block of a stake node, which was
+    // connected to the tip or disconnected from it
+    void ConnectNode(const StakeNode& node);
+    void DisconnectNode(const StakeNode& node);
+
+    const CTicketLedgerEntry* GetTicket(const uint256& ticketHash) const;
+    const std::map<uint256, CTicketLedgerEntry>& GetTickets() const { return mapTickets; }
+
+    // The tickets not in the main chain, which are counted in no total
+    const std::set<uint256>& GetUnminedTickets() const { return setUnmined; }
+
+    // The live tickets, which can be selected to vote
+    const std::set<uint256>& GetLiveTickets() const { return setLive; }
+
+    // The missed and expired tickets not yet revoked, which can be revoked
+    const std::set<uint256>& GetMissedTickets() const { return setMissed; }
+
+    // The totals of the mined tickets of a status, whether expired or not
+    const Totals& GetTotals(TicketStatus status, bool fExpired) const;
+    // The totals of the mined tickets of a status
+    Totals GetTotals(TicketStatus status) const;
+
+private:
+    std::map<uint256, CTicketLedgerEntry> mapTickets;
+    std::set<uint256> setUnmined;
+    std::set<uint256> setLive;
+    std::set<uint256> setMissed;
+    Totals totals[TICKET_STATUS_COUNT][2];
+    bool fStale;
+
+    void AddToTotals(const CTicketLedgerEntry& entry, int nSign);
+    void SetStatus(const uint256& ticketHash, CTicketLedgerEntry& entry, TicketStatus status, bool fExpired);
+};
+
+#endif // PAICOIN_WALLET_TICKETLEDGER_H
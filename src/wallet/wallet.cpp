@@ -1074,61 +1074,91 @@ bool CWallet::MarkReplaced(const uint256& originalHash, const uint256& newHash)
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
-    LOCK(cs_wallet);
-
     CWalletDB walletdb(*dbw, "r+", fFlushOnClose);
+    return AddToWallet(wtxIn, walletdb);
+}
+
+bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB& walletdb)
+{
+    LOCK(cs_wallet);
 
     uint256 hash = wtxIn.GetHash();
 
-    // Inserts only if not already there, returns tx inserted or tx found
-    std::pair<std::map<uint256, CWalletTx>::iterator, bool> ret = mapWallet.insert(std::make_pair(hash, wtxIn));
-    CWalletTx& wtx = (*ret.first).second;
-    wtx.BindWallet(this);
-    bool fInsertedNew = ret.second;
-    if (fInsertedNew)
+    std::map<uint256, CWalletTx>::iterator it = mapWallet.find(hash);
+    if (it == mapWallet.end())
     {
-        wtx.nTimeReceived = GetAdjustedTime();
-        wtx.nOrderPos = IncOrderPosNext(&walletdb);
-        wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, nullptr)));
-        wtx.nTimeSmart = ComputeTimeSmart(wtx);
-        AddToSpends(hash);
+        CWalletTx wtxNew(wtxIn);
+        wtxNew.BindWallet(this);
+        wtxNew.nTimeReceived = GetAdjustedTime();
+        wtxNew.nOrderPos = IncOrderPosNext(&walletdb);
+        wtxNew.nTimeSmart = ComputeTimeSmart(wtxNew);
+
+        // Write to disk
+        if (!walletdb.WriteTx(wtxNew))
+            return false;
+
+        AddNewToWallet(wtxNew);
+        return true;
     }
 
+    // Merge
+    CWalletTx& wtx = it->second;
     bool fUpdated = false;
-    if (!fInsertedNew)
+    if (!wtxIn.hashUnset() && wtxIn.hashBlock != wtx.hashBlock)
     {
-        // Merge
-        if (!wtxIn.hashUnset() && wtxIn.hashBlock != wtx.hashBlock)
-        {
-            wtx.hashBlock = wtxIn.hashBlock;
-            fUpdated = true;
-        }
-        // If no longer abandoned, update
-        if (wtxIn.hashBlock.IsNull() && wtx.isAbandoned())
-        {
-            wtx.hashBlock = wtxIn.hashBlock;
-            fUpdated = true;
-        }
-        if (wtxIn.nIndex != -1 && (wtxIn.nIndex != wtx.nIndex))
-        {
-            wtx.nIndex = wtxIn.nIndex;
-            fUpdated = true;
-        }
-        if (wtxIn.fFromMe && wtxIn.fFromMe != wtx.fFromMe)
-        {
-            wtx.fFromMe = wtxIn.fFromMe;
-            fUpdated = true;
-        }
+        wtx.hashBlock = wtxIn.hashBlock;
+        fUpdated = true;
+    }
+    // If no longer abandoned, update
+    if (wtxIn.hashBlock.IsNull() && wtx.isAbandoned())
+    {
+        wtx.hashBlock = wtxIn.hashBlock;
+        fUpdated = true;
+    }
+    if (wtxIn.nIndex != -1 && (wtxIn.nIndex != wtx.nIndex))
+    {
+        wtx.nIndex = wtxIn.nIndex;
+        fUpdated = true;
+    }
+    if (wtxIn.fFromMe && wtxIn.fFromMe != wtx.fFromMe)
+    {
+        wtx.fFromMe = wtxIn.fFromMe;
+        fUpdated = true;
     }
-
-    //// debug print
-    LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
     // Write to disk
-    if (fInsertedNew || fUpdated)
+    if (fUpdated)
         if (!walletdb.WriteTx(wtx))
             return false;
 
+    NotifyWalletTx(wtx, false, fUpdated);
+    return true;
+}
+
+void CWallet::AddNewToWallet(const CWalletTx& wtxNew)
+{
+    AssertLockHeld(cs_wallet);
+
+    const uint256 hash = wtxNew.GetHash();
+    CWalletTx& wtx = mapWallet.insert(std::make_pair(hash, wtxNew)).first->second;
+    wtx.BindWallet(this);
+    wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, nullptr)));
+    AddToSpends(hash);
+    // a ticket found in a block is only followed by the ledger from the
+    // block on, so its state is looked for at the tip
+    if (AddToTicketLedger(wtx) && !wtx.hashUnset())
+        ticketLedger.SetStale();
+
+    NotifyWalletTx(wtx, true, false);
+}
+
+void CWallet::NotifyWalletTx(CWalletTx& wtx, bool fInsertedNew, bool fUpdated)
+{
+    const uint256 hash = wtx.GetHash();
+
+    //// debug print
+    LogPrintf("AddToWallet %s  %s%s\n", hash.ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
+
     // Break debit/credit balance caches:
     wtx.MarkDirty();
 
@@ -1140,11 +1170,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 
     if (!strCmd.empty())
     {
-        boost::replace_all(strCmd, "%s", wtxIn.GetHash().GetHex());
+        boost::replace_all(strCmd, "%s", hash.GetHex());
         boost::thread t(runCommand, strCmd); // thread runs free
     }
-
-    return true;
 }
 
 bool CWallet::LoadToWallet(const CWalletTx& wtxIn)
@@ -1408,6 +1436,18 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
     for (size_t i = 0; i < pblock->vtx.size(); i++) {
         SyncTransaction(pblock->vtx[i], pindex, i);
     }
+
+    if (ticketLedger.IsStale())
+        return;
+    if (pindex->pstakeNode == nullptr) {
+        ticketLedger.SetStale();
+        return;
+    }
+    for (const CTransactionRef& ptx : pblock->vtx) {
+        if (ParseTxClass(*ptx) == TX_BuyTicket)
+            ticketLedger.SetMined(ptx->GetHash(), pindex->nHeight);
+    }
+    ticketLedger.ConnectNode(*pindex->pstakeNode);
 }
 
 void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) {
@@ -1416,6 +1456,19 @@ void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) {
     for (const CTransactionRef& ptx : pblock->vtx) {
         SyncTransaction(ptx);
     }
+
+    if (ticketLedger.IsStale())
+        return;
+    const auto it = mapBlockIndex.find(pblock->GetHash());
+    if (it == mapBlockIndex.end() || it->second->pstakeNode == nullptr) {
+        ticketLedger.SetStale();
+        return;
+    }
+    for (const CTransactionRef& ptx : pblock->vtx) {
+        if (ParseTxClass(*ptx) == TX_BuyTicket)
+            ticketLedger.SetUnmined(ptx->GetHash());
+    }
+    ticketLedger.DisconnectNode(*it->second->pstakeNode);
 }
 
 
@@ -2085,15 +2138,19 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
         return std::make_pair(results, error);
     }
 
-    // create ticket purchase transactions using the corresponding inputs of the split transaction
-    // and having the dedicated output structure for ticket purchase
-    for (unsigned int i = 0; i < numTickets; ++i) {
-        if (GetBroadcastTransactions() && !g_connman) {
-            error.Load(CWalletError::CLIENT_P2P_DISABLED, "Peer-to-peer functionality missing or disabled");
-            return std::make_pair(results, error);
-        }
+    if (GetBroadcastTransactions() && !g_connman) {
+        error.Load(CWalletError::CLIENT_P2P_DISABLED, "Peer-to-peer functionality missing or disabled");
+        return std::make_pair(results, error);
+    }
 
-        CMutableTransaction mTicketTx;
+    // create ticket purchase transactions using the corresponding inputs of the split transaction
+    // and having the dedicated output structure for ticket purchase.
+    // The tickets built before an error are still sent, as the ones that are signed.
+    std::vector<CTransactionToSign> vTickets;
+    vTickets.reserve(numTickets);
+    for (unsigned int i = 0; i < numTickets && error.code == CWalletError::SUCCESSFUL; ++i) {
+        CTransactionToSign ticketToSign;
+        CMutableTransaction& mTicketTx = ticketToSign.mtx;
 
         mTicketTx.nExpiry = static_cast<uint32_t>(expiry);
 
@@ -2105,6 +2162,9 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
         } else
             mTicketTx.vin.push_back(CTxIn(splitTx->GetHash(), i));
 
+        for (unsigned int nIn = 0; nIn < mTicketTx.vin.size(); ++nIn)
+            ticketToSign.vSpent.emplace_back(nIn, splitTx->tx->vout[mTicketTx.vin[nIn].prevout.n]);
+
         // outputs
 
         // buy ticket transaction declaration
@@ -2125,7 +2185,7 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
             const auto& inputValue = splitTx->tx->vout[2*i].nValue;
             if (vspFee != inputValue) {
                 error.Load(CWalletError::TRANSACTION_ERROR, "Incorrect split transaction output for VSP fee");
-                return std::make_pair(results, error);
+                break;
             }
 
             // contribution output
@@ -2138,7 +2198,7 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
             CAmount change = inputValue - contributedAmount;
             if (change != 0) {
                 error.Load(CWalletError::TRANSACTION_ERROR, "Invalid change value for the VSP");
-                return std::make_pair(results, error);
+                break;
             }
             CScript changeScript = GetScriptForDestination(vspAddress);
             mTicketTx.vout.push_back(CTxOut(change, changeScript));
@@ -2151,7 +2211,7 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
             const auto& inputValue = splitTx->tx->vout[(useVsp ? 2*i+1 : i)].nValue;
             if (neededPerTicket - vspFee != inputValue) {
                 error.Load(CWalletError::TRANSACTION_ERROR, "Incorrect split transaction output for VSP fee");
-                return std::make_pair(results, error);
+                break;
             }
 
             // contribution output
@@ -2163,7 +2223,7 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
                 CPubKey newKey;
                 if (!GetKeyFromPool(newKey)) {
                     error.Load(CWalletError::WALLET_KEYPOOL_RAN_OUT, "Keypool ran out, please call keypoolrefill first");
-                    return std::make_pair(results, error);
+                    break;
                 }
                 userAddress = newKey.GetID();
             }
@@ -2179,14 +2239,14 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
                 CPubKey newKey;
                 if (!GetKeyFromPool(newKey, true)) {
                     error.Load(CWalletError::WALLET_KEYPOOL_RAN_OUT, "Keypool ran out, please call keypoolrefill first");
-                    return std::make_pair(results, error);
+                    break;
                 }
                 changeAddr = newKey.GetID();
             }
             CAmount change = inputValue - contributedAmount;
             if (change != 0) {
                 error.Load(CWalletError::TRANSACTION_ERROR, "Invalid change value for the user");
-                return std::make_pair(results, error);
+                break;
             }
             CScript changeScript = GetScriptForDestination(changeAddr);
             mTicketTx.vout.push_back(CTxOut(change, changeScript));
@@ -2195,33 +2255,44 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::PurchaseTicket(std::s
         std::string reason;
         if (!ValidateBuyTicketStructure(mTicketTx, reason)) {
             error.Load(CWalletError::TRANSACTION_ERROR, "Error while constructing buy ticket transaction :" + reason);
-            return std::make_pair(results, error);
+            break;
         }
 
-        if (!SignTransaction(mTicketTx)) {
+        vTickets.push_back(std::move(ticketToSign));
+    }
+
+    // the tickets are signed at once, then written and sent together
+
+    SignTransactions(vTickets);
+
+    std::vector<CWalletTx> vwtx;
+    vwtx.reserve(vTickets.size());
+    for (CTransactionToSign& ticketToSign : vTickets) {
+        if (!ticketToSign.fSigned) {
             error.Load(CWalletError::TRANSACTION_ERROR, "Signing transaction failed");
-            return std::make_pair(results, error);
+            continue;
         }
 
         // Uncommenting the following lines will disable replacing-by-fee of this ticket transaction
         // This might be undesirable, so caution must be taken if uncommenting these lines
-        if (IsTicketInMempool(mTicketTx))
+        if (IsTicketInMempool(ticketToSign.mtx))
            continue;
 
-        CValidationState state;
-        CWalletTx wtx;
+        vwtx.emplace_back();
+        CWalletTx& wtx = vwtx.back();
         wtx.fTimeReceivedIsTxTime = true;
         wtx.BindWallet(this);
-        wtx.SetTx(MakeTransactionRef(std::move(mTicketTx)));
-        CReserveKey reservekey{this};
-        if (!CommitTransaction(wtx, reservekey, g_connman.get(), state)) {
-            error.Load(CWalletError::TRANSACTION_ERROR, "Committing transaction failed");
-            return std::make_pair(results, error);
-        }
+        wtx.SetTx(MakeTransactionRef(std::move(ticketToSign.mtx)));
+    }
 
-        results.push_back(wtx.GetHash().GetHex());
+    if (!CommitTransactions(vwtx, g_connman.get())) {
+        error.Load(CWalletError::TRANSACTION_ERROR, "Committing transaction failed");
+        return std::make_pair(results, error);
     }
 
+    for (const CWalletTx& wtx : vwtx)
+        results.push_back(wtx.GetHash().GetHex());
+
     return std::make_pair(results, error);
 }
 
@@ -2266,68 +2337,132 @@ std::pair<std::string, CWalletError> CWallet::Vote(const uint256& ticketHash, co
        return std::make_pair(voteHash, error);
     }
 
+    CVoteTemplate voteTemplate;
+    if (!CreateVoteTemplate(ticketHash, voteTemplate, error))
+        return std::make_pair(voteHash, error);
+
+    std::vector<CTransactionToSign> vVotes(1);
+    if (!CreateVote(voteTemplate, blockHash, blockHeight, voteBits, extendedVoteBits, vVotes[0], error))
+        return std::make_pair(voteHash, error);
+
+    // signature (for stake input only)
+
+    SignTransactions(vVotes);
+    if (!vVotes[0].fSigned) {
+        error.Load(CWalletError::TRANSACTION_ERROR, "Could not sign the vote transaction");
+        return std::make_pair(voteHash, error);
+    }
+
+    // commitment
+
+    CValidationState state;
+    CWalletTx wtx;
+    wtx.fTimeReceivedIsTxTime = true;
+    wtx.BindWallet(this);
+    wtx.SetTx(MakeTransactionRef(std::move(vVotes[0].mtx)));
+    CReserveKey reservekey{this};
+    if (!CommitTransaction(wtx, reservekey, g_connman.get(), state)) {
+        error.Load(CWalletError::TRANSACTION_ERROR, "Committing transaction failed");
+        return std::make_pair(voteHash, error);
+    }
+
+    voteHash = wtx.GetHash().GetHex();
+
+    return std::make_pair(voteHash, error);
+}
+
+bool CWallet::CreateVoteTemplate(const uint256& ticketHash, CVoteTemplate& voteTemplate, CWalletError& error) const
+{
+    AssertLockHeld(cs_wallet);
+
     const CWalletTx* ticketWtx = GetWalletTx(ticketHash);
     if (ticketWtx == nullptr) {
         error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Ticket is invalid or does not belong to the wallet");
-        return std::make_pair(voteHash, error);
+        return false;
     }
 
     const CTransactionRef& ticket = ticketWtx->tx;
     if (ticket == nullptr) {
         error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Ticket is invalid or does not belong to the wallet");
-        return std::make_pair(voteHash, error);
+        return false;
     }
 
     std::string reason;
 
     if (ParseTxClass(*ticket) != TX_BuyTicket || !ValidateBuyTicketStructure(*ticket, reason) ) {
         error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Invalid ticket hash, must be hash of a ticket purchase transaction");
-        return std::make_pair(voteHash, error);
-    }
-
-    // verify the voted block and it's winners
-    if (mapBlockIndex.count(blockHash) == 0) {
-        error.Load(CWalletError::INVALID_PARAMETER, "Block not found");
-        return std::make_pair(voteHash, error);
-    }
-    const CBlockIndex* const blockIndex = mapBlockIndex[blockHash];
-    if (blockHeight != blockIndex->nHeight) {
-        error.Load(CWalletError::INVALID_PARAMETER, "Invalid block height (different than the actual height of the specified block)");
-        return std::make_pair(voteHash, error);
-    }
-    if (blockIndex->pstakeNode != nullptr
-            && std::find(blockIndex->pstakeNode->Winners().begin(), blockIndex->pstakeNode->Winners().end(), ticket->GetHash()) == blockIndex->pstakeNode->Winners().end()) {
-        error.Load(CWalletError::INVALID_PARAMETER, "Ticket is not selected to vote in this block");
-        return std::make_pair(voteHash, error);
+        return false;
     }
 
     // ticket contributions
 
-    std::vector<TicketContribData> contributions;
     CAmount totalContribution{0};
     CAmount totalVoteFeeLimit{0};
     CAmount totalRevocationFeeLimit{0};
-    if (!ParseTicketContribs(*ticket, contributions, totalContribution, totalVoteFeeLimit, totalRevocationFeeLimit)) {
+    if (!ParseTicketContribs(*ticket, voteTemplate.contributions, totalContribution, totalVoteFeeLimit, totalRevocationFeeLimit)) {
         error.Load(CWalletError::TRANSACTION_ERROR, "Specified ticket has invalid contributions");
-        return std::make_pair(voteHash, error);
+        return false;
+    }
+
+    // reward scripts
+
+    for (const TicketContribData& contrib : voteTemplate.contributions) {
+        if (contrib.whichAddr == 0) {
+            error.Load(CWalletError::TRANSACTION_ERROR, "The reward address type is not correct");
+            return false;
+        } else if (contrib.whichAddr == 1) {
+            voteTemplate.vRewardScripts.push_back(GetScriptForDestination(CKeyID(contrib.rewardAddr)));
+        } else {
+            voteTemplate.vRewardScripts.push_back(GetScriptForDestination(CScriptID(contrib.rewardAddr)));
+        }
+    }
+
+    voteTemplate.ticketHash = ticketHash;
+    voteTemplate.stakeOut = ticket->vout[ticketStakeOutputIndex];
+    return true;
+}
+
+bool CWallet::CreateVote(const CVoteTemplate& voteTemplate, const uint256& blockHash, const int blockHeight, const VoteBits voteBits, const ExtendedVoteBits& extendedVoteBits, CTransactionToSign& vote, CWalletError& error) const
+{
+    AssertLockHeld(cs_main);
+
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    // verify the voted block and it's winners
+    const auto it = mapBlockIndex.find(blockHash);
+    if (it == mapBlockIndex.end()) {
+        error.Load(CWalletError::INVALID_PARAMETER, "Block not found");
+        return false;
+    }
+    const CBlockIndex* const blockIndex = it->second;
+    if (blockHeight != blockIndex->nHeight) {
+        error.Load(CWalletError::INVALID_PARAMETER, "Invalid block height (different than the actual height of the specified block)");
+        return false;
+    }
+    if (blockIndex->pstakeNode != nullptr) {
+        const HashVector winners = blockIndex->pstakeNode->Winners();
+        if (std::find(winners.begin(), winners.end(), voteTemplate.ticketHash) == winners.end()) {
+            error.Load(CWalletError::INVALID_PARAMETER, "Ticket is not selected to vote in this block");
+            return false;
+        }
     }
 
     // funds
 
-    const CAmount& ticketPrice = ticket->vout[ticketStakeOutputIndex].nValue;
+    const CAmount& ticketPrice = voteTemplate.stakeOut.nValue;
     const CAmount& voteSubsidy = GetVoterSubsidy(blockHeight + 1, consensus);
 
     // rewards
 
-    std::vector<CAmount> rewards = CalculateNetRemunerations(contributions, ticketPrice, voteSubsidy /*no fee for votes*/);
-    if (rewards.size() != contributions.size()) {
+    std::vector<CAmount> rewards = CalculateNetRemunerations(voteTemplate.contributions, ticketPrice, voteSubsidy /*no fee for votes*/);
+    if (rewards.size() != voteTemplate.contributions.size()) {
         error.Load(CWalletError::TRANSACTION_ERROR, "Could not retrive correct rewards");
-        return std::make_pair(voteHash, error);
+        return false;
     }
 
     // vote transaction
 
-    CMutableTransaction mVoteTx;
+    CMutableTransaction& mVoteTx = vote.mtx;
 
     // inputs
 
@@ -2335,7 +2470,8 @@ std::pair<std::string, CWalletError> CWallet::Vote(const uint256& ticketHash, co
     mVoteTx.vin.push_back(CTxIn(COutPoint(), consensus.stakeBaseSigScript));
 
     // staked amounts
-    mVoteTx.vin.push_back(CTxIn(ticket->GetHash(), ticketStakeOutputIndex));
+    mVoteTx.vin.push_back(CTxIn(voteTemplate.ticketHash, ticketStakeOutputIndex));
+    vote.vSpent.emplace_back(voteStakeInputIndex, voteTemplate.stakeOut);
 
     // outputs
 
@@ -2345,64 +2481,25 @@ std::pair<std::string, CWalletError> CWallet::Vote(const uint256& ticketHash, co
     mVoteTx.vout.push_back(CTxOut(0, declScript));
 
     // payment outputs containing the proportional rewards
-    for (unsigned i = 0; i < contributions.size(); ++i) {
-        const TicketContribData& contrib = contributions[i];
-
+    for (unsigned i = 0; i < voteTemplate.contributions.size(); ++i) {
         const CAmount& reward = rewards[i];
         if (!MoneyRange(reward)) {
             error.Load(CWalletError::TRANSACTION_ERROR, "Incorrect reward");
-            return std::make_pair(voteHash, error);
-        }
-
-        CScript script;
-        if (contrib.whichAddr == 0) {
-            error.Load(CWalletError::TRANSACTION_ERROR, "The reward address type is not correct");
-            return std::make_pair(voteHash, error);
-        } else if (contrib.whichAddr == 1) {
-            script = GetScriptForDestination(CKeyID(contrib.rewardAddr));
-        } else {
-            script = GetScriptForDestination(CScriptID(contrib.rewardAddr));
+            return false;
         }
 
-        mVoteTx.vout.push_back(CTxOut(reward, script));
+        mVoteTx.vout.push_back(CTxOut(reward, voteTemplate.vRewardScripts[i]));
     }
 
     // structural validation
 
+    std::string reason;
     if (!ValidateVoteStructure(mVoteTx, reason)) {
         error.Load(CWalletError::TRANSACTION_ERROR, "Failed to build the vote transaction: " + reason);
-        return std::make_pair(voteHash, error);
-    }
-
-    // signature (for stake input only)
-
-    {
-        CTransaction tx(mVoteTx);
-        const CScript& scriptPubKey = ticket->vout[ticketStakeOutputIndex].scriptPubKey;
-        SignatureData sigdata;
-        if (!ProduceSignature(TransactionSignatureCreator(this, &tx, 1, ticketPrice, SIGHASH_ALL), scriptPubKey, sigdata)) {
-            error.Load(CWalletError::TRANSACTION_ERROR, "Could not sign the vote transaction");
-            return std::make_pair(voteHash, error);
-        }
-        UpdateTransaction(mVoteTx, 1, sigdata);
-    }
-
-    // commitment
-
-    CValidationState state;
-    CWalletTx wtx;
-    wtx.fTimeReceivedIsTxTime = true;
-    wtx.BindWallet(this);
-    wtx.SetTx(MakeTransactionRef(std::move(mVoteTx)));
-    CReserveKey reservekey{this};
-    if (!CommitTransaction(wtx, reservekey, g_connman.get(), state)) {
-        error.Load(CWalletError::TRANSACTION_ERROR, "Committing transaction failed");
-        return std::make_pair(voteHash, error);
+        return false;
     }
 
-    voteHash = wtx.GetHash().GetHex();
-
-    return std::make_pair(voteHash, error);
+    return true;
 }
 
 std::pair<std::string, CWalletError> CWallet::Revoke(const uint256& ticketHash)
@@ -2433,43 +2530,88 @@ std::pair<std::string, CWalletError> CWallet::Revoke(const uint256& ticketHash)
         return std::make_pair(revocationHash, error);
     }
 
+    std::vector<CTransactionToSign> vRevocations(1);
+    if (!CreateRevocation(ticketHash, vRevocations[0], error))
+        return std::make_pair(revocationHash, error);
+
+    // signature
+
+    SignTransactions(vRevocations);
+    if (!vRevocations[0].fSigned) {
+        error.Load(CWalletError::TRANSACTION_ERROR, "Could not sign the revocation transaction");
+        return std::make_pair(revocationHash, error);
+    }
+
+    // structural validation
+
+    std::string reason;
+    if (!ValidateRevokeTicketStructure(vRevocations[0].mtx, reason)) {
+        error.Load(CWalletError::TRANSACTION_ERROR, "Failed to build the revocation transaction: " + reason);
+        return std::make_pair(revocationHash, error);
+    }
+
+    // commitment
+
+    CValidationState state;
+    CWalletTx wtx;
+    wtx.fTimeReceivedIsTxTime = true;
+    wtx.BindWallet(this);
+    wtx.SetTx(MakeTransactionRef(std::move(vRevocations[0].mtx)));
+    CReserveKey reservekey{this};
+    if (!CommitTransaction(wtx, reservekey, g_connman.get(), state)) {
+        error.Load(CWalletError::TRANSACTION_ERROR, "Committing transaction failed");
+        return std::make_pair(revocationHash, error);
+    }
+
+    revocationHash = wtx.GetHash().GetHex();
+
+    return std::make_pair(revocationHash, error);
+}
+
+bool CWallet::CreateRevocation(const uint256& ticketHash, CTransactionToSign& revocation, CWalletError& error) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const CBlockIndex* chainTip = chainActive.Tip();
+
     if (!chainTip->pstakeNode->ExistsMissedTicket(ticketHash)) {
         error.Load(CWalletError::INVALID_PARAMETER, "Ticket is not missed or expired yet");
-        return std::make_pair(revocationHash, error);
+        return false;
     }
 
     if (IsTicketRevokedInMempool(ticketHash)) {
        error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Ticket is already revoked in mempool");
-       return std::make_pair(revocationHash, error);
+       return false;
     }
 
     if (IsTicketVotedInMempool(ticketHash)) {
        error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Ticket is already used for a vote in mempool");
-       return std::make_pair(revocationHash, error);
+       return false;
     }
 
     const CWalletTx* ticketWtx = GetWalletTx(ticketHash);
     if (ticketWtx == nullptr) {
         error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Ticket is invalid or does not belong to the wallet");
-        return std::make_pair(revocationHash, error);
+        return false;
     }
 
     const CTransactionRef& ticket = ticketWtx->tx;
     if (ticket == nullptr) {
         error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Ticket is invalid or does not belong to the wallet");
-        return std::make_pair(revocationHash, error);
+        return false;
     }
 
     std::string reason;
 
     if (ParseTxClass(*ticket) != TX_BuyTicket || !ValidateBuyTicketStructure(*ticket, reason) ) {
         error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Invalid ticket hash, must be hash of a ticket purchase transaction");
-        return std::make_pair(revocationHash, error);
+        return false;
     }
 
     if (!IsMyTicket(*ticket)) {
         error.Load(CWalletError::INVALID_ADDRESS_OR_KEY, "Revoked ticket does not belong to the wallet");
-        return std::make_pair(revocationHash, error);
+        return false;
     }
 
     // ticket contributions
@@ -2480,7 +2622,7 @@ std::pair<std::string, CWalletError> CWallet::Revoke(const uint256& ticketHash)
     CAmount totalRevocationFeeLimit{0};
     if (!ParseTicketContribs(*ticket, contributions, totalContribution, totalVoteFeeLimit, totalRevocationFeeLimit)) {
         error.Load(CWalletError::TRANSACTION_ERROR, "Specified ticket has invalid contributions");
-        return std::make_pair(revocationHash, error);
+        return false;
     }
 
     // funds
@@ -2497,17 +2639,18 @@ std::pair<std::string, CWalletError> CWallet::Revoke(const uint256& ticketHash)
     std::vector<CAmount> refunds = CalculateNetRemunerations(contributions, ticketPrice, 0/*no subsidy*/, fee, FeeDistributionPolicy::ProportionalFee);
     if (refunds.size() != contributions.size()) {
         error.Load(CWalletError::TRANSACTION_ERROR, "Could not retrive correct refunds");
-        return std::make_pair(revocationHash, error);
+        return false;
     }
 
     // revocation transaction
 
-    CMutableTransaction mRevokeTx;
+    CMutableTransaction& mRevokeTx = revocation.mtx;
 
     // inputs
 
     // staked amounts
     mRevokeTx.vin.push_back(CTxIn(ticket->GetHash(), ticketStakeOutputIndex));
+    revocation.vSpent.emplace_back(0, ticket->vout[ticketStakeOutputIndex]);
 
     // outputs
 
@@ -2523,13 +2666,13 @@ std::pair<std::string, CWalletError> CWallet::Revoke(const uint256& ticketHash)
         const CAmount& refund = refunds[i];
         if (!MoneyRange(refund)) {
             error.Load(CWalletError::TRANSACTION_ERROR, "Incorrect refund");
-            return std::make_pair(revocationHash, error);
+            return false;
         }
 
         CScript script;
         if (contrib.whichAddr == 0) {
             error.Load(CWalletError::TRANSACTION_ERROR, "The refund address type is not correct");
-            return std::make_pair(revocationHash, error);
+            return false;
         } else if (contrib.whichAddr == 1) {
             script = GetScriptForDestination(CKeyID(contrib.rewardAddr));
         } else {
@@ -2539,42 +2682,7 @@ std::pair<std::string, CWalletError> CWallet::Revoke(const uint256& ticketHash)
         mRevokeTx.vout.push_back(CTxOut(refund, script));
     }
 
-    // signature
-
-    {
-        CTransaction tx(mRevokeTx);
-        const CScript& scriptPubKey = ticket->vout[ticketStakeOutputIndex].scriptPubKey;
-        SignatureData sigdata;
-        if (!ProduceSignature(TransactionSignatureCreator(this, &tx, 0, ticketPrice, SIGHASH_ALL), scriptPubKey, sigdata)) {
-            error.Load(CWalletError::TRANSACTION_ERROR, "Could not sign the revocation transaction");
-            return std::make_pair(revocationHash, error);
-        }
-        UpdateTransaction(mRevokeTx, 0, sigdata);
-    }
-
-    // structural validation
-
-    if (!ValidateRevokeTicketStructure(mRevokeTx, reason)) {
-        error.Load(CWalletError::TRANSACTION_ERROR, "Failed to build the revocation transaction: " + reason);
-        return std::make_pair(revocationHash, error);
-    }
-
-    // commitment
-
-    CValidationState state;
-    CWalletTx wtx;
-    wtx.fTimeReceivedIsTxTime = true;
-    wtx.BindWallet(this);
-    wtx.SetTx(MakeTransactionRef(std::move(mRevokeTx)));
-    CReserveKey reservekey{this};
-    if (!CommitTransaction(wtx, reservekey, g_connman.get(), state)) {
-        error.Load(CWalletError::TRANSACTION_ERROR, "Committing transaction failed");
-        return std::make_pair(revocationHash, error);
-    }
-
-    revocationHash = wtx.GetHash().GetHex();
-
-    return std::make_pair(revocationHash, error);
+    return true;
 }
 
 std::pair<std::vector<std::string>, CWalletError> CWallet::RevokeAll()
@@ -2600,28 +2708,80 @@ std::pair<std::vector<std::string>, CWalletError> CWallet::RevokeAll()
         return std::make_pair(results, error);
     }
 
-    // try sending a revocation transaction for each missed ticket that belongs
-    // to the wallet; missed tickets include the expired ones too; validations
-    // are made in Revoke()
+    // build a revocation transaction for each missed ticket of the wallet,
+    // which the ticket ledger keeps track of; missed tickets include the
+    // expired ones too; then sign them all at once and send them together
 
-    std::string revocatioHash;
     CWalletError we;
     std::string failedRevocations{"Tickets that failed to be revoked:"};
 
-    for (const uint256& ticketHash : chainTip->pstakeNode->MissedTickets()) {
-        std::tie(revocatioHash, we) = Revoke(ticketHash);
-
-        if (we.code == CWalletError::SUCCESSFUL && !revocatioHash.empty())
-            results.push_back(revocatioHash);
-        else if (we.code != CWalletError::INVALID_ADDRESS_OR_KEY) {
+    std::vector<uint256> vTicketHashes;
+    std::vector<CTransactionToSign> vRevocations;
+    for (const uint256& ticketHash : GetTicketLedger().GetMissedTickets()) {
+        CTransactionToSign revocation;
+        if (CreateRevocation(ticketHash, revocation, we)) {
+            vTicketHashes.push_back(ticketHash);
+            vRevocations.push_back(std::move(revocation));
+        } else if (we.code != CWalletError::INVALID_ADDRESS_OR_KEY) {
             failedRevocations += (" " + ticketHash.GetHex());
             error.Load(CWalletError::TRANSACTION_ERROR, failedRevocations);
         }
     }
 
+    SignTransactions(vRevocations);
+
+    std::vector<CWalletTx> vwtx;
+    std::string reason;
+    for (size_t i = 0; i < vRevocations.size(); ++i) {
+        if (!vRevocations[i].fSigned || !ValidateRevokeTicketStructure(vRevocations[i].mtx, reason)) {
+            failedRevocations += (" " + vTicketHashes[i].GetHex());
+            error.Load(CWalletError::TRANSACTION_ERROR, failedRevocations);
+            continue;
+        }
+
+        vwtx.emplace_back();
+        CWalletTx& wtx = vwtx.back();
+        wtx.fTimeReceivedIsTxTime = true;
+        wtx.BindWallet(this);
+        wtx.SetTx(MakeTransactionRef(std::move(vRevocations[i].mtx)));
+    }
+
+    CommitTransactions(vwtx, g_connman.get());
+    for (const CWalletTx& wtx : vwtx)
+        results.push_back(wtx.GetHash().GetHex());
+
     return std::make_pair(results, error);
 }
 
+void CWallet::SignTransactions(std::vector<CTransactionToSign>& vTxToSign) const
+{
+    // each transaction is signed by a single thread, as the signature of an
+    // input depends on the other inputs
+    std::atomic<size_t> nNext(0);
+    auto worker = [&]() {
+        for (size_t i = nNext++; i < vTxToSign.size(); i = nNext++) {
+            CTransactionToSign& txToSign = vTxToSign[i];
+            txToSign.fSigned = true;
+            for (const std::pair<unsigned int, CTxOut>& spent : txToSign.vSpent) {
+                const CTransaction tx(txToSign.mtx);
+                SignatureData sigdata;
+                if (!ProduceSignature(TransactionSignatureCreator(this, &tx, spent.first, spent.second.nValue, SIGHASH_ALL), spent.second.scriptPubKey, sigdata)) {
+                    txToSign.fSigned = false;
+                    break;
+                }
+                UpdateTransaction(txToSign.mtx, spent.first, sigdata);
+            }
+        }
+    };
+
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_SIGNING_THREADS));
+    boost::thread_group workers;
+    for (int i = 1; i < std::min((int)vTxToSign.size(), nThreads); ++i)
+        workers.create_thread(worker);
+    worker();
+    workers.join_all();
+}
+
 int64_t CWalletTx::GetTxTime() const
 {
     int64_t n = nTimeSmart;
@@ -2754,6 +2914,93 @@ int64_t CWallet::RescanFromTime(int64_t startTime, bool update)
     return startTime;
 }
 
+/**
+ * The scripts a rescan looks for. The filter matches every output IsMine()
+ * accepts, and a few more (e.g. multisig outputs with only some of the keys
+ * in the wallet), so that the outputs it does not match are certainly not
+ * ours; AddToWalletIfInvolvingMe() decides on the rest.
+ */
+struct CWallet::RescanFilter
+{
+    std::set<CKeyID> setKeys;
+    std::set<CScriptID> setScripts;
+    std::set<CScript> setWatchOnly;
+    size_t nKeyStoreSize;
+
+    bool MayBeMine(const CScript& scriptPubKey) const
+    {
+        if (setWatchOnly.count(scriptPubKey))
+            return true;
+
+        std::vector<std::vector<unsigned char>> vSolutions;
+        txnouttype whichType;
+        if (!Solver(scriptPubKey, whichType, vSolutions))
+            return false;
+
+        switch (whichType) {
+        case TX_PUBKEY:
+            return setKeys.count(CPubKey(vSolutions[0]).GetID()) != 0;
+        case TX_PUBKEYHASH:
+        case TX_WITNESS_V0_KEYHASH:
+            return setKeys.count(CKeyID(uint160(vSolutions[0]))) != 0;
+        case TX_SCRIPTHASH:
+            return setScripts.count(CScriptID(uint160(vSolutions[0]))) != 0;
+        case TX_WITNESS_V0_SCRIPTHASH:
+            return setScripts.count(CScriptID(CScript() << OP_0 << vSolutions[0])) != 0;
+        case TX_MULTISIG:
+            for (size_t i = 1; i + 1 < vSolutions.size(); ++i) {
+                if (setKeys.count(CPubKey(vSolutions[i]).GetID()))
+                    return true;
+            }
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    bool MayInvolve(const CTransaction& tx) const
+    {
+        for (const CTxOut& txout : tx.vout) {
+            if (MayBeMine(txout.scriptPubKey))
+                return true;
+        }
+        return false;
+    }
+};
+
+std::shared_ptr<const CWallet::RescanFilter> CWallet::MakeRescanFilter() const
+{
+    std::shared_ptr<RescanFilter> filter = std::make_shared<RescanFilter>();
+    LOCK(cs_KeyStore);
+    for (const auto& item : mapKeys)
+        filter->setKeys.insert(item.first);
+    for (const auto& item : mapCryptedKeys)
+        filter->setKeys.insert(item.first);
+    for (const auto& item : mapScripts)
+        filter->setScripts.insert(item.first);
+    filter->setWatchOnly = setWatchOnly;
+    filter->nKeyStoreSize = GetKeyStoreSize();
+    return filter;
+}
+
+size_t CWallet::GetKeyStoreSize() const
+{
+    LOCK(cs_KeyStore);
+    return mapKeys.size() + mapCryptedKeys.size() + mapScripts.size() + setWatchOnly.size();
+}
+
+bool CWallet::IsRescanCandidate(const CTransaction& tx) const
+{
+    AssertLockHeld(cs_wallet);
+    if (mapWallet.count(tx.GetHash()))
+        return true;
+    for (const CTxIn& txin : tx.vin) {
+        if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout))
+            return true;
+    }
+    return false;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -2765,6 +3012,12 @@ int64_t CWallet::RescanFromTime(int64_t startTime, bool update)
  *
  * If pindexStop is not a nullptr, the scan will stop at the block-index
  * defined by pindexStop
+ *
+ * The blocks are read and matched against the scripts of the wallet by
+ * several threads, a batch at a time, without the wallet lock; the
+ * transactions that may involve the wallet are then added in chain order.
+ * Adding them can add keys to the wallet (see TopUpKeyPool), in which case
+ * the transactions that follow are matched again.
  */
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlockIndex* pindexStop, bool fUpdate)
 {
@@ -2775,6 +3028,16 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
         assert(pindexStop->nHeight >= pindexStart->nHeight);
     }
 
+    struct ScannedBlock
+    {
+        bool fRead = false;
+        std::vector<CTransactionRef> vtx;
+        std::vector<bool> vMatched;
+        std::shared_ptr<const RescanFilter> filter;
+    };
+
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_RESCAN_THREADS));
+
     CBlockIndex* pindex = pindexStart;
     CBlockIndex* ret = nullptr;
     {
@@ -2785,33 +3048,82 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
         double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
+        std::shared_ptr<const RescanFilter> filter = MakeRescanFilter();
         while (pindex && !fAbortRescan)
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+            std::vector<CBlockIndex*> vpindex;
+            for (; pindex && vpindex.size() < RESCAN_BATCH_SIZE; pindex = chainActive.Next(pindex)) {
+                vpindex.push_back(pindex);
+                if (pindex == pindexStop)
+                    break;
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+            // the blocks are only read here; cs_main, held by this thread,
+            // keeps their positions from changing
+            std::vector<ScannedBlock> vScanned(vpindex.size());
+            std::atomic<size_t> nNext(0);
+            auto worker = [&]() {
+                for (size_t i = nNext++; i < vpindex.size() && !fAbortRescan; i = nNext++) {
+                    CBlock block;
+                    if (!ReadBlockFromDisk(block, vpindex[i], chainParams.GetConsensus()))
+                        continue;
+                    ScannedBlock& scanned = vScanned[i];
+                    scanned.fRead = true;
+                    scanned.filter = filter;
+                    scanned.vMatched.reserve(block.vtx.size());
+                    for (const CTransactionRef& tx : block.vtx)
+                        scanned.vMatched.push_back(filter->MayInvolve(*tx));
+                    scanned.vtx = std::move(block.vtx);
+                }
+            };
+            boost::thread_group workers;
+            for (int i = 1; i < std::min((int)vpindex.size(), nThreads); ++i)
+                workers.create_thread(worker);
+            worker();
+            workers.join_all();
+
+            for (size_t i = 0; i < vpindex.size(); ++i) {
+                CBlockIndex* pindexScanned = vpindex[i];
+                if (fAbortRescan) {
+                    pindex = pindexScanned;
+                    break;
+                }
+                if (pindexScanned->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindexScanned) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+                if (GetTime() >= nNow + 60) {
+                    nNow = GetTime();
+                    LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindexScanned->nHeight, GuessVerificationProgress(chainParams.TxData(), pindexScanned));
+                }
+
+                ScannedBlock& scanned = vScanned[i];
+                if (!scanned.fRead) {
+                    ret = pindexScanned;
+                    continue;
+                }
+
+                for (size_t posInBlock = 0; posInBlock < scanned.vtx.size(); ++posInBlock) {
+                    const CTransaction& tx = *scanned.vtx[posInBlock];
+                    const bool fMatched = scanned.filter == filter ? scanned.vMatched[posInBlock] : filter->MayInvolve(tx);
+                    if (!fMatched && !IsRescanCandidate(tx))
+                        continue;
+                    // the keys a transaction takes from the keypool are
+                    // replaced, and the new ones looked for from then on
+                    if (AddToWalletIfInvolvingMe(scanned.vtx[posInBlock], pindexScanned, posInBlock, fUpdate) && GetKeyStoreSize() != filter->nKeyStoreSize)
+                        filter = MakeRescanFilter();
                 }
-            } else {
-                ret = pindex;
             }
-            if (pindex == pindexStop) {
+
+            if (!vpindex.empty() && vpindex.back() == pindexStop)
                 break;
-            }
-            pindex = chainActive.Next(pindex);
         }
         if (pindex && fAbortRescan) {
             LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
         }
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
 
+        // the tickets found are in blocks the ledger did not follow
+        ticketLedger.SetStale();
+
         fScanningWallet = false;
     }
     return ret;
@@ -3220,67 +3532,78 @@ CAmount CWallet::GetBalance() const
 
 void CWallet::GetStakedBalances(CAmount& total, CAmount& mempool, CAmount& immature, CAmount& live, CAmount& voted, CAmount& missed, CAmount& expired, CAmount& revoked) const
 {
-    const Consensus::Params& consensus = Params().GetConsensus();
-    CWalletTx spendingWtx;
-
     total = mempool = immature = live = voted = missed = expired = revoked = 0;
 
     LOCK2(cs_main, cs_wallet);
 
-    auto stakeNode = chainActive.Tip()->pstakeNode;
+    const CTicketLedger& ledger = GetTicketLedger();
 
-    for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-    {
-        const CWalletTx* wtx = &(*it).second;
-        const CTransactionRef tx = wtx->tx;
-        if (wtx->IsTrusted()) {
-            // Only ticket purchases can stake
-            ETxClass txClass = ParseTxClass(*tx);
-            if (txClass != TX_BuyTicket)
-                continue;
-
-            // Stake output must be valid
-            if (tx->vout.size() < ticketStakeOutputIndex + 1 || !MoneyRange(tx->vout[ticketStakeOutputIndex].nValue))
-                continue;
+    // the tickets not yet mined are immature
+    for (const uint256& hash : ledger.GetUnminedTickets()) {
+        const CWalletTx* wtx = GetWalletTx(hash);
+        if (wtx == nullptr || !wtx->IsTrusted())
+            continue;
 
-            CAmount stakedCredit = GetCredit(tx->vout[ticketStakeOutputIndex], ISMINE_SPENDABLE);
-            if (!MoneyRange(stakedCredit))
-                throw std::runtime_error(std::string(__func__) + " : value out of range");
+        const CAmount stakedCredit = ledger.GetTicket(hash)->nStakeCredit;
+        total += stakedCredit;
+        immature += stakedCredit;
+        if (wtx->InMempool())
+            mempool += stakedCredit;
+    }
 
-            total += stakedCredit;
+    immature += ledger.GetTotals(TicketStatus::IMMATURE).nStakeCredit;
+    live = ledger.GetTotals(TicketStatus::LIVE).nStakeCredit;
+    voted = ledger.GetTotals(TicketStatus::VOTED).nStakeCredit;
+    revoked = ledger.GetTotals(TicketStatus::REVOKED).nStakeCredit;
 
-            if (wtx->InMempool())
-                mempool += stakedCredit;
+    // the missed and expired tickets are in the missed ticket pool until
+    // revoked, and an expired ticket is still counted once revoked
+    missed = ledger.GetTotals(TicketStatus::MISSED).nStakeCredit + ledger.GetTotals(TicketStatus::EXPIRED).nStakeCredit;
+    expired = ledger.GetTotals(TicketStatus::EXPIRED).nStakeCredit + ledger.GetTotals(TicketStatus::REVOKED, true).nStakeCredit;
 
-            if (wtx->GetDepthInMainChain() < consensus.nTicketMaturity)
-                immature += stakedCredit;
+    for (int status = 0; status < TICKET_STATUS_COUNT; ++status)
+        total += ledger.GetTotals(static_cast<TicketStatus>(status)).nStakeCredit;
+}
 
-            const uint256& hash = tx->GetHash();
+const CTicketLedger& CWallet::GetTicketLedger() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-            if (IsSpent(hash, ticketStakeOutputIndex, &spendingWtx)) {
-                switch (ParseTxClass(*spendingWtx.tx)) {
-                case TX_Vote:
-                    voted += stakedCredit;
-                    break;
-                case TX_RevokeTicket:
-                    revoked += stakedCredit;
-                    break;
-                default:
-                    throw std::runtime_error(std::string(__func__) + " : ticket " + hash.GetHex() + " spent by illegal transaction");
-                    break;
-                }
-            }
+    if (!ticketLedger.IsStale())
+        return ticketLedger;
 
-            if (stakeNode->ExistsLiveTicket(hash))
-                live += stakedCredit;
+    ticketLedger.Clear();
+    const CBlockIndex* tip = chainActive.Tip();
+    for (const std::pair<const uint256, CWalletTx>& item : mapWallet) {
+        const CWalletTx& wtx = item.second;
+        if (!AddToTicketLedger(wtx))
+            continue;
 
-            if (stakeNode->ExistsMissedTicket(hash))
-                missed += stakedCredit;
+        const int nDepth = wtx.GetDepthInMainChain();
+        if (nDepth <= 0)
+            continue;
 
-            if (stakeNode->ExistsExpiredTicket(hash))
-                expired += stakedCredit;
-        }
+        ticketLedger.SetMined(item.first, chainActive.Height() - nDepth + 1);
+        if (tip->pstakeNode != nullptr)
+            ticketLedger.SetStatusFromNode(item.first, *tip->pstakeNode);
     }
+    return ticketLedger;
+}
+
+bool CWallet::AddToTicketLedger(const CWalletTx& wtx) const
+{
+    const CTransaction& tx = *wtx.tx;
+    if (ParseTxClass(tx) != TX_BuyTicket)
+        return false;
+
+    // Stake output must be valid
+    if (tx.vout.size() < ticketStakeOutputIndex + 1 || !MoneyRange(tx.vout[ticketStakeOutputIndex].nValue))
+        return false;
+
+    const CAmount stakedCredit = GetCredit(tx.vout[ticketStakeOutputIndex], ISMINE_SPENDABLE);
+    ticketLedger.AddTicket(wtx.GetHash(), tx.vout[ticketStakeOutputIndex].nValue, stakedCredit);
+    return true;
 }
 
 CAmount CWallet::GetUnconfirmedBalance() const
@@ -4373,6 +4696,74 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CCon
     return true;
 }
 
+bool CWallet::CommitTransactions(std::vector<CWalletTx>& vwtxNew, CConnman* connman)
+{
+    LOCK2(cs_main, cs_wallet);
+
+    // the transactions are written in a single database transaction, and
+    // only added to the wallet in memory once it is committed, so that a
+    // failed write leaves the wallet as it was
+    CWalletDB walletdb(*dbw);
+    if (!walletdb.TxnBegin())
+        return false;
+
+    int64_t nOrderPos = nOrderPosNext;
+    for (CWalletTx& wtxNew : vwtxNew) {
+        LogPrintf("CommitTransactions:\n%s", wtxNew.tx->ToString());
+        if (mapWallet.count(wtxNew.GetHash()))
+            continue;
+        wtxNew.BindWallet(this);
+        wtxNew.nTimeReceived = GetAdjustedTime();
+        wtxNew.nOrderPos = nOrderPos++;
+        wtxNew.nTimeSmart = ComputeTimeSmart(wtxNew);
+        if (!walletdb.WriteTx(wtxNew)) {
+            walletdb.TxnAbort();
+            return false;
+        }
+    }
+
+    if (!walletdb.WriteOrderPosNext(nOrderPos)) {
+        walletdb.TxnAbort();
+        return false;
+    }
+    if (!walletdb.TxnCommit())
+        return false;
+    nOrderPosNext = nOrderPos;
+
+    for (CWalletTx& wtxNew : vwtxNew) {
+        const uint256 hash = wtxNew.GetHash();
+        if (!mapWallet.count(hash))
+            AddNewToWallet(wtxNew);
+
+        // Notify that old coins are spent
+        for (const CTxIn& txin : wtxNew.tx->vin) {
+            CWalletTx &coin = mapWallet[txin.prevout.hash];
+            coin.BindWallet(this);
+            NotifyTransactionChanged(this, coin.GetHash(), CT_UPDATED);
+        }
+
+        // Track how many getdata requests our transaction gets
+        mapRequestCount[hash] = 0;
+    }
+
+    // all the transactions get into the memory pool before any is relayed
+    std::vector<CWalletTx*> vwtxAccepted;
+    for (CWalletTx& wtxNew : vwtxNew) {
+        if (fBroadcastTransactions) {
+            CValidationState state;
+            if (!wtxNew.AcceptToMemoryPool(maxTxFee, state))
+                LogPrintf("CommitTransactions(): Transaction cannot be broadcast immediately, %s\n", state.GetRejectReason());
+            else
+                vwtxAccepted.push_back(&wtxNew);
+        }
+    }
+
+    for (CWalletTx* pwtx : vwtxAccepted)
+        pwtx->RelayWalletTransaction(connman);
+
+    return true;
+}
+
 void CWallet::ListAccountCreditDebit(const std::string& strAccount, std::list<CAccountingEntry>& entries) {
     CWalletDB walletdb(*dbw);
     return walletdb.ListAccountCreditDebit(strAccount, entries);
@@ -26,6 +26,7 @@
 #include "wallet/auto-voter/autovoter.h"
 #include "wallet/auto-revoker/autorevoker.h"
 #include "wallet/ticket-buyer/ticketbuyer.h"
+#include "wallet/ticketledger.h"
 #include "stake/staketx.h"
 
 #include <algorithm>
@@ -54,6 +55,12 @@ extern bool fAutoVote;
 extern bool fAutoRevoke;
 
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 1000;
+//! Maximum number of threads reading and filtering blocks during a rescan
+static const int MAX_RESCAN_THREADS = 8;
+//! Number of blocks read and filtered at a time during a rescan
+static const unsigned int RESCAN_BATCH_SIZE = 256;
+//! Maximum number of threads signing the stake transactions built at once
+static const int MAX_SIGNING_THREADS = 8;
 //! -paytxfee default
 static const CAmount DEFAULT_TRANSACTION_FEE = 0;
 //! -fallbackfee default
@@ -739,6 +746,23 @@ public:
     }
 };
 
+/** A transaction built by the wallet, with the outputs spent by the inputs it signs */
+struct CTransactionToSign
+{
+    CMutableTransaction mtx;
+    std::vector<std::pair<unsigned int, CTxOut>> vSpent;
+    bool fSigned = false;
+};
+
+/** The part of the vote of a ticket that does not depend on the block voted on, see CWallet::CreateVoteTemplate */
+struct CVoteTemplate
+{
+    uint256 ticketHash;
+    CTxOut stakeOut;
+    std::vector<TicketContribData> contributions;
+    std::vector<CScript> vRewardScripts;
+};
+
 /** 
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -787,6 +811,28 @@ private:
     /* Remove all the outpoints corresponding to the specified transactions from the spends list */
     void RemoveFromSpends(const std::vector<uint256>& hashes);
 
+    /* The scripts of the key store, looked for in the blocks by the rescan threads, see ScanForWalletTransactions */
+    struct RescanFilter;
+    std::shared_ptr<const RescanFilter> MakeRescanFilter() const;
+    size_t GetKeyStoreSize() const;
+    /* Whether AddToWalletIfInvolvingMe must look at a transaction the rescan filter did not match: it spends
+     * or conflicts with a wallet transaction, or is one */
+    bool IsRescanCandidate(const CTransaction& tx) const;
+
+    /* The status of the tickets of the wallet, built from the tip on first use and then kept up to
+     * date by BlockConnected/BlockDisconnected, see GetTicketLedger */
+    mutable CTicketLedger ticketLedger;
+    /* Add a ticket purchase to the ticket ledger, as not yet mined; false if wtx is no ticket */
+    bool AddToTicketLedger(const CWalletTx& wtx) const;
+
+    /* Add a new transaction, already written with its order position, to the wallet in memory, see AddToWallet */
+    void AddNewToWallet(const CWalletTx& wtxNew);
+    /* Log a new or updated wallet transaction and notify the UI and -walletnotify of it */
+    void NotifyWalletTx(CWalletTx& wtx, bool fInsertedNew, bool fUpdated);
+
+    /* Builds the unsigned revocation of a missed ticket of the wallet, see Revoke */
+    bool CreateRevocation(const uint256& ticketHash, CTransactionToSign& revocation, CWalletError& error) const;
+
     /* Used by TransactionAddedToMemorypool/BlockConnected/Disconnected.
      * Should be called with pindexBlock and posInBlock if this is for a transaction that is included in a block. */
     void SyncTransaction(const CTransactionRef& tx, const CBlockIndex *pindex = nullptr, int posInBlock = 0);
@@ -865,7 +911,8 @@ public:
     // Create wallet with dummy database handle
     CWallet(bool autoVote = fAutoVote, bool autoRevoke = fAutoRevoke) :
         dbw(new CWalletDBWrapper()),
-        ticketFeeRate(2 * minTxFee.GetFeePerK())
+        ticketFeeRate(2 * minTxFee.GetFeePerK()),
+        cs_wallet(GetLockProfile("cs_wallet"))
     {
         autoVoter = MakeUnique<CAutoVoter>(this);
         if (autoVote) autoVoter->start();
@@ -879,7 +926,8 @@ public:
     // Create wallet with passed-in database handle
     explicit CWallet(std::unique_ptr<CWalletDBWrapper> dbw_in, bool autoVote = fAutoVote, bool autoRevoke = fAutoRevoke) :
         dbw(std::move(dbw_in)),
-        ticketFeeRate(2 * minTxFee.GetFeePerK())
+        ticketFeeRate(2 * minTxFee.GetFeePerK()),
+        cs_wallet(GetLockProfile("cs_wallet"))
     {
         autoVoter = MakeUnique<CAutoVoter>(this);
         if (autoVote) autoVoter->start();
@@ -1051,6 +1099,8 @@ public:
 
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
+    /** Add a transaction to the wallet, writing it with the given database handle, which may hold a batch */
+    bool AddToWallet(const CWalletTx& wtxIn, CWalletDB& walletdb);
     bool LoadToWallet(const CWalletTx& wtxIn);
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
@@ -1064,6 +1114,8 @@ public:
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime, CConnman* connman);
     CAmount GetBalance() const;
     void GetStakedBalances(CAmount& total, CAmount& mempool, CAmount& immature, CAmount& live, CAmount& voted, CAmount& missed, CAmount& expired, CAmount& revoked) const;
+    /** The status of the tickets of the wallet at the tip. Requires cs_main and cs_wallet */
+    const CTicketLedger& GetTicketLedger() const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
     CAmount GetWatchOnlyBalance() const;
@@ -1091,6 +1143,11 @@ public:
     bool CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletTx& wtxNew, CReserveKey& reservekey, CAmount& nFeeRet, int& nChangePosInOut,
                            std::string& strFailReason, const CCoinControl& coin_control, bool sign = true);
     bool CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CConnman* connman, CValidationState& state);
+    /** Commit transactions spending no change key, written to the wallet database in one batch,
+        and relay them once all are in the memory pool */
+    bool CommitTransactions(std::vector<CWalletTx>& vwtxNew, CConnman* connman);
+    /** Sign the inputs of the transactions, on several threads */
+    void SignTransactions(std::vector<CTransactionToSign>& vTxToSign) const;
 
     void ListAccountCreditDebit(const std::string& strAccount, std::list<CAccountingEntry>& entries);
     bool AddAccountingEntry(const CAccountingEntry&);
@@ -1362,6 +1419,19 @@ public:
          const VoteBits voteBits,
          const ExtendedVoteBits& extendedVoteBits);
 
+    /* Prepares the vote of a ticket of the wallet but for the block voted on: the stake output spent,
+       the contributions and the scripts paid the rewards. Requires cs_wallet */
+    bool CreateVoteTemplate(const uint256& ticketHash, CVoteTemplate& voteTemplate, CWalletError& error) const;
+
+    /* Builds the unsigned vote of a ticket on a block, see Vote. Requires cs_main */
+    bool CreateVote(const CVoteTemplate& voteTemplate,
+                    const uint256& blockHash,
+                    const int blockHeight,
+                    const VoteBits voteBits,
+                    const ExtendedVoteBits& extendedVoteBits,
+                    CTransactionToSign& vote,
+                    CWalletError& error) const;
+
     /* Creates a revocation
        It funds and creates the revocation transaction for the specified ticket and sends it to the memory pool.
        This transaction must have a fee for encouragig miners to add it in a block. This fee will be spent from the stake,
@@ -7,6 +7,8 @@
 
 #include "zmqconfig.h"
 
+#include <memory>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
@@ -32,8 +34,11 @@ public:
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
+    // pblock is the connected block, if still at hand
+    virtual bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    // the changes of the stake state made by a connected block
+    virtual bool NotifyStake(const CBlockIndex *pindex);
 
 protected:
     void *psocket;
@@ -10,16 +10,19 @@
 #include "zmqpublishnotifier.h"
 
 #include "version.h"
+#include "chainparams.h"
 #include "validation.h"
 #include "streams.h"
 #include "util.h"
 
+#include <algorithm>
+
 void zmqError(const char *str)
 {
     LogPrint(BCLog::ZMQ, "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr), fRawBlock(false), nMaxQueue(DEFAULT_ZMQ_QUEUE_SIZE), fDrop(DEFAULT_ZMQ_QUEUE_DROP), fStop(false), nDropped(0)
 {
 }
 
@@ -43,6 +46,11 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubwinningtickets"] = CZMQAbstractNotifier::Create<CZMQPublishWinningTicketsNotifier>;
+    factories["pubnewtickets"] = CZMQAbstractNotifier::Create<CZMQPublishNewTicketsNotifier>;
+    factories["pubmissedtickets"] = CZMQAbstractNotifier::Create<CZMQPublishMissedTicketsNotifier>;
+    factories["pubrevokedtickets"] = CZMQAbstractNotifier::Create<CZMQPublishRevokedTicketsNotifier>;
+    factories["pubvote"] = CZMQAbstractNotifier::Create<CZMQPublishVoteNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -62,6 +70,9 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     {
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        notificationInterface->fRawBlock = gArgs.IsArgSet("-zmqpubrawblock");
+        notificationInterface->nMaxQueue = std::max(gArgs.GetArg("-zmqqueuesize", DEFAULT_ZMQ_QUEUE_SIZE), (int64_t)1);
+        notificationInterface->fDrop = gArgs.GetBoolArg("-zmqqueuedrop", DEFAULT_ZMQ_QUEUE_DROP);
 
         if (!notificationInterface->Initialize())
         {
@@ -107,36 +118,59 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    // the sockets are only used on this thread from now on
+    thread = boost::thread(&TraceThread<std::function<void()>>, "zmqpub", [this] { Thread(); });
+
     return true;
 }
 
-// Called during shutdown sequence
-void CZMQNotificationInterface::Shutdown()
+void CZMQNotificationInterface::Enqueue(std::function<void()> job)
 {
-    LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
-    if (pcontext)
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (fStop)
+        return;
+    if (queue.size() >= nMaxQueue)
     {
-        for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
+        if (fDrop)
         {
-            CZMQAbstractNotifier *notifier = *i;
-            LogPrint(BCLog::ZMQ, "   Shutdown notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
-            notifier->Shutdown();
+            if (nDropped++ % nMaxQueue == 0)
+                LogPrintf("zmq: Notification queue full, %u notifications dropped\n", nDropped);
+            return;
         }
-        zmq_ctx_destroy(pcontext);
-
-        pcontext = nullptr;
+        // back pressure on the validation callbacks
+        while (queue.size() >= nMaxQueue && !fStop)
+            condRoom.wait(lock);
     }
+    queue.push_back(std::move(job));
+    condJob.notify_one();
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+void CZMQNotificationInterface::Thread()
 {
-    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
-        return;
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty() && !fStop)
+                condJob.wait(lock);
+            // the queued notifications are published before stopping
+            if (queue.empty())
+                return;
+            job = std::move(queue.front());
+            queue.pop_front();
+            condRoom.notify_one();
+        }
+        job();
+    }
+}
 
+void CZMQNotificationInterface::Notify(const std::function<bool(CZMQAbstractNotifier*)>& notify)
+{
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindexNew))
+        if (notify(notifier))
         {
             i++;
         }
@@ -148,39 +182,89 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, co
     }
 }
 
-void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx)
+// Called during shutdown sequence
+void CZMQNotificationInterface::Shutdown()
 {
-    // Used by BlockConnected and BlockDisconnected as well, because they're
-    // all the same external callback.
-    const CTransaction& tx = *ptx;
+    LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+        condJob.notify_all();
+        condRoom.notify_all();
+    }
+    if (thread.joinable())
+        thread.join();
 
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    if (pcontext)
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
-        {
-            i++;
-        }
-        else
+        for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
+            CZMQAbstractNotifier *notifier = *i;
+            LogPrint(BCLog::ZMQ, "   Shutdown notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
             notifier->Shutdown();
-            i = notifiers.erase(i);
         }
+        zmq_ctx_destroy(pcontext);
+
+        pcontext = nullptr;
     }
 }
 
-void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted)
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        // Do a normal notify for each transaction added in the block
-        TransactionAddedToMempool(ptx);
+    std::shared_ptr<const CBlock> pblock;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (pblockConnected && pblockConnected->GetHash() == pindexNew->GetBlockHash())
+            pblock = pblockConnected;
+        pblockConnected.reset();
+    }
+
+    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
+        return;
+
+    // the block is read here, not to take cs_main on the thread of the
+    // interface, which the validation callbacks may wait for with it held
+    if (!pblock && fRawBlock) {
+        LOCK(cs_main);
+        ReadBlockFromDiskCached(pblock, pindexNew, Params().GetConsensus());
     }
+
+    Enqueue([this, pindexNew, pblock] {
+        Notify([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyBlock(pindexNew, pblock); });
+    });
+}
+
+void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx)
+{
+    Enqueue([this, ptx] {
+        Notify([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransaction(*ptx); });
+    });
+}
+
+void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted)
+{
+    // a single notification for the block, which holds it
+    Enqueue([this, pblock, pindexConnected] {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            // Do a normal notify for each transaction added in the block
+            Notify([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransaction(*ptx); });
+        }
+        Notify([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyStake(pindexConnected); });
+    });
+
+    // the block is kept for the tip notification that follows
+    boost::unique_lock<boost::mutex> lock(mutex);
+    pblockConnected = pblock;
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        // Do a normal notify for each transaction removed in block disconnection
-        TransactionAddedToMempool(ptx);
-    }
+    Enqueue([this, pblock] {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            // Do a normal notify for each transaction removed in block disconnection
+            Notify([&](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransaction(*ptx); });
+        }
+    });
+    boost::unique_lock<boost::mutex> lock(mutex);
+    pblockConnected.reset();
 }
@@ -6,13 +6,22 @@
 #define PAICOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
+#include <deque>
+#include <functional>
 #include <string>
 #include <map>
 #include <list>
 
+#include <boost/thread.hpp>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+//! The number of notifications waiting to be published, beyond which the queue is full
+static const unsigned int DEFAULT_ZMQ_QUEUE_SIZE = 1000;
+//! Whether the notifications are dropped while the queue is full, instead of waiting for room
+static const bool DEFAULT_ZMQ_QUEUE_DROP = false;
+
 class CZMQNotificationInterface final : public CValidationInterface
 {
 public:
@@ -33,8 +42,29 @@ protected:
 private:
     CZMQNotificationInterface();
 
+    /** Queue a notification, to be published on the thread of the interface */
+    void Enqueue(std::function<void()> job);
+    void Thread();
+    /** Run notify for each notifier, dropping those that fail (only on the thread) */
+    void Notify(const std::function<bool(CZMQAbstractNotifier*)>& notify);
+
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
+    // whether a notifier publishes the raw blocks, which are then read before they are queued
+    bool fRawBlock;
+
+    // the last connected block, handed with the tip it becomes, guarded by mutex
+    std::shared_ptr<const CBlock> pblockConnected;
+
+    boost::thread thread;
+    boost::mutex mutex;
+    boost::condition_variable condJob;
+    boost::condition_variable condRoom;
+    std::deque<std::function<void()>> queue;
+    size_t nMaxQueue;
+    bool fDrop;
+    bool fStop;
+    uint64_t nDropped;
 };
 
 #endif // PAICOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
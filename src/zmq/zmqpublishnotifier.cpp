@@ -9,6 +9,10 @@
 #include "validation.h"
 #include "util.h"
 #include "rpc/server.h"
+#include "stake/stakenode.h"
+#include "stake/staketx.h"
+
+#include <set>
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
@@ -16,9 +20,14 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
-
-// Internal function to send multipart message
-static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
+static const char *MSG_WINNINGTICKETS = "winningtickets";
+static const char *MSG_NEWTICKETS     = "newtickets";
+static const char *MSG_MISSEDTICKETS  = "missedtickets";
+static const char *MSG_REVOKEDTICKETS = "revokedtickets";
+static const char *MSG_VOTE           = "vote";
+
+// Internal function to send multipart message, the last part with the given flags
+static int zmq_send_multipart(void *sock, int flags, const void* data, size_t size, ...)
 {
     va_list args;
     va_start(args, size);
@@ -40,7 +49,7 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
 
         data = va_arg(args, const void*);
 
-        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
+        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : flags);
         if (rc == -1)
         {
             zmqError("Unable to send ZMQ msg");
@@ -60,6 +69,68 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
     return 0;
 }
 
+// Append a hash in the byte order of the hashblock and hashtx messages
+static void AppendHash(std::vector<unsigned char>& data, const uint256& hash)
+{
+    for (unsigned int i = 0; i < 32; i++)
+        data.push_back(hash.begin()[31 - i]);
+}
+
+// The body of the stake messages: the block hash, its height (LE 4 bytes) and the tickets
+static std::vector<unsigned char> StakeMessageData(const CBlockIndex *pindex, const HashVector& tickets)
+{
+    std::vector<unsigned char> data;
+    data.reserve(32 + sizeof(uint32_t) + 32 * tickets.size());
+    AppendHash(data, pindex->GetBlockHash());
+    unsigned char height[sizeof(uint32_t)];
+    WriteLE32(&height[0], pindex->nHeight);
+    data.insert(data.end(), height, height + sizeof(uint32_t));
+    for (const uint256& ticketHash : tickets)
+        AppendHash(data, ticketHash);
+    return data;
+}
+
+static void zmq_free_vector(void * /*data*/, void *hint)
+{
+    delete static_cast<std::vector<unsigned char>*>(hint);
+}
+
+// Internal function to send a part of a multipart message, which then owns the data
+static int zmq_send_vector(void *sock, int flags, std::vector<unsigned char>&& data)
+{
+    std::vector<unsigned char>* pdata = new std::vector<unsigned char>(std::move(data));
+    zmq_msg_t msg;
+
+    int rc = zmq_msg_init_data(&msg, pdata->data(), pdata->size(), zmq_free_vector, pdata);
+    if (rc != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        delete pdata;
+        return -1;
+    }
+
+    // freed by zmq once sent, or when closed
+    rc = zmq_msg_send(&msg, sock, flags);
+    if (rc == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return -1;
+    }
+    return 0;
+}
+
+// Internal function to serialize a block or a transaction for the raw messages
+template <typename T>
+static std::vector<unsigned char> SerializeRaw(const T& obj)
+{
+    const int nVersion = PROTOCOL_VERSION | RPCSerializationFlags();
+    std::vector<unsigned char> data;
+    data.reserve(GetSerializeSize(obj, SER_NETWORK, nVersion));
+    CVectorWriter(SER_NETWORK, nVersion, data, 0, obj);
+    return data;
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -136,7 +207,7 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
     WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), nullptr);
+    int rc = zmq_send_multipart(psocket, 0, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), nullptr);
     if (rc == -1)
         return false;
 
@@ -146,7 +217,31 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, std::vector<unsigned char>&& data)
+{
+    assert(psocket);
+
+    // zmq does not take over empty data
+    if (data.empty())
+        return SendMessage(command, data.data(), 0);
+
+    /* send the same three parts, without copying the data */
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(&msgseq[0], nSequence);
+    if (zmq_send_multipart(psocket, ZMQ_SNDMORE, command, strlen(command), nullptr) == -1)
+        return false;
+    if (zmq_send_vector(psocket, ZMQ_SNDMORE, std::move(data)) == -1)
+        return false;
+    if (zmq_send_multipart(psocket, 0, msgseq, (size_t)sizeof(uint32_t), nullptr) == -1)
+        return false;
+
+    /* increment memory only sequence number after sending */
+    nSequence++;
+
+    return true;
+}
+
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& /*pblock*/)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint(BCLog::ZMQ, "zmq: Publish hashblock %s\n", hash.GetHex());
@@ -166,32 +261,88 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendMessage(MSG_HASHTX, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock)
 {
     LogPrint(BCLog::ZMQ, "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+    // the block is read before the notification is queued, so that this
+    // thread never takes cs_main
+    if (!pblock)
     {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+        zmqError("Can't read block from disk");
+        return false;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, SerializeRaw(*pblock));
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
     LogPrint(BCLog::ZMQ, "zmq: Publish rawtx %s\n", hash.GetHex());
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWTX, SerializeRaw(transaction));
+}
+
+bool CZMQPublishWinningTicketsNotifier::NotifyStake(const CBlockIndex *pindex)
+{
+    if (pindex->pstakeNode == nullptr)
+        return true;
+
+    // the tickets that may vote on the block, in its children
+    LogPrint(BCLog::ZMQ, "zmq: Publish winningtickets %s\n", pindex->GetBlockHash().GetHex());
+    std::vector<unsigned char> data = StakeMessageData(pindex, pindex->pstakeNode->Winners());
+    return SendMessage(MSG_WINNINGTICKETS, std::move(data));
+}
+
+bool CZMQPublishNewTicketsNotifier::NotifyStake(const CBlockIndex *pindex)
+{
+    if (pindex->pstakeNode == nullptr)
+        return true;
+
+    // the tickets purchased nTicketMaturity blocks earlier, which become live with the block
+    LogPrint(BCLog::ZMQ, "zmq: Publish newtickets %s\n", pindex->GetBlockHash().GetHex());
+    std::vector<unsigned char> data = StakeMessageData(pindex, pindex->pstakeNode->NewTickets());
+    return SendMessage(MSG_NEWTICKETS, std::move(data));
+}
+
+bool CZMQPublishMissedTicketsNotifier::NotifyStake(const CBlockIndex *pindex)
+{
+    if (pindex->pstakeNode == nullptr)
+        return true;
+
+    // the tickets that missed their vote or expired with the block, each followed
+    // by a byte set to 1 if it expired, but not the revocations of the missed tickets
+    LogPrint(BCLog::ZMQ, "zmq: Publish missedtickets %s\n", pindex->GetBlockHash().GetHex());
+    const HashVector vExpired = pindex->pstakeNode->ExpiredByBlock();
+    const HashVector vRevoked = pindex->pstakeNode->RevokedByBlock();
+    const std::set<uint256> expired(vExpired.begin(), vExpired.end());
+    const std::set<uint256> revoked(vRevoked.begin(), vRevoked.end());
+    std::vector<unsigned char> data = StakeMessageData(pindex, HashVector());
+    for (const uint256& ticketHash : pindex->pstakeNode->MissedByBlock()) {
+        if (revoked.count(ticketHash))
+            continue;
+        AppendHash(data, ticketHash);
+        data.push_back(expired.count(ticketHash) ? 1 : 0);
+    }
+    return SendMessage(MSG_MISSEDTICKETS, std::move(data));
+}
+
+bool CZMQPublishRevokedTicketsNotifier::NotifyStake(const CBlockIndex *pindex)
+{
+    if (pindex->pstakeNode == nullptr)
+        return true;
+
+    LogPrint(BCLog::ZMQ, "zmq: Publish revokedtickets %s\n", pindex->GetBlockHash().GetHex());
+    std::vector<unsigned char> data = StakeMessageData(pindex, pindex->pstakeNode->RevokedByBlock());
+    return SendMessage(MSG_REVOKEDTICKETS, std::move(data));
+}
+
+bool CZMQPublishVoteNotifier::NotifyTransaction(const CTransaction &transaction)
+{
+    if (ParseTxClass(transaction) != TX_Vote)
+        return true;
+
+    uint256 hash = transaction.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish vote %s\n", hash.GetHex());
+    return SendMessage(MSG_VOTE, SerializeRaw(transaction));
 }
@@ -7,6 +7,8 @@
 
 #include "zmqabstractnotifier.h"
 
+#include <vector>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
@@ -23,6 +25,8 @@ public:
           * message sequence number
     */
     bool SendMessage(const char *command, const void* data, size_t size);
+    // the same, handing over the data to ZMQ instead of copying it
+    bool SendMessage(const char *command, std::vector<unsigned char>&& data);
 
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
@@ -31,7 +35,7 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -43,7 +47,7 @@ public:
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -52,4 +56,34 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+class CZMQPublishWinningTicketsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyStake(const CBlockIndex *pindex) override;
+};
+
+class CZMQPublishNewTicketsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyStake(const CBlockIndex *pindex) override;
+};
+
+class CZMQPublishMissedTicketsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyStake(const CBlockIndex *pindex) override;
+};
+
+class CZMQPublishRevokedTicketsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyStake(const CBlockIndex *pindex) override;
+};
+
+class CZMQPublishVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransaction(const CTransaction &transaction) override;
+};
+
 #endif // PAICOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
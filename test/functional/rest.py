@@ -322,5 +322,33 @@ class RESTTest (PAIcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        # check the stake data against the rpc
+        height = self.nodes[0].getblockcount()
+        json_string = http_get_call(url.hostname, url.port, '/rest/stake/tickets/live/'+str(height)+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['hash'], bb_hash)
+        assert_equal(json_obj['tickets'], self.nodes[0].livetickets()['tickets'])
+
+        # height and hash of the block, then the ticket hashes, as the json form
+        response = http_get_call(url.hostname, url.port, '/rest/stake/tickets/live/'+str(height)+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        response_bytes = response.read()
+        assert_equal(unpack('<I', response_bytes[0:4])[0], height)
+        assert_equal(response_bytes[4:36], hex_str_to_bytes(bb_hash)[::-1])
+
+        json_string = http_get_call(url.hostname, url.port, '/rest/stake/history/1/'+bb_hash+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj[0]['height'], height)
+        assert_equal(json_obj[0]['stakedifficulty'], self.nodes[0].getstakedifficulty()['current'])
+
+        # height, hash, stake difficulty and pool size of each block, after the count
+        first_hash = self.nodes[0].getblockhash(height - 4)
+        response = http_get_call(url.hostname, url.port, '/rest/stake/history/5/'+first_hash+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        assert_equal(int(response.getheader('content-length')), 1 + 5*(4+32+8+4))
+
+        response = http_get_call(url.hostname, url.port, '/rest/stake/unknown'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+
 if __name__ == '__main__':
     RESTTest ().main ()